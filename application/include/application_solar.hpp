@@ -6,6 +6,7 @@
 #include "structs.hpp"
 #include "scene_graph.hpp"
 #include "geometry_node.hpp"
+#include "geometry_arena.hpp"
 
 // gpu representation of model
 class ApplicationSolar : public Application {
@@ -21,6 +22,8 @@ class ApplicationSolar : public Application {
   void mouseCallback(double pos_x, double pos_y);
   //handle resizing
   void resizeCallback(unsigned width, unsigned height);
+  // place the camera, e.g. along a benchmark path
+  void setView(glm::fmat4 const& view_transform);
 
   // draw all objects
   void render();
@@ -36,6 +39,8 @@ class ApplicationSolar : public Application {
   void renderSkybox();
   void initializeFrameBuffer();
   void renderFrameBuffer();
+  // record the virtual texture tiles visible on planets
+  void renderFeedback();
   static void createBufferTexture(
           GLuint texture,
           int width,
@@ -51,6 +56,10 @@ class ApplicationSolar : public Application {
   // upload view matrix
   void uploadView();
 
+  // shared buffers, planets and enterprise use the full mesh format
+  GeometryArena mesh_arena;
+  // shared buffers for position-only geometry, orbits and skybox
+  GeometryArena position_arena;
   // cpu representation of model
   model_object planet_object;
   model_object enterprise_object;
@@ -68,6 +77,10 @@ class ApplicationSolar : public Application {
   glm::fmat4 m_view_transform;
   // camera projection matrix
   glm::fmat4 m_view_projection;
+  // loads textures in the background, uploads them within a per-frame budget
+  TextureStreamer texture_streamer;
+  // tiles of high resolution planet maps, loaded as they become visible
+  VirtualTexturing virtual_texturing;
   // scene graph for this application
   SceneGraph sceneGraph;
 };
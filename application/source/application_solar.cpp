@@ -1,4 +1,5 @@
 // standard library
+#include <functional>
 #include <iostream>
 
 // framework
@@ -8,6 +9,10 @@
 #include "shader_loader.hpp"
 #include "model_loader.hpp"
 #include "texture_loader.hpp"
+#include "cluster_culling.hpp"
+#include "mesh_builder.hpp"
+#include "geometry_arena.hpp"
+#include "vertex_layout.hpp"
 
 
 // self-written classes
@@ -25,6 +30,21 @@ using namespace gl;
 #pragma region CONSTANTS
     int STAR_COUNT = 1000;
     int LINE_SEGMENT_COUNT = 100;
+    // tessellation of the procedural planet sphere, matches the former sphere.obj
+    model_loader::sphere_type PLANET_SPHERE_TYPE = model_loader::UV_SPHERE;
+    unsigned PLANET_SUBDIVISIONS = 32;
+    // capacities of the shared geometry buffers, the enterprise needs ~22k vertices and ~75k indices
+    std::size_t MESH_ARENA_VERTICES = 1 << 16;
+    std::size_t MESH_ARENA_INDICES = 1 << 17;
+    std::size_t POSITION_ARENA_VERTICES = 1 << 10;
+    std::size_t POSITION_ARENA_INDICES = 1 << 10;
+
+// vertex formats of the scene geometry, locations match the shaders
+// planets and enterprise share one format so they can share one arena
+using mesh_layout = vertex_layout<vertex_attribute<0, 3>, vertex_attribute<1, 3>, vertex_attribute<2, 2>, vertex_attribute<3, 3>>;
+using star_layout = vertex_layout<vertex_attribute<0, 3>, vertex_attribute<1, 3>>;
+using position_layout = vertex_layout<vertex_attribute<0, 3>>;
+using screen_quad_layout = vertex_layout<vertex_attribute<0, 2>, vertex_attribute<1, 2>>;
 
 std::vector<GLfloat> SKYBOX_VERTICES = {
         -1.0f, -1.0f,  1.0f,        //        7--------6
@@ -37,7 +57,7 @@ std::vector<GLfloat> SKYBOX_VERTICES = {
         -1.0f,  1.0f, -1.0f
 };
 
-std::vector<GLint> SKYBOX_INDICES = {
+std::vector<GLuint> SKYBOX_INDICES = {
         // Right
         1, 2, 6,
         6, 5, 1,
@@ -63,11 +83,34 @@ bool vertical = false;
 bool horizontal = false;
 bool chromatic_aberration = false;
 
+// permutation of the post-processing program for the enabled effects
+static std::set<std::string> post_process_defines() {
+    std::set<std::string> defines{};
+    if (greyscale) {
+        defines.insert("GREYSCALE");
+    }
+    if (blur) {
+        defines.insert("BLUR");
+    }
+    if (vertical) {
+        defines.insert("VERTICAL");
+    }
+    if (horizontal) {
+        defines.insert("HORIZONTAL");
+    }
+    if (chromatic_aberration) {
+        defines.insert("CHROMATIC_ABERRATION");
+    }
+    return defines;
+}
+
 #pragma endregion
 
 
 ApplicationSolar::ApplicationSolar(std::string const& resource_path)
  :Application{resource_path}
+ ,mesh_arena{}
+ ,position_arena{}
  ,planet_object{}
  ,enterprise_object{}
  ,star_object{}
@@ -80,6 +123,8 @@ ApplicationSolar::ApplicationSolar(std::string const& resource_path)
  ,depth_texture{}
  ,m_view_transform{glm::translate(glm::fmat4{}, glm::fvec3{0.0f, 0.0f, 4.0f})}
  ,m_view_projection{utils::calculate_projection_matrix(initial_aspect_ratio)}
+ ,texture_streamer{}
+ ,virtual_texturing{}
  ,sceneGraph{}
 {
     // setup all necessary geometries and shaders
@@ -98,32 +143,45 @@ ApplicationSolar::ApplicationSolar(std::string const& resource_path)
     };
 
     // create graph hierarchy
-    sceneGraph = setupSolarSystem(model_objects, resource_path);
+    virtual_texturing.resize(initial_resolution[0], initial_resolution[1]);
+    sceneGraph = setupSolarSystem(model_objects, resource_path, texture_streamer, virtual_texturing);
+    GeometryNode::setViewportHeight(float(initial_resolution[1]));
+    // orbits and stars are measured per pass
+    GeometryNode::setProfiler(&m_gpu_profiler);
 
     std::cout << initial_resolution[0] << ", " << initial_resolution[1] << std::endl;
 }
 
 ApplicationSolar::~ApplicationSolar() {
-    glDeleteBuffers(1, &planet_object.vertex_BO);
-    glDeleteBuffers(1, &planet_object.element_BO);
-    glDeleteVertexArrays(1, &planet_object.vertex_AO);
-
-    glDeleteBuffers(1, &enterprise_object.vertex_BO);
-    glDeleteBuffers(1, &enterprise_object.element_BO);
-    glDeleteVertexArrays(1, &enterprise_object.vertex_AO);
-
-    glDeleteBuffers(1, &star_object.vertex_BO);
-    glDeleteBuffers(1, &star_object.element_BO);
-    glDeleteVertexArrays(1, &star_object.vertex_AO);
-
-    glDeleteBuffers(1, &orbit_object.vertex_BO);
-    glDeleteBuffers(1, &orbit_object.element_BO);
-    glDeleteVertexArrays(1, &orbit_object.vertex_AO);
-
+    freeSolarSystem(sceneGraph, texture_streamer);
+    cluster_culling::free(enterprise_object);
+
+    mesh_arena.free(planet_object);
+    mesh_arena.free(enterprise_object);
+    position_arena.free(orbit_object);
+    position_arena.free(skybox_object);
+    mesh_builder::free(star_object);
+    mesh_builder::free(screen_quad_object);
+
+    freeTexture(skybox_texture);
+    glDeleteTextures(1, &color_texture);
+    glDeleteTextures(1, &depth_texture);
+    glDeleteFramebuffers(1, &post_process_fbo);
+    GeometryNode::setProfiler(nullptr);
 }
 
 // renders the entire scene graph starting from the root
 void ApplicationSolar::render() {
+    // planets spin with the scene time
+    GeometryNode::setTime(m_time);
+    // continue texture uploads within the frame budget
+    texture_streamer.update();
+    // tiles seen in the last frame are loaded while this frame's tiles are recorded
+    if (!virtual_texturing.empty()) {
+        virtual_texturing.update();
+        renderFeedback();
+    }
+
     // things that cannot be handled in geometry node, as it requires information about scene are handled here
     std::shared_ptr<PointLightNode> sun_light = std::static_pointer_cast<PointLightNode>(sceneGraph.getRoot()->getChild("Planet-Sun-Holder"));
 
@@ -153,10 +211,37 @@ void ApplicationSolar::render() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     //renderSkybox();
-    sceneGraph.getRoot()->renderNode(m_shaders, m_view_transform);
+    {
+        GpuProfiler::Scope scope{&m_gpu_profiler, "scene"};
+        sceneGraph.getRoot()->renderNode(m_shaders, m_view_transform);
+    }
     renderFrameBuffer();
 }
 
+void ApplicationSolar::renderFeedback() {
+    GpuProfiler::Scope scope{&m_gpu_profiler, "feedback"};
+    virtual_texturing.beginFeedback();
+    glUseProgram(m_shaders.at("planet").handle);
+    glUniform1i(m_shaders.at("planet").u_locs.at("Feedback"), 1);
+    glUniform1f(m_shaders.at("planet").u_locs.at("FeedbackBias"), virtual_texturing.getFeedbackBias());
+
+    // only planets, other geometry would write colours which are no feedback
+    std::function<void(std::shared_ptr<Node> const&)> render_planets = [&](std::shared_ptr<Node> const& node) {
+        auto geometry = std::dynamic_pointer_cast<GeometryNode>(node);
+        if (geometry && node->getName().find("Planet") != std::string::npos) {
+            geometry->renderPlanet(m_shaders, m_view_transform);
+        }
+        for (auto const& child : node->getChildren()) {
+            render_planets(child);
+        }
+    };
+    render_planets(sceneGraph.getRoot());
+
+    glUseProgram(m_shaders.at("planet").handle);
+    glUniform1i(m_shaders.at("planet").u_locs.at("Feedback"), 0);
+    virtual_texturing.endFeedback();
+}
+
 void ApplicationSolar::uploadView() {
     // vertices are transformed in camera space, so camera transform must be inverted
     glm::fmat4 view_matrix = glm::inverse(m_view_transform);
@@ -188,6 +273,8 @@ void ApplicationSolar::uploadView() {
 }
 
 void ApplicationSolar::uploadProjection() {
+    // clustered geometry is culled against the view frustum
+    GeometryNode::setProjectionMatrix(m_view_projection);
 
     // bind shader to which to upload uniforms
     glUseProgram(m_shaders.at("planet").handle);
@@ -242,7 +329,13 @@ void ApplicationSolar::initializeShaderPrograms() {
     m_shaders.at("planet").u_locs["LightColor"] = -1;
     m_shaders.at("planet").u_locs["CameraPosition"] = -1;
     m_shaders.at("planet").u_locs["TextureSampler"] = -1;
-    m_shaders.at("planet").u_locs["Cel"] = -1;
+    m_shaders.at("planet").u_locs["Feedback"] = -1;
+    m_shaders.at("planet").u_locs["FeedbackBias"] = -1;
+    m_shaders.at("planet").u_locs["VirtualTexture"] = -1;
+    m_shaders.at("planet").u_locs["PageTable"] = -1;
+    m_shaders.at("planet").u_locs["TileCache"] = -1;
+    m_shaders.at("planet").u_locs["VirtualLayout"] = -1;
+    m_shaders.at("planet").u_locs["CacheLayout"] = -1;
 
     m_shaders.emplace("orbit", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/orbit.vert"},
                                             {GL_FRAGMENT_SHADER, m_resource_path + "shaders/orbit.frag"}}});
@@ -270,6 +363,15 @@ void ApplicationSolar::initializeShaderPrograms() {
     m_shaders.at("enterprise").u_locs["LightColor"] = -1;
     m_shaders.at("enterprise").u_locs["CameraPosition"] = -1;
     m_shaders.at("enterprise").u_locs["TextureSampler"] = -1;
+    m_shaders.at("enterprise").u_locs["VirtualTexture"] = -1;
+
+    // clusters of large models are culled in a compute shader if supported
+    if (cluster_culling::gpu_supported()) {
+        m_shaders.emplace("cluster-cull", shader_program{{{GL_COMPUTE_SHADER, m_resource_path + "shaders/cluster_cull.comp"}}});
+        m_shaders.at("cluster-cull").u_locs["ModelViewProjection"] = -1;
+        m_shaders.at("cluster-cull").u_locs["CameraPosition"] = -1;
+        m_shaders.at("cluster-cull").u_locs["ClusterCount"] = -1;
+    }
 
     m_shaders.emplace("skybox", shader_program{{{GL_VERTEX_SHADER, m_resource_path + "shaders/skybox.vert"},
                                                 {GL_FRAGMENT_SHADER, m_resource_path + "shaders/skybox.frag"}}});
@@ -285,15 +387,14 @@ void ApplicationSolar::initializeShaderPrograms() {
     m_shaders.at("screen-quad").u_locs["ProjectionMatrix"] = -1;
     m_shaders.at("screen-quad").u_locs["ColorTexture"] = -1;
     m_shaders.at("screen-quad").u_locs["DepthTexture"] = -1;
-    m_shaders.at("screen-quad").u_locs["Greyscale"] = -1;
-    m_shaders.at("screen-quad").u_locs["Horizontal"] = -1;
-    m_shaders.at("screen-quad").u_locs["Vertical"] = -1;
-    m_shaders.at("screen-quad").u_locs["Blur"] = -1;
-    m_shaders.at("screen-quad").u_locs["ChromaticAberration"] = -1;
 }
 
 // initialise all geometries
 void ApplicationSolar::initializeGeometry() {
+    // meshes of the same vertex format are suballocated from shared buffers
+    mesh_arena = GeometryArena::create<mesh_layout>(MESH_ARENA_VERTICES, MESH_ARENA_INDICES);
+    position_arena = GeometryArena::create<position_layout>(POSITION_ARENA_VERTICES, POSITION_ARENA_INDICES);
+
     initializeStarGeometry();
     initializeSkyboxGeometry();
     initializeOrbitGeometry();
@@ -303,131 +404,58 @@ void ApplicationSolar::initializeGeometry() {
 
 # pragma region GEOMETRY INIT
 void ApplicationSolar::initializePlanetGeometry() {
-    model planet_model = model_loader::obj(m_resource_path + "models/sphere.obj", model::NORMAL | model::TEXCOORD);
-
-    // generate vertex array object
-    glGenVertexArrays(1, &planet_object.vertex_AO);
-    // bind the array for attaching buffers
-    glBindVertexArray(planet_object.vertex_AO);
-
-    // generate generic buffer
-    glGenBuffers(1, &planet_object.vertex_BO);
-    // bind this as an vertex array buffer containing all attributes
-    glBindBuffer(GL_ARRAY_BUFFER, planet_object.vertex_BO);
-    // configure currently bound array buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * planet_model.data.size(), planet_model.data.data(), GL_STATIC_DRAW);
-
-    // activate first attribute on gpu
-    glEnableVertexAttribArray(0);
-    // first attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::POSITION]);
-    // activate second attribute on gpu
-    glEnableVertexAttribArray(1);
-    // second attribute is 3 floats with no offset & stride
-    glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::NORMAL]);
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, planet_model.vertex_bytes, planet_model.offsets[model::TEXCOORD]);
-
-    // generate generic buffer
-    glGenBuffers(1, &planet_object.element_BO);
-    // bind this as an vertex array buffer containing all attributes
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, planet_object.element_BO);
-    // configure currently bound array buffer
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * planet_model.indices.size(), planet_model.indices.data(), GL_STATIC_DRAW);
-
-    // store type of primitive to draw
-    planet_object.draw_mode = GL_TRIANGLES;
-    // transfer number of indices to model object
-    planet_object.num_elements = GLsizei(planet_model.indices.size());
+    // planets use a procedural sphere with the tessellation of the former sphere.obj
+    model::attrib_flag_t planet_attribs = model::POSITION | model::NORMAL | model::TEXCOORD | model::TANGENT;
+    std::size_t vertex_num = model_loader::sphere_vertex_num(PLANET_SPHERE_TYPE, PLANET_SUBDIVISIONS);
+    std::size_t index_num = model_loader::sphere_index_num(PLANET_SPHERE_TYPE, PLANET_SUBDIVISIONS);
+
+    // reserve ranges without uploading data
+    planet_object = mesh_arena.allocate(nullptr, vertex_num, nullptr, index_num, GL_TRIANGLES);
+
+    // generate sphere directly into the mapped ranges, indices are relative to the base vertex
+    GLvoid* vertex_ptr = nullptr;
+    GLuint* index_ptr = nullptr;
+    mesh_arena.map(planet_object, vertex_ptr, index_ptr);
+    model_loader::sphere(PLANET_SPHERE_TYPE, PLANET_SUBDIVISIONS, planet_attribs, static_cast<GLfloat*>(vertex_ptr), index_ptr);
+    mesh_arena.unmap();
 }
 
 void ApplicationSolar::initializeEnterpriseGeometry() {
     // Load the model from a file
-    model enterprise_model = model_loader::obj(m_resource_path + "models/USS_Enterprise_NCC-1701_7.obj", model::NORMAL | model::TEXCOORD);
-
-    // Generate a vertex array object for the enterprise
-    glGenVertexArrays(1, &enterprise_object.vertex_AO);
-    glBindVertexArray(enterprise_object.vertex_AO);
-
-    // Generate a vertex buffer object for the enterprise vertices and bind it
-    glGenBuffers(1, &enterprise_object.vertex_BO);
-    glBindBuffer(GL_ARRAY_BUFFER, enterprise_object.vertex_BO);
-
-    // Provide the vertex data for the enterprise and store it in the vertex buffer object
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * enterprise_model.data.size(), enterprise_model.data.data(), GL_STATIC_DRAW);
-
-    // Enable and specify the layout of vertex attribute 0 (position)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, model::POSITION.components, model::POSITION.type, GL_FALSE, enterprise_model.vertex_bytes, enterprise_model.offsets[model::POSITION]);
+    model enterprise_model = model_loader::obj(m_resource_path + "models/USS_Enterprise_NCC-1701_7.obj", model::NORMAL | model::TEXCOORD | model::TANGENT);
+    // split into clusters which can be culled individually, the indices keep their order
+    model_loader::generate_meshlets(enterprise_model);
 
-    // Enable and specify the layout of vertex attribute 1 (normal)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, model::NORMAL.components, model::NORMAL.type, GL_FALSE, enterprise_model.vertex_bytes, enterprise_model.offsets[model::NORMAL]);
-
-    // Enable and specify the layout of vertex attribute 2 (texture coordinates)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, model::TEXCOORD.components, model::TEXCOORD.type, GL_FALSE, enterprise_model.vertex_bytes, enterprise_model.offsets[model::TEXCOORD]);
-
-    // Generate an element buffer object for the enterprise indices and bind it
-    glGenBuffers(1, &enterprise_object.element_BO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, enterprise_object.element_BO);
-
-    // Provide the index data for the enterprise and store it in the element buffer object
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, model::INDEX.size * enterprise_model.indices.size(), enterprise_model.indices.data(), GL_STATIC_DRAW);
-
-    // Set the draw mode for the enterprise object to GL_TRIANGLES
-    enterprise_object.draw_mode = GL_TRIANGLES;
-
-    // Set the number of elements to be drawn for the enterprise
-    enterprise_object.num_elements = static_cast<GLsizei>(enterprise_model.indices.size());
+    // Upload vertices and indices into the arena shared with the planets
+    enterprise_object = mesh_arena.allocate(enterprise_model);
 
+    // Upload cluster bounds for per-cluster culling
+    cluster_culling::upload(enterprise_model, enterprise_object);
 }
 
 // set up geometry for stars
 void ApplicationSolar::initializeStarGeometry() {
-    std::srand( (unsigned)time(nullptr) );
+    // seeded generator, so recorded runs replay the same sky
+    std::uniform_real_distribution<float> position_distribution{-50.0f, 50.0f};
+    std::uniform_real_distribution<float> color_distribution{0.0f, 1.0f};
     std::vector<float> stars_vec;
 
     // for each star push random position and color values
     for (int i = 0; i < STAR_COUNT; ++i) {
-        float x = (static_cast <float> (std::rand()) / (static_cast <float> (RAND_MAX/100)))-50;
-        float y = (static_cast <float> (std::rand()) / (static_cast <float> (RAND_MAX/100)))-50;
-        float z = (static_cast <float> (std::rand()) / (static_cast <float> (RAND_MAX/100)))-50;
-        float r = static_cast <float> (std::rand()) / static_cast <float> (RAND_MAX);
-        float g = static_cast <float> (std::rand()) / static_cast <float> (RAND_MAX);
-        float b = static_cast <float> (std::rand()) / static_cast <float> (RAND_MAX);
+        float x = position_distribution(m_random);
+        float y = position_distribution(m_random);
+        float z = position_distribution(m_random);
+        float r = color_distribution(m_random);
+        float g = color_distribution(m_random);
+        float b = color_distribution(m_random);
 
         for (float const number : {x, y, z, r, g, b}) {
             stars_vec.push_back(number);
         }
     }
 
-    // enable and bind vertex array
-    glGenVertexArrays(1, &star_object.vertex_AO);
-    glBindVertexArray(star_object.vertex_AO);
-
-    // generate generic buffer
-    glGenBuffers(1, &star_object.vertex_BO);
-    glBindBuffer(GL_ARRAY_BUFFER, star_object.vertex_BO);
-
-    // fill buffer with information about stars (each star is made up of 6 floats: {x, y, z}, {r, g, b}
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * STAR_COUNT * 6,
-                 stars_vec.data(), GL_STATIC_DRAW);
-    // enable attribute 1
-    glEnableVertexAttribArray(0);
-    // first attribute position {x, y, z}
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 6, nullptr);
-
-    // enable attribute 2
-    glEnableVertexAttribArray(1);
-    // second attribute colour {r, g, b}
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(float) * 6, (void*)(sizeof(float) * 3));
-    // set the draw_mode to GL_POINTS, so that each star with the given attributes is drawn as a single point
-    star_object.draw_mode = GL_POINTS;
-    // specify the amount of stars drawn
-    star_object.num_elements = GLsizei(STAR_COUNT);
+    // each star is made up of 6 floats: {x, y, z}, {r, g, b}, drawn as a single point
+    star_object = mesh_builder::create<star_layout>(stars_vec, {}, GL_POINTS);
 }
 
 // set up geometry for orbit
@@ -446,68 +474,14 @@ void ApplicationSolar::initializeOrbitGeometry() {
         segment_points.push_back(static_cast<float>(cos(angle)));
     }
 
-    // Generate a vertex array object for the orbit
-    glGenVertexArrays(1, &orbit_object.vertex_AO);
-    glBindVertexArray(orbit_object.vertex_AO);
-
-    // Generate a vertex buffer object for the orbit vertices and bind it
-    glGenBuffers(1, &orbit_object.vertex_BO);
-    glBindBuffer(GL_ARRAY_BUFFER, orbit_object.vertex_BO);
-
-    // Provide the vertex data for the orbit and store it in the vertex buffer object
-    glBufferData(GL_ARRAY_BUFFER, GLsizei(segment_points.size() * sizeof(float)),
-                 segment_points.data(), GL_STATIC_DRAW);
-
-    // Enable and specify the layout of vertex attribute 0 (coordinates)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, nullptr);
-
-    // Generate an element buffer object for the orbit indices and bind it
-    glGenBuffers(1, &orbit_object.element_BO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, orbit_object.element_BO);
-
-    // Provide the index data for the orbit and store it in the element buffer object
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 GLsizei(sizeof(float) * segment_points.size()), segment_points.data(),
-                 GL_STATIC_DRAW);
-
-    // Set the draw mode for the orbit object to GL_LINE_LOOP to draw lines between points
-    // and finally connect them together to form a circle
-    orbit_object.draw_mode = GL_LINE_LOOP;
-
-    // Set the number of elements to be drawn for the orbit
-    orbit_object.num_elements = LINE_SEGMENT_COUNT;
-
+    // GL_LINE_LOOP draws lines between points and finally connects them to form a circle
+    orbit_object = position_arena.allocate(segment_points.data(), segment_points.size() / 3, nullptr, 0, GL_LINE_LOOP);
 }
 
 void ApplicationSolar::initializeSkyboxGeometry() {
-    // Generate a vertex array object for the skybox
-    glGenVertexArrays(1, &skybox_object.vertex_AO);
-    glBindVertexArray(skybox_object.vertex_AO);
-
-    // Generate a vertex buffer object for the skybox vertices and bind it
-    glGenBuffers(1, &skybox_object.vertex_BO);
-    glBindBuffer(GL_ARRAY_BUFFER, skybox_object.vertex_BO);
-
-    // Provide the vertex data for the skybox and store it in the vertex buffer object
-    glBufferData(GL_ARRAY_BUFFER, sizeof(SKYBOX_VERTICES), &SKYBOX_VERTICES, GL_STATIC_DRAW);
-
-    // Enable and specify the layout of vertex attribute 0 (coordinates)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
-
-    // Generate an element buffer object for the skybox indices and bind it
-    glGenBuffers(1, &skybox_object.element_BO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skybox_object.element_BO);
-
-    // Provide the index data for the skybox and store it in the element buffer object
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(SKYBOX_INDICES), &SKYBOX_INDICES, GL_STATIC_DRAW);
-
-    // Set the draw mode for the skybox object to GL_TRIANGLES
-    skybox_object.draw_mode = GL_TRIANGLES;
-
-    // Set the number of elements to be drawn for the skybox
-    skybox_object.num_elements = static_cast<GLsizei>(SKYBOX_VERTICES.size());
+    // cube corners, indexed by the triangles of the six faces
+    skybox_object = position_arena.allocate(SKYBOX_VERTICES.data(), SKYBOX_VERTICES.size() / 3,
+                                            SKYBOX_INDICES.data(), SKYBOX_INDICES.size(), GL_TRIANGLES);
 }
 
 void ApplicationSolar::initializeFrameBuffer() {
@@ -539,30 +513,13 @@ void ApplicationSolar::initializeFrameBuffer() {
             -1.f, 1.f, 0.f, 1.f    // Bottom left
     };
 
-    // Generate a vertex array object and a vertex buffer object for the quad
-    glGenVertexArrays(1, &screen_quad_object.vertex_AO);
-    glGenBuffers(1, &screen_quad_object.vertex_BO);
-    glBindVertexArray(screen_quad_object.vertex_AO);
-    glBindBuffer(GL_ARRAY_BUFFER, screen_quad_object.vertex_BO);
-
-    // Provide the vertex data to the GPU
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
-
-    // Enable and specify the layout of vertex attribute 0 (coordinates)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), NULL);
-
-    // Enable and specify the layout of vertex attribute 1 (texture coordinates)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *) (2 * sizeof(float)));
-
-    // Set the number of elements and draw mode for the quad object
-    screen_quad_object.num_elements = 6;
-    screen_quad_object.draw_mode = GL_TRIANGLES;
+    // Two triangles with position and texture coordinates covering the screen
+    screen_quad_object = mesh_builder::create<screen_quad_layout>(vertices, 6, nullptr, 0, GL_TRIANGLES);
 }
 #pragma endregion
 
 void ApplicationSolar::renderSkybox() {
+    GpuProfiler::Scope scope{&m_gpu_profiler, "skybox"};
     //glDisable(GL_DEPTH_TEST);
     glDepthFunc(GL_LEQUAL);
     //glCullFace(GL_FRONT);
@@ -578,15 +535,16 @@ void ApplicationSolar::renderSkybox() {
 
 
     // bind the VAO to draw
-    gl::glBindVertexArray(skybox_object.vertex_AO);
+    mesh_builder::bind(skybox_object);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, skybox_texture.handle);
     // draw bound vertex array using bound shader
-    glDrawElements(skybox_object.draw_mode, skybox_object.num_elements, model::INDEX.type, nullptr);
+    mesh_builder::draw(skybox_object);
     glDepthFunc(GL_LESS);
 }
 
 void ApplicationSolar::renderFrameBuffer() {
+    GpuProfiler::Scope scope{&m_gpu_profiler, "post-process"};
     // Disable depth testing to ensure the quad is rendered on top of everything
     glDisable(GL_DEPTH_TEST);
     // Bind the default framebuffer (screen) for rendering
@@ -596,7 +554,7 @@ void ApplicationSolar::renderFrameBuffer() {
     glUseProgram(m_shaders.at("screen-quad").handle);
 
     // Bind the vertex array object for the screen quad
-    glBindVertexArray(screen_quad_object.vertex_AO);
+    mesh_builder::bind(screen_quad_object);
 
     // Activate texture unit 0 and bind the color texture
     glActiveTexture(GL_TEXTURE0);
@@ -607,7 +565,7 @@ void ApplicationSolar::renderFrameBuffer() {
     glBindTexture(GL_TEXTURE_2D, depth_texture);
 
     // Draw the screen quad using the specified draw mode, vertex count, and attributes
-    glDrawArrays(screen_quad_object.draw_mode, 0, screen_quad_object.num_elements);
+    mesh_builder::draw(screen_quad_object);
 
     glEnable(GL_DEPTH_TEST);
 }
@@ -668,43 +626,37 @@ void ApplicationSolar::keyCallback(int key, int action, int mods) {
       uploadView();
     }
 
+    // effects select specialised programs, compiled on first use
     else if (key == GLFW_KEY_1 && action == GLFW_PRESS) {
-        glUseProgram(m_shaders.at("planet").handle);
-        glUniform1i(m_shaders.at("planet").u_locs.at("Cel"), false);
+        setShaderDefines("planet", {});
     }
     else if (key == GLFW_KEY_2 && action == GLFW_PRESS) {
-        glUseProgram(m_shaders.at("planet").handle);
-        glUniform1i(m_shaders.at("planet").u_locs.at("Cel"), true);
+        setShaderDefines("planet", {"CEL"});
     }
 
     else if (key == GLFW_KEY_3 && action == GLFW_PRESS) {
         greyscale = !greyscale;
-        glUseProgram(m_shaders.at("screen-quad").handle);
-        glUniform1i(m_shaders.at("screen-quad").u_locs.at("Greyscale"), greyscale);
+        setShaderDefines("screen-quad", post_process_defines());
     }
 
     else if (key == GLFW_KEY_4 && action == GLFW_PRESS) {
         horizontal = !horizontal;
-        glUseProgram(m_shaders.at("screen-quad").handle);
-        glUniform1i(m_shaders.at("screen-quad").u_locs.at("Horizontal"), horizontal);
+        setShaderDefines("screen-quad", post_process_defines());
     }
 
     else if (key == GLFW_KEY_5 && action == GLFW_PRESS) {
         vertical = !vertical;
-        glUseProgram(m_shaders.at("screen-quad").handle);
-        glUniform1i(m_shaders.at("screen-quad").u_locs.at("Vertical"), vertical);
+        setShaderDefines("screen-quad", post_process_defines());
     }
 
     else if (key == GLFW_KEY_6 && action == GLFW_PRESS) {
         blur = !blur;
-        glUseProgram(m_shaders.at("screen-quad").handle);
-        glUniform1i(m_shaders.at("screen-quad").u_locs.at("Blur"), blur);
+        setShaderDefines("screen-quad", post_process_defines());
     }
 
     else if (key == GLFW_KEY_7 && action == GLFW_PRESS) {
         chromatic_aberration = !chromatic_aberration;
-        glUseProgram(m_shaders.at("screen-quad").handle);
-        glUniform1i(m_shaders.at("screen-quad").u_locs.at("ChromaticAberration"), chromatic_aberration);
+        setShaderDefines("screen-quad", post_process_defines());
     }
 }
 
@@ -721,10 +673,17 @@ void ApplicationSolar::mouseCallback(double pos_x, double pos_y) {
     uploadView();
 }
 
+void ApplicationSolar::setView(glm::fmat4 const& view_transform) {
+    m_view_transform = view_transform;
+    uploadView();
+}
+
 //handle resizing
 void ApplicationSolar::resizeCallback(unsigned width, unsigned height) {
   // recalculate projection matrix for new aspect ration
   m_view_projection = utils::calculate_projection_matrix(float(width) / float(height));
+  GeometryNode::setViewportHeight(float(height));
+  virtual_texturing.resize(width, height);
   // upload new projection matrix
   uploadProjection();
 }
@@ -732,5 +691,10 @@ void ApplicationSolar::resizeCallback(unsigned width, unsigned height) {
 
 // exe entry point
 int main(int argc, char* argv[]) {
+#ifdef SOLAR_BENCH
+  // solar_bench renders offscreen without window
+  return Application::benchmark<ApplicationSolar>(argc, argv, 3, 2);
+#else
   Application::run<ApplicationSolar>(argc, argv, 3, 2);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+// microbenchmarks of loaders, scene graph and math hot paths
+// usage: framework_bench [resource path] [--warmup n] [--repetitions n] [--report file] [--baseline file]
+// results are written to framework_bench.json, compared only with a baseline given by --baseline
+// to keep a baseline, write one with --report on the same machine, e.g. --report baseline.json before a change
+// and --baseline baseline.json after it, timings of other machines are not comparable
+#include "micro_benchmark.hpp"
+#include "model_loader.hpp"
+#include "node.hpp"
+#include "offscreen_context.hpp"
+#include "scene_graph.hpp"
+#include "texture_loader.hpp"
+#include "texture_streamer.hpp"
+#include "utils.hpp"
+#include "virtual_texturing.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// textures of the planets, the sun and the moon
+static const std::vector<std::string> TEXTURES_2K = {
+  "2k_sun.jpg", "2k_mercury.jpg", "2k_venus_surface.jpg", "2k_earth_nightmap.jpg", "2k_moon.jpg", "2k_mars.jpg",
+  "2k_jupiter.jpg", "2k_saturn.jpg", "2k_uranus.jpg", "2k_neptune.jpg", "2k_pluto.jpg"
+};
+// matrices per math kernel run, enough to amortise the timer
+static const std::size_t MATRIX_COUNT = 4096;
+
+static void print_usage(char const* executable);
+static std::map<std::string, model_object> empty_model_objects();
+static void propagate_transforms(std::shared_ptr<Node> const& node);
+
+int main(int argc, char* argv[]) {
+  std::size_t warmup = 2;
+  std::size_t repetitions = 15;
+  std::string report{"framework_bench.json"};
+  std::string baseline{};
+  std::string resource_path{};
+  for (int i = 1; i < argc; ++i) {
+    std::string const argument{argv[i]};
+    if (argument.compare(0, 2, "--") != 0 && resource_path.empty()) {
+      resource_path = argument;
+    }
+    else if (i + 1 < argc && argument == "--warmup") {
+      warmup = std::size_t(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (i + 1 < argc && argument == "--repetitions") {
+      repetitions = std::size_t(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (i + 1 < argc && argument == "--report") {
+      report = argv[++i];
+    }
+    else if (i + 1 < argc && argument == "--baseline") {
+      baseline = argv[++i];
+    }
+    else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (resource_path.empty()) {
+    resource_path = utils::read_resource_path(1, argv);
+  }
+  // the scene graph requests textures, which needs a context
+  if (!offscreen_context::initialize(glm::uvec2{64, 64}, 3, 2)) {
+    return EXIT_FAILURE;
+  }
+
+  MicroBenchmark bench{warmup, repetitions};
+  model loaded_model{};
+  bench.run("model_loader::obj sphere", [&]() {
+    loaded_model = model_loader::obj(resource_path + "models/sphere.obj", model::NORMAL | model::TEXCOORD);
+  });
+  bench.run("model_loader::obj enterprise", [&]() {
+    loaded_model = model_loader::obj(resource_path + "models/USS_Enterprise_NCC-1701_7.obj",
+                                     model::NORMAL | model::TEXCOORD | model::TANGENT);
+  });
+  MicroBenchmark::keep(loaded_model);
+
+  bench.run("texture_loader::file 2k textures", [&]() {
+    for (auto const& texture : TEXTURES_2K) {
+      pixel_data const pixels{texture_loader::file(resource_path + "textures/" + texture)};
+      MicroBenchmark::keep(pixels);
+    }
+  });
+
+  bench.run("utils::read_file enterprise obj", [&]() {
+    std::string const content{utils::read_file(resource_path + "models/USS_Enterprise_NCC-1701_7.obj")};
+    MicroBenchmark::keep(content);
+  });
+
+  // streamers are created before each run, texture requests only queue loads
+  std::unique_ptr<TextureStreamer> streamer{};
+  std::unique_ptr<VirtualTexturing> virtual_texturing{};
+  std::map<std::string, model_object> const model_objects{empty_model_objects()};
+  SceneGraph scene{};
+  bench.run("setupSolarSystem", [&]() {
+    scene = setupSolarSystem(model_objects, resource_path, *streamer, *virtual_texturing);
+  }, [&]() {
+    scene = SceneGraph{};
+    virtual_texturing.reset();
+    streamer.reset();
+    streamer.reset(new TextureStreamer{});
+    virtual_texturing.reset(new VirtualTexturing{});
+  });
+  // the scene is kept for the traversal, its loads would compete with the following cases
+  freeSolarSystem(scene, *streamer);
+  virtual_texturing.reset();
+  streamer.reset();
+
+  // the traversal of Node::renderNode without drawing
+  bench.run("Node::setLocalTransform frame", [&]() {
+    propagate_transforms(scene.getRoot());
+  });
+
+  // operands are random, so no result can be precomputed
+  std::mt19937 random{1u};
+  std::uniform_real_distribution<float> distribution{-1.0f, 1.0f};
+  std::vector<glm::fmat4> matrices(MATRIX_COUNT);
+  for (auto& matrix : matrices) {
+    matrix = glm::translate(glm::rotate(glm::fmat4{}, distribution(random), glm::normalize(glm::fvec3{1.0f, distribution(random), 0.5f})),
+                            glm::fvec3{distribution(random), distribution(random), distribution(random)});
+  }
+  std::vector<glm::fmat4> products(MATRIX_COUNT);
+  std::vector<glm::fmat3> normal_matrices(MATRIX_COUNT);
+  bench.run("glm mat4 multiply x4096", [&]() {
+    for (std::size_t i = 0; i < MATRIX_COUNT; ++i) {
+      products[i] = matrices[i] * matrices[MATRIX_COUNT - 1 - i];
+    }
+    MicroBenchmark::keep(products);
+  });
+  bench.run("glm mat4 inverse x4096", [&]() {
+    for (std::size_t i = 0; i < MATRIX_COUNT; ++i) {
+      products[i] = glm::inverse(matrices[i]);
+    }
+    MicroBenchmark::keep(products);
+  });
+  bench.run("glm normal matrix x4096", [&]() {
+    for (std::size_t i = 0; i < MATRIX_COUNT; ++i) {
+      normal_matrices[i] = glm::inverseTranspose(glm::fmat3{matrices[i]});
+    }
+    MicroBenchmark::keep(normal_matrices);
+  });
+  bench.run("glm lookAt x4096", [&]() {
+    for (std::size_t i = 0; i < MATRIX_COUNT; ++i) {
+      products[i] = glm::lookAt(glm::fvec3{matrices[i][3]} + glm::fvec3{0.0f, 0.0f, 2.0f}, glm::fvec3{matrices[i][3]},
+                                glm::fvec3{0.0f, 1.0f, 0.0f});
+    }
+    MicroBenchmark::keep(products);
+  });
+
+  scene = SceneGraph{};
+
+  bench.print(std::cout);
+  if (bench.writeJson(report)) {
+    std::cout << "written to " << report << std::endl;
+  }
+  int status = EXIT_SUCCESS;
+  utils::file_stamp stamp{0, 0};
+  if (!baseline.empty() && !utils::stamp_file(baseline, stamp)) {
+    std::cerr << "baseline " << baseline << " not found" << std::endl;
+    status = EXIT_FAILURE;
+  }
+  else if (!baseline.empty()) {
+    std::cout << "\ncompared with " << baseline << "\n";
+    try {
+      status = bench.compare(baseline, std::cout) > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    catch (std::exception const& error) {
+      std::cerr << error.what() << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  offscreen_context::terminate();
+  return status;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void print_usage(char const* executable) {
+  std::cerr << "usage: " << executable << " [resource path] [--warmup n] [--repetitions n]"
+            << " [--report json file] [--baseline json file]" << std::endl;
+}
+
+// geometry is not drawn, nodes only keep the handles
+static std::map<std::string, model_object> empty_model_objects() {
+  std::map<std::string, model_object> objects{};
+  for (char const* name : {"planet-object", "stars-object", "orbit-object", "enterprise-object"}) {
+    objects.emplace(name, model_object{});
+  }
+  return objects;
+}
+
+static void propagate_transforms(std::shared_ptr<Node> const& node) {
+  glm::fmat4 const rotation = glm::rotate(glm::fmat4{}, glm::radians(0.1f), glm::fvec3{0.0f, 1.0f, 0.0f});
+  node->setLocalTransform(rotation * node->getLocalTransform());
+  for (auto const& child : node->getChildren()) {
+    propagate_transforms(child);
+  }
+}
@@ -0,0 +1,514 @@
+// draw submission strategies compared on the same scene of n cubes, from immediate mode to multi-draw-indirect
+// usage: submission_bench [resource path] [--counts n,n,..] [--frames n] [--warmup n] [--report file]
+// prints median cpu submission and frame times per strategy and object count, written to submission_bench.json
+#include "cpu_profiler.hpp"
+#include "offscreen_context.hpp"
+#include "shader_loader.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <vector>
+
+// ordered from most to fewest calls per object
+enum strategy {
+  // glBegin/glEnd with fixed function matrices, like 1_fixed
+  IMMEDIATE,
+  // buffer bound and attributes specified per object, like 2_vbo
+  VBO,
+  // vertex array object with index buffer per object, like 3_indexed and 6_vao
+  INDEXED,
+  // one shared vertex array, only the matrix uniform changes per object, like 5_uniform
+  UNIFORM,
+  // matrices streamed as instance attributes, one draw
+  INSTANCED,
+  // matrices streamed to a uniform buffer, an index uniform per object
+  UNIFORM_BUFFER,
+  // one indirect draw per object, submitted in one call, base instances select the matrices
+  MULTI_DRAW_INDIRECT,
+  STRATEGIES
+};
+
+static char const* const STRATEGY_NAMES[STRATEGIES] = {
+  "immediate", "vbo", "indexed", "uniform", "instanced", "uniform_buffer", "multi_draw_indirect"
+};
+
+// matrices per bound range of the uniform buffer, 16kb is the minimal block size
+static const std::size_t MODELS_PER_BLOCK = 256;
+static const glm::uvec2 RESOLUTION{640, 480};
+
+// interleaved position and color of the cube corners
+static const std::vector<float> CUBE_VERTICES{
+  -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f,
+   0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,
+   0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+  -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+  -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 1.0f,
+   0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 1.0f,
+   0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 1.0f,
+  -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, 1.0f,
+};
+// two counter-clockwise triangles per face
+static const std::vector<GLushort> CUBE_INDICES{
+  0, 3, 2,  2, 1, 0,
+  4, 5, 6,  6, 7, 4,
+  0, 1, 5,  5, 4, 0,
+  3, 7, 6,  6, 2, 3,
+  0, 4, 7,  7, 3, 0,
+  1, 2, 6,  6, 5, 1,
+};
+static const GLsizei CUBE_STRIDE = GLsizei(sizeof(float) * 6);
+
+// layout of an indirect draw command as read by the gl
+struct draw_elements_command {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// gl objects of one strategy, allocated for the measured object count
+struct submission_state {
+  GLuint program;
+  GLint model_location;
+  GLint index_location;
+  GLint view_projection_location;
+  // shared cube, indexed
+  GLuint vertex_ao;
+  GLuint vertex_bo;
+  GLuint index_bo;
+  // per object copies for vbo and indexed
+  std::vector<GLuint> object_aos;
+  std::vector<GLuint> object_bos;
+  std::vector<GLuint> object_index_bos;
+  // per frame matrices, instance attributes or uniform buffer
+  GLuint matrix_bo;
+  GLuint indirect_bo;
+};
+
+struct measurement {
+  strategy method;
+  std::size_t objects;
+  double submit_ms;
+  double frame_ms;
+};
+
+static void print_usage(char const* executable);
+static bool parse_counts(std::string const& text, std::vector<std::size_t>& counts);
+static bool is_supported(strategy method, bool compatibility);
+static submission_state create_state(strategy method, std::size_t objects, std::string const& resource_path,
+                                     glm::fmat4 const& view_projection);
+static void destroy_state(submission_state& state);
+static void submit(strategy method, submission_state const& state, std::vector<glm::fmat4> const& models);
+static void bind_cube_attributes(GLuint vertex_bo);
+static void update_models(std::vector<glm::fmat4>& models, unsigned frame);
+static double median(std::vector<double> values);
+static bool write_report(std::string const& file_name, std::string const& renderer, unsigned frames, unsigned warmup,
+                         std::vector<measurement> const& measurements);
+
+int main(int argc, char* argv[]) {
+  std::vector<std::size_t> counts{1, 10, 100, 1000, 10000};
+  unsigned frames = 100;
+  unsigned warmup = 10;
+  std::string report{"submission_bench.json"};
+  std::string resource_path{};
+  for (int i = 1; i < argc; ++i) {
+    std::string const argument{argv[i]};
+    if (argument.compare(0, 2, "--") != 0 && resource_path.empty()) {
+      resource_path = argument;
+    }
+    else if (i + 1 < argc && argument == "--counts" && parse_counts(argv[i + 1], counts)) {
+      ++i;
+    }
+    else if (i + 1 < argc && argument == "--frames") {
+      frames = std::max(unsigned(std::strtoul(argv[++i], nullptr, 10)), 1u);
+    }
+    else if (i + 1 < argc && argument == "--warmup") {
+      warmup = unsigned(std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (i + 1 < argc && argument == "--report") {
+      report = argv[++i];
+    }
+    else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (resource_path.empty()) {
+    resource_path = utils::read_resource_path(1, argv);
+  }
+  // immediate mode needs the compatibility profile, without it the other strategies still run
+  bool compatibility = offscreen_context::initialize(RESOLUTION, 3, 3, true);
+  if (!compatibility && !offscreen_context::initialize(RESOLUTION, 3, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  // the report is written after the context is gone
+  std::string const renderer{reinterpret_cast<char const*>(glGetString(GL_RENDERER))};
+  glEnable(GL_DEPTH_TEST);
+  glViewport(0, 0, GLsizei(RESOLUTION.x), GLsizei(RESOLUTION.y));
+  glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+  glm::fmat4 const view_projection{utils::calculate_projection_matrix(float(RESOLUTION.x) / float(RESOLUTION.y))};
+
+  std::vector<measurement> measurements{};
+  for (int s = 0; s < STRATEGIES; ++s) {
+    strategy const method{strategy(s)};
+    if (!is_supported(method, compatibility)) {
+      std::cout << STRATEGY_NAMES[method] << " is not supported by this context, skipped" << std::endl;
+      continue;
+    }
+    for (std::size_t objects : counts) {
+      submission_state state{};
+      try {
+        state = create_state(method, objects, resource_path, view_projection);
+      }
+      catch (std::exception const& error) {
+        std::cerr << STRATEGY_NAMES[method] << ": " << error.what() << std::endl;
+        offscreen_context::terminate();
+        return EXIT_FAILURE;
+      }
+      std::vector<glm::fmat4> models(objects);
+      std::vector<double> submit_times{};
+      std::vector<double> frame_times{};
+      for (unsigned frame = 0; frame < warmup + frames; ++frame) {
+        // the scene is animated the same for all strategies, outside the measured time
+        update_models(models, frame);
+        std::uint64_t const begin = cpu_profiler::now_ns();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        submit(method, state, models);
+        std::uint64_t const submitted = cpu_profiler::now_ns();
+        // waits for the gpu, so frame times include rendering
+        offscreen_context::swap_buffers();
+        std::uint64_t const end = cpu_profiler::now_ns();
+        if (frame >= warmup) {
+          submit_times.push_back(double(submitted - begin) * 1e-6);
+          frame_times.push_back(double(end - begin) * 1e-6);
+        }
+      }
+      destroy_state(state);
+      measurements.push_back(measurement{method, objects, median(submit_times), median(frame_times)});
+    }
+  }
+  offscreen_context::terminate();
+
+  // grouped by object count, to compare strategies for the same scene
+  std::cout << std::left << std::setw(10) << "objects" << std::setw(22) << "strategy" << std::right
+            << std::setw(12) << "submit ms" << std::setw(14) << "us/object" << std::setw(12) << "frame ms"
+            << std::setw(10) << "fps" << "\n" << std::fixed;
+  for (std::size_t objects : counts) {
+    for (auto const& result : measurements) {
+      if (result.objects != objects) {
+        continue;
+      }
+      std::cout << std::left << std::setw(10) << result.objects << std::setw(22) << STRATEGY_NAMES[result.method]
+                << std::right << std::setprecision(3) << std::setw(12) << result.submit_ms
+                << std::setw(14) << result.submit_ms * 1e3 / double(result.objects)
+                << std::setw(12) << result.frame_ms << std::setprecision(1)
+                << std::setw(10) << 1e3 / result.frame_ms << "\n";
+    }
+  }
+  std::cout.flush();
+  if (!write_report(report, renderer, frames, warmup, measurements)) {
+    std::cerr << "Writing " << report << " failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "written to " << report << std::endl;
+  return EXIT_SUCCESS;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void print_usage(char const* executable) {
+  std::cerr << "usage: " << executable << " [resource path] [--counts n,n,..] [--frames n] [--warmup n]"
+            << " [--report json file]" << std::endl;
+}
+
+static bool parse_counts(std::string const& text, std::vector<std::size_t>& counts) {
+  std::vector<std::size_t> parsed{};
+  std::istringstream values{text};
+  std::string value{};
+  while (std::getline(values, value, ',')) {
+    char* end = nullptr;
+    unsigned long const count = std::strtoul(value.c_str(), &end, 10);
+    if (end == value.c_str() || *end != '\0' || count == 0) {
+      return false;
+    }
+    parsed.push_back(std::size_t(count));
+  }
+  if (parsed.empty()) {
+    return false;
+  }
+  counts = parsed;
+  return true;
+}
+
+static bool is_supported(strategy method, bool compatibility) {
+  switch (method) {
+    case IMMEDIATE:
+      return compatibility;
+    case INSTANCED:
+      return utils::has_version(3, 3);
+    case UNIFORM_BUFFER:
+      return utils::has_version(3, 1);
+    case MULTI_DRAW_INDIRECT:
+      // base instances of indirect commands are only read from 4.2 on
+      return utils::has_version(4, 3)
+          || (utils::has_extension("GL_ARB_multi_draw_indirect") && utils::has_extension("GL_ARB_base_instance"));
+    default:
+      return true;
+  }
+}
+
+static submission_state create_state(strategy method, std::size_t objects, std::string const& resource_path,
+                                     glm::fmat4 const& view_projection) {
+  submission_state state{0, -1, -1, -1, 0, 0, 0, {}, {}, {}, 0, 0};
+  // fixed function pipeline, no buffers
+  if (method == IMMEDIATE) {
+    glUseProgram(0);
+    glBindVertexArray(0);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(glm::value_ptr(view_projection));
+    glMatrixMode(GL_MODELVIEW);
+    return state;
+  }
+
+  std::set<std::string> defines{};
+  if (method == INSTANCED || method == MULTI_DRAW_INDIRECT) {
+    defines.insert("INSTANCED");
+  }
+  else if (method == UNIFORM_BUFFER) {
+    defines.insert("UNIFORM_BLOCK");
+    defines.insert("MODELS_PER_BLOCK " + std::to_string(MODELS_PER_BLOCK));
+  }
+  state.program = shader_loader::program({{GL_VERTEX_SHADER, resource_path + "shaders/submission.vert"},
+                                          {GL_FRAGMENT_SHADER, resource_path + "shaders/vao.frag"}}, defines);
+  glUseProgram(state.program);
+  state.view_projection_location = utils::glGetUniformLocation(state.program, "ViewProjectionMatrix");
+  glUniformMatrix4fv(state.view_projection_location, 1, GL_FALSE, glm::value_ptr(view_projection));
+  if (method == UNIFORM_BUFFER) {
+    state.index_location = utils::glGetUniformLocation(state.program, "ModelIndex");
+    glUniformBlockBinding(state.program, glGetUniformBlockIndex(state.program, "ModelBlock"), 0);
+  }
+  else if (defines.empty()) {
+    state.model_location = utils::glGetUniformLocation(state.program, "ModelMatrix");
+  }
+
+  if (method == VBO || method == INDEXED) {
+    // vbo draws unindexed, so each object stores the triangle corners
+    std::vector<float> corners{};
+    for (GLushort index : CUBE_INDICES) {
+      corners.insert(corners.end(), CUBE_VERTICES.begin() + index * 6, CUBE_VERTICES.begin() + index * 6 + 6);
+    }
+    std::vector<float> const& vertices = method == VBO ? corners : CUBE_VERTICES;
+    state.object_bos.resize(objects);
+    glGenBuffers(GLsizei(objects), state.object_bos.data());
+    for (GLuint buffer : state.object_bos) {
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+    }
+    // core profiles draw nothing without a bound vertex array
+    glGenVertexArrays(1, &state.vertex_ao);
+    glBindVertexArray(state.vertex_ao);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    if (method == INDEXED) {
+      state.object_aos.resize(objects);
+      state.object_index_bos.resize(objects);
+      glGenVertexArrays(GLsizei(objects), state.object_aos.data());
+      glGenBuffers(GLsizei(objects), state.object_index_bos.data());
+      for (std::size_t i = 0; i < objects; ++i) {
+        glBindVertexArray(state.object_aos[i]);
+        bind_cube_attributes(state.object_bos[i]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.object_index_bos[i]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * CUBE_INDICES.size(), CUBE_INDICES.data(),
+                     GL_STATIC_DRAW);
+      }
+    }
+    return state;
+  }
+
+  // one shared cube for the remaining strategies
+  glGenVertexArrays(1, &state.vertex_ao);
+  glBindVertexArray(state.vertex_ao);
+  glGenBuffers(1, &state.vertex_bo);
+  bind_cube_attributes(state.vertex_bo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * CUBE_VERTICES.size(), CUBE_VERTICES.data(), GL_STATIC_DRAW);
+  glGenBuffers(1, &state.index_bo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, state.index_bo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLushort) * CUBE_INDICES.size(), CUBE_INDICES.data(), GL_STATIC_DRAW);
+
+  if (method == INSTANCED || method == MULTI_DRAW_INDIRECT) {
+    glGenBuffers(1, &state.matrix_bo);
+    glBindBuffer(GL_ARRAY_BUFFER, state.matrix_bo);
+    // a matrix attribute occupies four locations, one per column
+    for (GLuint column = 0; column < 4; ++column) {
+      glEnableVertexAttribArray(2 + column);
+      glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, GLsizei(sizeof(glm::fmat4)),
+                            (GLvoid*)uintptr_t(sizeof(glm::fvec4) * column));
+      glVertexAttribDivisor(2 + column, 1);
+    }
+  }
+  else if (method == UNIFORM_BUFFER) {
+    glGenBuffers(1, &state.matrix_bo);
+  }
+  if (method == MULTI_DRAW_INDIRECT) {
+    // commands do not change, only the matrices they select
+    std::vector<draw_elements_command> commands{};
+    for (std::size_t i = 0; i < objects; ++i) {
+      commands.push_back(draw_elements_command{GLuint(CUBE_INDICES.size()), 1, 0, 0, GLuint(i)});
+    }
+    glGenBuffers(1, &state.indirect_bo);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, state.indirect_bo);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(draw_elements_command) * commands.size(), commands.data(),
+                 GL_STATIC_DRAW);
+  }
+  return state;
+}
+
+static void destroy_state(submission_state& state) {
+  glBindVertexArray(0);
+  glUseProgram(0);
+  glDeleteProgram(state.program);
+  glDeleteVertexArrays(1, &state.vertex_ao);
+  glDeleteBuffers(1, &state.vertex_bo);
+  glDeleteBuffers(1, &state.index_bo);
+  glDeleteVertexArrays(GLsizei(state.object_aos.size()), state.object_aos.data());
+  glDeleteBuffers(GLsizei(state.object_bos.size()), state.object_bos.data());
+  glDeleteBuffers(GLsizei(state.object_index_bos.size()), state.object_index_bos.data());
+  glDeleteBuffers(1, &state.matrix_bo);
+  glDeleteBuffers(1, &state.indirect_bo);
+  state = submission_state{0, -1, -1, -1, 0, 0, 0, {}, {}, {}, 0, 0};
+}
+
+static void submit(strategy method, submission_state const& state, std::vector<glm::fmat4> const& models) {
+  GLsizei const index_count = GLsizei(CUBE_INDICES.size());
+  switch (method) {
+    case IMMEDIATE:
+      for (auto const& model : models) {
+        glLoadMatrixf(glm::value_ptr(model));
+        glBegin(GL_TRIANGLES);
+        for (GLushort index : CUBE_INDICES) {
+          glColor3fv(CUBE_VERTICES.data() + index * 6 + 3);
+          glVertex3fv(CUBE_VERTICES.data() + index * 6);
+        }
+        glEnd();
+      }
+      break;
+    case VBO:
+      for (std::size_t i = 0; i < models.size(); ++i) {
+        bind_cube_attributes(state.object_bos[i]);
+        glUniformMatrix4fv(state.model_location, 1, GL_FALSE, glm::value_ptr(models[i]));
+        glDrawArrays(GL_TRIANGLES, 0, index_count);
+      }
+      break;
+    case INDEXED:
+      for (std::size_t i = 0; i < models.size(); ++i) {
+        glBindVertexArray(state.object_aos[i]);
+        glUniformMatrix4fv(state.model_location, 1, GL_FALSE, glm::value_ptr(models[i]));
+        glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, NULL);
+      }
+      break;
+    case UNIFORM:
+      glBindVertexArray(state.vertex_ao);
+      for (auto const& model : models) {
+        glUniformMatrix4fv(state.model_location, 1, GL_FALSE, glm::value_ptr(model));
+        glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, NULL);
+      }
+      break;
+    case INSTANCED:
+    case MULTI_DRAW_INDIRECT:
+      glBindVertexArray(state.vertex_ao);
+      // orphan the previous contents instead of waiting for frames still reading them
+      glBindBuffer(GL_ARRAY_BUFFER, state.matrix_bo);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(glm::fmat4) * models.size(), NULL, GL_STREAM_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::fmat4) * models.size(), models.data());
+      if (method == INSTANCED) {
+        glDrawElementsInstanced(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, NULL, GLsizei(models.size()));
+      }
+      else {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, state.indirect_bo);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, NULL, GLsizei(models.size()), 0);
+      }
+      break;
+    case UNIFORM_BUFFER: {
+      glBindVertexArray(state.vertex_ao);
+      // whole blocks, so every bound range has the full declared size
+      std::size_t const blocks = (models.size() + MODELS_PER_BLOCK - 1) / MODELS_PER_BLOCK;
+      GLsizeiptr const block_size = GLsizeiptr(sizeof(glm::fmat4) * MODELS_PER_BLOCK);
+      glBindBuffer(GL_UNIFORM_BUFFER, state.matrix_bo);
+      glBufferData(GL_UNIFORM_BUFFER, block_size * GLsizeiptr(blocks), NULL, GL_STREAM_DRAW);
+      glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::fmat4) * models.size(), models.data());
+      for (std::size_t i = 0; i < models.size(); ++i) {
+        if (i % MODELS_PER_BLOCK == 0) {
+          glBindBufferRange(GL_UNIFORM_BUFFER, 0, state.matrix_bo, block_size * GLintptr(i / MODELS_PER_BLOCK),
+                            block_size);
+        }
+        glUniform1i(state.index_location, GLint(i % MODELS_PER_BLOCK));
+        glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, NULL);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// position to first, color to second attribute
+static void bind_cube_attributes(GLuint vertex_bo) {
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_bo);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, 0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (GLvoid*)uintptr_t(sizeof(float) * 3));
+}
+
+// cubes on a square grid filling the view, each spinning with its own phase
+static void update_models(std::vector<glm::fmat4>& models, unsigned frame) {
+  std::size_t const side = std::size_t(std::ceil(std::sqrt(double(models.size()))));
+  float const spacing = 2.4f / float(side);
+  for (std::size_t i = 0; i < models.size(); ++i) {
+    glm::fvec3 const position{(float(i % side) + 0.5f) * spacing - 1.2f, (float(i / side) + 0.5f) * spacing - 1.2f, -2.5f};
+    glm::fmat4 const translation{glm::translate(glm::fmat4{}, position)};
+    float const angle = 0.02f * float(frame) + float(i);
+    models[i] = glm::scale(glm::rotate(translation, angle, glm::fvec3{0.6f, 0.8f, 0.0f}), glm::fvec3{0.6f * spacing});
+  }
+}
+
+static double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  std::size_t const middle = values.size() / 2;
+  return values.size() % 2 == 1 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+static bool write_report(std::string const& file_name, std::string const& renderer, unsigned frames, unsigned warmup,
+                         std::vector<measurement> const& measurements) {
+  std::ofstream file{file_name};
+  file << "{\n  \"renderer\": \"" << utils::escape_json(renderer) << "\",\n  \"frames\": " << frames << ",\n  \"warmup_frames\": " << warmup
+       << ",\n  \"resolution\": [" << RESOLUTION.x << ", " << RESOLUTION.y << "],\n  \"results\": [";
+  for (std::size_t i = 0; i < measurements.size(); ++i) {
+    measurement const& result = measurements[i];
+    file << (i > 0 ? ",\n" : "\n")
+         << "    {\"strategy\": \"" << utils::escape_json(STRATEGY_NAMES[result.method]) << "\", \"objects\": "
+         << result.objects << ", \"submit_ms\": " << result.submit_ms << ", \"frame_ms\": " << result.frame_ms
+         << ", \"fps\": " << 1e3 / result.frame_ms << "}";
+  }
+  file << "\n  ]\n}\n";
+  return bool(file);
+}
@@ -0,0 +1,37 @@
+// splits high resolution images into the tile files read by virtual texturing
+// usage: vt_tiler image [image ...]
+// each image is written to a tile file next to it, e.g. 16k_earth_nightmap.jpg to 16k_earth_nightmap.jpg.vt
+// run once after adding or changing a map, solar_system samples the low resolution texture until then
+#include "virtual_texturing.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+static void print_usage(char const* executable);
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+  for (int i = 1; i < argc; ++i) {
+    std::string const image_file{argv[i]};
+    std::cout << "vt_tiler: building tiles of '" << image_file << "'" << std::endl;
+    try {
+      VirtualTexturing::buildTileFile(image_file, image_file + ".vt");
+    }
+    catch (std::exception const& error) {
+      std::cerr << error.what() << std::endl;
+      status = EXIT_FAILURE;
+    }
+  }
+  return status;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static void print_usage(char const* executable) {
+  std::cerr << "usage: " << executable << " image [image ...]" << std::endl;
+}
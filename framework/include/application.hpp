@@ -2,10 +2,21 @@
 #define APPLICATION_HPP
 
 #include "structs.hpp"
+#include "asset_cache.hpp"
+#include "benchmark.hpp"
+#include "camera_path.hpp"
+#include "cpu_profiler.hpp"
+#include "file_watcher.hpp"
+#include "frame_statistics.hpp"
+#include "gl_call_statistics.hpp"
+#include "gpu_profiler.hpp"
+#include "input_recording.hpp"
 
 #include <glm/gtc/type_precision.hpp>
 
 #include <map>
+#include <random>
+#include <set>
 
 struct GLFWwindow;
 // gpu representation of model
@@ -13,6 +24,9 @@ class Application {
  public:
   template<typename T>
   static void run(int argc, char* argv[], unsigned ver_major, unsigned ver_minor);
+  // render a camera path offscreen with a fixed timestep and write a json report, returns the exit status
+  template<typename T>
+  static int benchmark(int argc, char* argv[], unsigned ver_major, unsigned ver_minor);
 
   // allocate and initialize objects
   Application(std::string const& resource_path);
@@ -27,6 +41,16 @@ class Application {
   void mouse_callback(GLFWwindow* window, double pos_x, double pos_y);
   // recompile shaders form source files
   void reloadShaders(bool throwing);
+  // start background recompiles of changed shaders and swap in finished programs, called every frame
+  void updateShaders();
+  // select a permutation of the program, linked permutations are swapped in immediately, others once compiled
+  void setShaderDefines(std::string const& name, std::set<std::string> const& defines);
+  // record the times of a frame, the gpu time is taken from the gpu profiler once available
+  void recordFrame(GLFWwindow* window, double cpu_ms, double present_ms);
+  // scene time in seconds, read from the window clock or advanced in fixed steps
+  void setTime(double seconds);
+  // apply the recorded input of the current frame, returns false once the replay is finished
+  bool replayInput(GLFWwindow* window);
 
 // functions which are implemented in derived classes
   // update uniform locations and values
@@ -37,16 +61,38 @@ class Application {
   inline virtual void mouseCallback(double pos_x, double pos_y) {};
   // update framebuffer textures
   inline virtual void resizeCallback(unsigned width, unsigned height) {};
+  // place the camera
+  inline virtual void setView(glm::fmat4 const& view_transform) {};
   // draw all objects
   virtual void render() = 0;
 
  protected:
   void updateUniformLocations();
+  // special keys and input of derived classes, live or replayed
+  void handleKey(GLFWwindow* window, int key, int action, int mods);
 
   std::string m_resource_path; 
 
+  // shared programs, deleted with their last handle
+  AssetCache m_assets;
   // container for the shader programs
   std::map<std::string, shader_program> m_shaders{};
+  // reports saved shader sources
+  FileWatcher m_shader_watcher;
+  // gpu time of render passes, printed and written to gpu_profile.csv by pressing P
+  GpuProfiler m_gpu_profiler;
+  // frame time distributions, printed on exit and by pressing F
+  FrameStatistics m_frame_statistics;
+  // gpu profiler frames already recorded
+  std::uint64_t m_gpu_frames_recorded;
+  // second of the fps in the window title
+  std::uint64_t m_shown_second;
+  // scene time in seconds
+  double m_time;
+  // records input to INPUT_RECORD or replays INPUT_REPLAY, both environment variables
+  InputRecording m_input;
+  // generator for procedural content, seeded from the replay, RANDOM_SEED or a fixed default
+  std::mt19937 m_random;
 
   // resolution when 
   static const glm::uvec2 initial_resolution; 
@@ -54,9 +100,12 @@ class Application {
 };
 
 
+#include "offscreen_context.hpp"
 #include "utils.hpp"
 #include "window_handler.hpp"
 
+#include <iostream>
+
 template<typename T>
 void Application::run(int argc, char* argv[], unsigned ver_major, unsigned ver_minor) {  
 
@@ -74,23 +123,124 @@ void Application::run(int argc, char* argv[], unsigned ver_major, unsigned ver_m
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
     
+    cpu_profiler::set_thread_name("main");
+    double last_present_time = glfwGetTime();
     // rendering loop
     while (!glfwWindowShouldClose(window)) {
+      PROFILE_ZONE("frame");
+      double const frame_time = glfwGetTime();
+      // replays use the recorded scene time
+      application->setTime(application->m_input.beginFrame(frame_time));
       // query input
-      glfwPollEvents();
+      {
+        PROFILE_ZONE("glfwPollEvents");
+        glfwPollEvents();
+      }
+      // recorded input replaces live input, the run ends with the recording
+      if (!application->replayInput(window)) {
+        break;
+      }
+      // recompile edited shaders without stalling
+      application->updateShaders();
       // clear buffer
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
       // draw geometry
-      application->render();
+      {
+        PROFILE_ZONE("render");
+        application->m_gpu_profiler.beginFrame();
+        application->render();
+        application->m_gpu_profiler.endFrame();
+      }
+      // waiting for the swap is not counted as cpu time
+      double const submit_time = glfwGetTime();
       // swap draw buffer to front
-      glfwSwapBuffers(window);
-      // display fps
-      window_handler::show_fps(window);
+      {
+        PROFILE_ZONE("glfwSwapBuffers");
+        glfwSwapBuffers(window);
+      }
+      double const present_time = glfwGetTime();
+      // record frame times and display fps
+      application->recordFrame(window, (submit_time - frame_time) * 1000.0, (present_time - last_present_time) * 1000.0);
+      last_present_time = present_time;
+      // sampled error checks and cost of the error mode
+      window_handler::check_errors();
     }
 
     delete application;
     window_handler::close_and_quit(window, EXIT_SUCCESS);
 }
 
+template<typename T>
+int Application::benchmark(int argc, char* argv[], unsigned ver_major, unsigned ver_minor) {
+    benchmark::options settings{};
+    if (!benchmark::parse_options(argc, argv, settings)
+     || !offscreen_context::initialize(initial_resolution, ver_major, ver_minor)) {
+      return EXIT_FAILURE;
+    }
+
+    // counted calls are added to the report
+    if (gl_call_statistics::requested()) {
+      window_handler::set_call_statistics(true);
+    }
+    int status = EXIT_SUCCESS;
+    T* application = nullptr;
+    try {
+      CameraPath const path{CameraPath::load(settings.camera_path)};
+      application = new T{settings.resource_path};
+      application->reloadShaders(true);
+      glEnable(GL_DEPTH_TEST);
+      glDepthFunc(GL_LESS);
+      application->m_gpu_profiler.setWindow(settings.frames);
+
+      cpu_profiler::set_thread_name("main");
+      std::uint64_t const start_time = cpu_profiler::now_ns();
+      std::uint64_t last_present_time = start_time;
+      for (unsigned frame = 0; frame < settings.warmup + settings.frames; ++frame) {
+        PROFILE_ZONE("frame");
+        if (frame == settings.warmup) {
+          application->m_frame_statistics.reset();
+          application->m_gpu_profiler.reset();
+          gl_call_statistics::reset();
+        }
+        // fixed steps make the scene independent of the frame rate
+        application->setTime(double(frame) * settings.timestep);
+        // the path is flown once over the measured frames, warming up at its start
+        unsigned const measured = frame > settings.warmup ? frame - settings.warmup : 0;
+        application->setView(path.getTransform(settings.frames > 1 ? float(measured) / float(settings.frames - 1) : 0.0f));
+
+        std::uint64_t const frame_time = cpu_profiler::now_ns();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        {
+          PROFILE_ZONE("render");
+          application->m_gpu_profiler.beginFrame();
+          application->render();
+          application->m_gpu_profiler.endFrame();
+        }
+        std::uint64_t const submit_time = cpu_profiler::now_ns();
+        offscreen_context::swap_buffers();
+        std::uint64_t const present_time = cpu_profiler::now_ns();
+        application->recordFrame(nullptr, double(submit_time - frame_time) * 1e-6, double(present_time - last_present_time) * 1e-6);
+        last_present_time = present_time;
+      }
+
+      double const wall_seconds = double(cpu_profiler::now_ns() - start_time) * 1e-9;
+      if (benchmark::write_report(settings, application->m_frame_statistics, application->m_gpu_profiler, wall_seconds)) {
+        std::cout << "Benchmark report written to " << settings.report << std::endl;
+      }
+      else {
+        std::cerr << "Writing " << settings.report << " failed" << std::endl;
+        status = EXIT_FAILURE;
+      }
+    }
+    catch (std::exception const& error) {
+      std::cerr << "Benchmark failed: " << error.what() << std::endl;
+      status = EXIT_FAILURE;
+    }
+
+    delete application;
+    offscreen_context::terminate();
+    return status;
+}
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef OPENGL_FRAMEWORK_ASSET_CACHE_HPP
+#define OPENGL_FRAMEWORK_ASSET_CACHE_HPP
+
+#include "structs.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+/// shares linked programs between identical requests, only used on the gl thread
+/// programs are keyed by a hash of their stage sources, textures are shared by the TextureStreamer
+/// handles are reference counted, the program is deleted with its last handle
+class AssetCache {
+
+public:
+    AssetCache();
+    AssetCache(AssetCache const&) = delete;
+    AssetCache& operator=(AssetCache const&) = delete;
+
+    /// linked permutation of a program, the sources are read on every request to detect changes
+    /// restored from the binary cache if possible, throws if compiling or linking fails
+    std::shared_ptr<GLuint const> program(std::map<GLenum, std::string> const& stages,
+                                          std::set<std::string> const& defines = {});
+    /// directory for driver binaries of linked programs, created if missing, empty disables the cache
+    void setProgramCache(std::string const& directory);
+
+    /// hash of the preprocessed stage sources identifying a program, throws if a source cannot be read
+    /// the canonical paths of the stage files and their includes are stored in files if given
+    static std::uint64_t programHash(std::map<GLenum, std::string> const& stages, std::set<std::string> const& defines,
+                                     std::set<std::string>* files = nullptr);
+    /// shared or stored program with the hash, null if it has to be compiled
+    std::shared_ptr<GLuint const> findProgram(std::uint64_t hash);
+    /// share a program linked outside of the cache, its binary is stored if it is retrievable
+    std::shared_ptr<GLuint const> addProgram(std::uint64_t hash, GLuint program);
+    /// whether programs should be linked retrievable for the binary cache
+    bool getProgramsRetrievable() const;
+
+    /// programs with at least one handle
+    std::size_t size() const;
+    /// requests served from the cache and requests which loaded the asset
+    std::size_t getHits() const;
+    std::size_t getMisses() const;
+    /// programs restored from driver binaries instead of compiled
+    std::size_t getProgramBinaryHits() const;
+
+private:
+    // empty without binary cache
+    std::string programBinaryFile(std::uint64_t hash) const;
+    std::shared_ptr<GLuint const> shareProgram(std::uint64_t hash, GLuint program);
+
+    std::map<std::uint64_t, std::weak_ptr<GLuint const>> programs_;
+    std::size_t hits_;
+    std::size_t misses_;
+    std::string program_cache_;
+    std::size_t program_binary_hits_;
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <string>
+
+// forward declarations
+class FrameStatistics;
+class GpuProfiler;
+
+// settings and report of offscreen benchmark runs, see Application::benchmark
+namespace benchmark {
+  struct options {
+    std::string resource_path;
+    // measured frames, the camera path is flown once over them
+    unsigned frames;
+    // frames rendered before measuring, e.g. while textures stream in
+    unsigned warmup;
+    // scene time per frame in seconds
+    double timestep;
+    // camera path file, benchmarks/flyby.path in the resources if empty
+    std::string camera_path;
+    std::string report;
+  };
+
+  // reads "[resource path] [--frames n] [--warmup n] [--timestep s] [--path file] [--report file]"
+  // prints the usage and returns false for unknown or malformed arguments
+  bool parse_options(int argc, char* argv[], options& parsed);
+  // write settings, frame time percentiles and pass times as json, returns false if the file cannot be written
+  bool write_report(options const& settings, FrameStatistics const& statistics, GpuProfiler const& profiler,
+                    double wall_seconds);
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef BLOCK_COMPRESSION_HPP
+#define BLOCK_COMPRESSION_HPP
+
+#include "pixel_data.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// encoding of 8 bit images into gpu block compression formats
+namespace block_compression {
+  // bytes of a BC1 (DXT1) image, 8 bytes per 4x4 block
+  std::size_t bc1_size(std::size_t width, std::size_t height);
+  // encode a GL_RGB or GL_RGBA image to BC1, alpha is ignored
+  // blocks must hold bc1_size bytes
+  void encode_bc1(pixel_data const& image, std::uint8_t* blocks);
+}
+
+#endif
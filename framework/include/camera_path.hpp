@@ -0,0 +1,34 @@
+#ifndef OPENGL_FRAMEWORK_CAMERA_PATH_HPP
+#define OPENGL_FRAMEWORK_CAMERA_PATH_HPP
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <string>
+#include <vector>
+
+/// camera flight through key positions, interpolated with a catmull-rom spline
+/// the point looked at is interpolated the same way, so the camera can turn smoothly
+class CameraPath {
+
+public:
+    struct key {
+        glm::fvec3 position;
+        glm::fvec3 target;
+    };
+
+    CameraPath();
+
+    /// reads one key per line as "px py pz tx ty tz", '#' starts a comment
+    /// throws std::invalid_argument for missing or empty files and malformed lines
+    static CameraPath load(std::string const& file_name);
+
+    void addKey(glm::fvec3 const& position, glm::fvec3 const& target);
+    std::vector<key> const& getKeys() const;
+    /// camera transform at t between 0 and 1, keys are evenly spaced in t
+    glm::fmat4 getTransform(float t) const;
+
+private:
+    std::vector<key> keys_;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CLUSTER_CULLING_HPP
+#define CLUSTER_CULLING_HPP
+
+#include "structs.hpp"
+
+#include <glm/gtc/type_precision.hpp>
+
+#include <vector>
+
+// per-cluster frustum and backface culling for meshlet geometry
+namespace cluster_culling {
+  // clusters which survived culling, ready for submission
+  struct draw_list {
+    // draw commands were written to the indirect buffer by the gpu
+    bool indirect = false;
+    // index count and byte offset of visible clusters for cpu culling
+    std::vector<GLsizei> counts{};
+    std::vector<GLvoid const*> offsets{};
+    // base vertex of the mesh inside a shared vertex buffer, once per cluster
+    std::vector<GLint> base_vertices{};
+  };
+
+  // check if compute culling and indirect multi-draw are available
+  bool gpu_supported();
+  // upload cluster bounds and indirect commands of a model with meshlets
+  // commands are offset by the first index and base vertex of the object
+  void upload(model const& clustered_model, model_object& object);
+  // free cluster buffers
+  void free(model_object& object);
+
+  // cull clusters of object, camera position is given in model space
+  // uses the compute program if given, otherwise culls on the cpu
+  void cull(model_object const& object, glm::fmat4 const& model_view_projection, glm::fvec3 const& camera_position,
+            shader_program const* cull_program, draw_list& visible);
+  // draw visible clusters, expects the VAO and render program to be bound
+  void draw(model_object const& object, draw_list const& visible);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef OPENGL_FRAMEWORK_CPU_PROFILER_HPP
+#define OPENGL_FRAMEWORK_CPU_PROFILER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// scoped cpu time zones, recorded into a ring buffer per thread without locking
+// zones are only compiled in with CPU_PROFILER, otherwise PROFILE_ZONE expands to nothing
+namespace cpu_profiler {
+  // zones kept per thread, older zones are overwritten
+  static const std::size_t RING_SIZE = 1 << 16;
+
+  // records the time from construction to destruction, name must outlive the program, e.g. a literal
+  struct zone {
+    explicit zone(char const* name);
+    zone(zone const&) = delete;
+    zone& operator=(zone const&) = delete;
+    ~zone();
+
+    char const* name;
+    std::uint64_t begin_ns;
+  };
+
+  // nanoseconds since the first call
+  std::uint64_t now_ns();
+  // name shown for the calling thread, name must outlive the program, does nothing without CPU_PROFILER
+  void set_thread_name(char const* name);
+  // write the zones in the rings as chrome trace json, viewable in chrome://tracing and perfetto
+  // zones may be recorded meanwhile, returns false if the file cannot be written
+  bool write_chrome_trace(std::string const& file_name);
+}
+
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+
+#ifdef CPU_PROFILER
+// measure the enclosing scope
+#define PROFILE_ZONE(name) cpu_profiler::zone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__){name}
+#else
+#define PROFILE_ZONE(name) (void)0
+#endif
+
+#endif
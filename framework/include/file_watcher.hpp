@@ -0,0 +1,37 @@
+#ifndef OPENGL_FRAMEWORK_FILE_WATCHER_HPP
+#define OPENGL_FRAMEWORK_FILE_WATCHER_HPP
+
+#include "utils.hpp"
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+/// reports writes to watched files without blocking
+/// uses inotify on the directories of the files on linux and compares file stamps twice a second elsewhere
+class FileWatcher {
+
+public:
+    FileWatcher();
+    FileWatcher(FileWatcher const&) = delete;
+    FileWatcher& operator=(FileWatcher const&) = delete;
+    ~FileWatcher();
+
+    /// watch the file, files are identified by canonical path
+    void watch(std::string const& file_name);
+    /// canonical paths of watched files written since the last call, each reported once
+    std::vector<std::string> changed();
+
+private:
+    // watched files with their stamp at the last check
+    std::map<std::string, utils::file_stamp> files_;
+    std::chrono::steady_clock::time_point last_check_;
+#ifdef __linux__
+    int inotify_;
+    // watched directory of each watch descriptor
+    std::map<int, std::string> directories_;
+#endif
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef OPENGL_FRAMEWORK_FRAME_STATISTICS_HPP
+#define OPENGL_FRAMEWORK_FRAME_STATISTICS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// records frame times into fixed width histograms to report their distribution
+/// recording is constant time and never allocates, percentiles are accurate to the bucket width
+class FrameStatistics {
+
+public:
+    /// times recorded per frame
+    enum metric {
+        /// cpu time from polling input until the buffers are swapped
+        CPU,
+        /// gpu time of the frame, reported by the gpu profiler some frames later
+        GPU,
+        /// time between two buffer swaps returning
+        PRESENT,
+        METRICS
+    };
+
+    struct summary {
+        std::uint64_t samples;
+        double p50_ms;
+        double p90_ms;
+        double p99_ms;
+        double max_ms;
+        /// samples taking more than twice the median
+        std::uint64_t hitches;
+    };
+
+    /// times above range_ms are counted in the last bucket, their maximum is kept exactly
+    explicit FrameStatistics(double bucket_ms = 0.05, double range_ms = 250.0);
+
+    void record(metric type, double milliseconds);
+    /// summary of all samples recorded since the last reset
+    summary getSummary(metric type) const;
+    /// frames presented within the last full second
+    unsigned getFramesPerSecond() const;
+    /// full seconds presented so far, to update displays once per second
+    std::uint64_t getSeconds() const;
+    /// print a table of the summaries
+    void print(std::ostream& stream) const;
+    void reset();
+
+private:
+    struct histogram {
+        std::vector<std::uint64_t> buckets;
+        std::uint64_t samples;
+        double max_ms;
+    };
+
+    // upper bound of the bucket holding the percentile, clamped to the maximum
+    double percentile(histogram const& times, double fraction) const;
+
+    double bucket_ms_;
+    histogram histograms_[METRICS];
+    // presents in the current second
+    unsigned second_frames_;
+    double second_ms_;
+    unsigned frames_per_second_;
+    std::uint64_t seconds_;
+};
+
+#endif
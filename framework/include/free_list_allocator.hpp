@@ -0,0 +1,35 @@
+#ifndef OPENGL_FRAMEWORK_FREE_LIST_ALLOCATOR_HPP
+#define OPENGL_FRAMEWORK_FREE_LIST_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <map>
+
+/// manages ranges of a fixed-size pool, e.g. vertices or indices of a buffer
+/// first-fit search over an ordered free list, neighbouring ranges are merged on free
+class FreeListAllocator {
+
+public:
+    /// returned by allocate if no free range is large enough
+    static const std::size_t INVALID;
+
+    explicit FreeListAllocator(std::size_t capacity = 0);
+
+    /// reserve size units, returns offset of the range or INVALID
+    /// size 0 reserves nothing and returns 0, which may be the offset of another range
+    std::size_t allocate(std::size_t size);
+    /// return a range previously handed out by allocate
+    void free(std::size_t offset, std::size_t size);
+
+    std::size_t getCapacity() const;
+    std::size_t getUsed() const;
+    /// size of the largest range which can currently be allocated
+    std::size_t getLargestFree() const;
+
+private:
+    // free ranges, offset mapped to size
+    std::map<std::size_t, std::size_t> free_ranges_;
+    std::size_t capacity_;
+    std::size_t used_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef OPENGL_FRAMEWORK_GEOMETRY_ARENA_HPP
+#define OPENGL_FRAMEWORK_GEOMETRY_ARENA_HPP
+
+#include "structs.hpp"
+#include "free_list_allocator.hpp"
+#include "vertex_layout.hpp"
+
+#include <cstddef>
+#include <map>
+
+/// one large vertex and index buffer for all meshes of a vertex layout
+/// meshes are suballocated and addressed by base vertex and first index,
+/// so switching between them needs no buffer or VAO rebinds
+class GeometryArena {
+
+public:
+    /// empty arena without gpu storage
+    GeometryArena();
+    /// create storage for the given number of vertices and indices of a layout
+    template<typename Layout>
+    static GeometryArena create(std::size_t vertex_capacity, std::size_t index_capacity);
+
+    GeometryArena(GeometryArena&& other);
+    GeometryArena& operator=(GeometryArena&& other);
+    GeometryArena(GeometryArena const&) = delete;
+    GeometryArena& operator=(GeometryArena const&) = delete;
+    ~GeometryArena();
+
+    /// reserve ranges for a mesh and upload its data
+    /// data may be null to only reserve, e.g. for mapping
+    /// without indices the mesh is drawn with glDrawArrays, meshes without vertices are rejected
+    model_object allocate(GLvoid const* vertices, std::size_t vertex_num,
+                          GLuint const* indices, std::size_t index_num, GLenum draw_mode);
+    /// reserve and upload a model, its attributes must match the layout
+    model_object allocate(model const& source, GLenum draw_mode = GL_TRIANGLES);
+    /// return the ranges of a mesh to the arena
+    void free(model_object& object);
+
+    /// map the ranges of a mesh for writing, indices are relative to its first vertex
+    void map(model_object const& object, GLvoid*& vertices, GLuint*& indices);
+    void unmap();
+
+    GLuint getVertexArray() const;
+    std::size_t getVertexCapacity() const;
+    std::size_t getIndexCapacity() const;
+    std::size_t getUsedVertices() const;
+    std::size_t getUsedIndices() const;
+
+private:
+    GeometryArena(GLsizei vertex_stride, void (*apply_layout)(bool, GLuint),
+                  std::size_t vertex_capacity, std::size_t index_capacity);
+    void release();
+
+    GLsizei vertex_stride_;
+    GLuint vertex_AO_;
+    GLuint vertex_BO_;
+    GLuint element_BO_;
+    FreeListAllocator vertices_;
+    FreeListAllocator indices_;
+    // vertex number of each mesh, mapped to its base vertex
+    std::map<GLint, std::size_t> vertex_ranges_;
+    bool indices_mapped_;
+};
+
+template<typename Layout>
+GeometryArena GeometryArena::create(std::size_t vertex_capacity, std::size_t index_capacity) {
+    return GeometryArena{Layout::stride, &apply_vertex_layout<Layout>, vertex_capacity, index_capacity};
+}
+
+#endif
@@ -2,6 +2,8 @@
 #define OPENGL_FRAMEWORK_GEOMETRY_NODE_HPP
 
 #include "model.hpp"
+#include "cluster_culling.hpp"
+#include "gpu_profiler.hpp"
 #include <node.hpp>
 #include <utility>
 
@@ -9,6 +11,18 @@ class GeometryNode : public Node {
 private:
     model_object geometry_;
     texture_object texture_;
+    // replaces texture_ if set, sampled through its page table
+    virtual_texture_object virtual_texture_;
+    // reused storage for clusters surviving culling
+    cluster_culling::draw_list visible_clusters_;
+    // projection of the active camera, required for culling
+    static glm::mat4 projection_matrix_;
+    // height of the framebuffer, required for the projected size of textures
+    static float viewport_height_;
+    // measures stars and orbits if set
+    static GpuProfiler* profiler_;
+    // scene time in seconds, spins the planets
+    static double time_;
 
 public:
     //default constructor
@@ -17,7 +31,8 @@ public:
     GeometryNode(std::shared_ptr<Node> parent, std::string const& name):
     Node::Node(std::move(parent), name),
     geometry_{},
-    texture_{}
+    texture_{},
+    virtual_texture_{}
     {};
 
     GeometryNode(std::shared_ptr<Node> parent,
@@ -25,7 +40,8 @@ public:
                  model_object geometry):
     Node::Node(std::move(parent), name),
     geometry_{geometry},
-    texture_{}
+    texture_{},
+    virtual_texture_{}
     {};
 
     GeometryNode(std::shared_ptr<Node> parent,
@@ -34,7 +50,8 @@ public:
                  glm::vec3 const& color):
     Node::Node(std::move(parent), name, color),
     geometry_{geometry},
-    texture_{}
+    texture_{},
+    virtual_texture_{}
     {};
 
     GeometryNode(std::shared_ptr<Node> parent,
@@ -43,7 +60,8 @@ public:
                  texture_object texture):
     Node::Node(std::move(parent), name),
     geometry_{geometry},
-    texture_{texture}
+    texture_{texture},
+    virtual_texture_{}
     {};
 
     //get geometry variable
@@ -55,6 +73,15 @@ public:
 
     void setTexture(const texture_object &texture);
 
+    const virtual_texture_object &getVirtualTexture() const;
+
+    void setVirtualTexture(const virtual_texture_object &virtual_texture);
+
+    static void setProjectionMatrix(const glm::mat4 &projection_matrix);
+    static void setViewportHeight(float viewport_height);
+    static void setProfiler(GpuProfiler* profiler);
+    static void setTime(double seconds);
+
     void renderPlanet(const std::map<std::string, shader_program> &m_shaders,
                       const glm::mat4 &m_view_transform) const;
     void renderStars(const std::map<std::string, shader_program> &m_shaders,
@@ -62,7 +89,7 @@ public:
     void renderOrbit(const std::map<std::string, shader_program> &m_shaders,
                                    const glm::mat4 &m_view_transform) const;
     void renderEnterprise(const std::map<std::string, shader_program> &m_shaders,
-                          const glm::mat4 &m_view_transform) const;
+                          const glm::mat4 &m_view_transform);
 
     //render function for geometry node
     void renderNode(std::map<std::string, shader_program> const& m_shaders, glm::mat4 const& m_view_transform) override;
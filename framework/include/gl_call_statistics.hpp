@@ -0,0 +1,54 @@
+#ifndef GL_CALL_STATISTICS_HPP
+#define GL_CALL_STATISTICS_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace glbinding {
+  struct FunctionCall;
+}
+
+// gl calls per function and frame, redundant binds and uploaded bytes, counted through glbinding callbacks
+// only calls made while the callbacks are installed are seen, see window_handler::set_call_statistics
+namespace gl_call_statistics {
+  struct counters {
+    std::uint64_t calls;
+    // glUseProgram, glBindVertexArray, glBindTexture and glBindTextureUnit of the bound object
+    std::uint64_t redundant_binds;
+    // glBufferData and glBufferSubData, also of named buffers
+    // written ranges of glMapBufferRange when unmapped, only the flushed ones with explicit flushing
+    // persistent mappings and glMapBuffer are not counted, their size is unknown to the callbacks
+    std::uint64_t buffer_bytes;
+    // glTexImage, glTexSubImage and their compressed versions, from memory or an unpack buffer
+    std::uint64_t texture_bytes;
+    // glUniform of scalars, vectors and float matrices
+    std::uint64_t uniform_bytes;
+  };
+
+  struct function_calls {
+    char const* name;
+    std::uint64_t calls;
+  };
+
+  // whether the GL_CALL_STATISTICS environment variable is set to 1
+  bool requested();
+  // set or clear the callbacks of the bind and upload functions, bindings are unknown until bound again
+  void track(bool enable);
+  // count a call, from the after callback of every function
+  void count(glbinding::FunctionCall const& call);
+  // the counted calls become the last frame and are added to the totals
+  void end_frame();
+
+  counters const& get_last_frame();
+  // calls per function of the last frame, most frequent first
+  std::vector<function_calls> get_last_frame_functions();
+  // sums over the frames since the last reset
+  counters const& get_totals();
+  std::uint64_t get_frames();
+  // print the last frame, the average frame and the most called functions
+  void print(std::ostream& stream);
+  void reset();
+}
+
+#endif
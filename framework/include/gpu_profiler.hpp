@@ -0,0 +1,110 @@
+#ifndef OPENGL_FRAMEWORK_GPU_PROFILER_HPP
+#define OPENGL_FRAMEWORK_GPU_PROFILER_HPP
+
+#include <glbinding/gl/types.h>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// measures gpu time of named passes with timestamp queries
+/// queries of a frame are read when its pool is reused FRAMES frames later, so reading never waits for the gpu
+/// scopes may nest, the scopes of a pass within a frame are summed
+class GpuProfiler {
+
+public:
+    /// frames recorded before their queries are read
+    static const std::size_t FRAMES = 2;
+
+    /// rolling statistics over the last window frames
+    struct pass_statistics {
+        std::string name;
+        std::size_t samples;
+        double min_ms;
+        double avg_ms;
+        double max_ms;
+    };
+
+    /// measures a pass until it goes out of scope, does nothing without profiler
+    class Scope {
+    public:
+        Scope(GpuProfiler* profiler, char const* name);
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+        ~Scope();
+
+    private:
+        GpuProfiler* profiler_;
+        std::size_t marker_;
+    };
+
+    /// disabled without GL 3.3 or ARB_timer_query
+    explicit GpuProfiler(std::size_t window = 120);
+    GpuProfiler(GpuProfiler const&) = delete;
+    GpuProfiler& operator=(GpuProfiler const&) = delete;
+    ~GpuProfiler();
+
+    bool supported() const;
+    /// read the frame recorded into this pool and start recording, measured as pass "frame"
+    void beginFrame();
+    void endFrame();
+    /// start a pass, returns the marker to end it with
+    std::size_t begin(char const* name);
+    void end(std::size_t marker);
+
+    /// frames the statistics are computed over
+    void setWindow(std::size_t window);
+    /// drop the statistics, e.g. after warming up, frames still in flight are counted afterwards
+    void reset();
+
+    /// passes in order of first use
+    std::vector<pass_statistics> getStatistics() const;
+    /// frames dropped because their queries were not available when the pool was reused
+    std::size_t getDroppedFrames() const;
+    /// frames whose queries were read so far
+    std::uint64_t getFramesRead() const;
+    /// gpu time of the last frame read, FRAMES frames behind the current one
+    double getLastFrameMs() const;
+    /// write the statistics as comma separated values, returns false if the file cannot be written
+    bool writeCsv(std::string const& file_name) const;
+
+private:
+    // scope recorded in a frame, its timestamps are two consecutive queries
+    struct marker {
+        std::size_t pass;
+        std::size_t query;
+    };
+
+    struct frame_pool {
+        std::vector<gl::GLuint> queries;
+        std::vector<marker> markers;
+        std::size_t used_queries;
+    };
+
+    struct pass {
+        std::string name;
+        // milliseconds of the last window frames the pass was used in
+        std::deque<double> samples;
+    };
+
+    std::size_t findPass(char const* name);
+    // next query of the current pool, written later
+    std::size_t reserve();
+    // time stamp into the next query of the current pool
+    std::size_t query();
+    void readFrame(frame_pool& pool);
+
+    bool supported_;
+    std::size_t window_;
+    std::uint64_t frame_;
+    bool recording_;
+    frame_pool pools_[FRAMES];
+    std::vector<pass> passes_;
+    std::size_t frame_marker_;
+    std::size_t dropped_frames_;
+    std::uint64_t frames_read_;
+    double last_frame_ms_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef OPENGL_FRAMEWORK_INPUT_RECORDING_HPP
+#define OPENGL_FRAMEWORK_INPUT_RECORDING_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// records input events and the scene time of every frame into a text file and replays them frame-exactly
+/// the random seed of procedural content is stored as well, so a replay renders the same frames
+class InputRecording {
+
+public:
+    enum mode {
+        OFF,
+        RECORD,
+        REPLAY
+    };
+
+    struct event {
+        enum type_t {
+            KEY,
+            MOUSE
+        };
+        type_t type;
+        // key, action and mods of key events
+        int key;
+        int action;
+        int mods;
+        // cursor position of mouse events
+        double x;
+        double y;
+    };
+
+    InputRecording();
+
+    /// start writing frames and events, returns false if the file cannot be written
+    bool record(std::string const& file_name, std::uint32_t seed);
+    /// read a recording, throws std::invalid_argument for missing or malformed files
+    void replay(std::string const& file_name);
+    mode getMode() const;
+    /// seed stored in the replayed recording or passed to record
+    std::uint32_t getSeed() const;
+
+    /// start the next frame, returns the scene time, which is taken from the recording when replaying
+    double beginFrame(double time);
+    /// false once all recorded frames were replayed
+    bool hasFrame() const;
+    /// recorded events of the current frame when replaying
+    std::vector<event> const& getEvents() const;
+
+    /// write an event into the current frame, does nothing unless recording
+    void recordKey(int key, int action, int mods);
+    void recordMouse(double x, double y);
+
+private:
+    struct frame {
+        double time;
+        std::vector<event> events;
+    };
+
+    mode mode_;
+    std::uint32_t seed_;
+    std::ofstream file_;
+    std::vector<frame> frames_;
+    // frame started last, counted from one
+    std::size_t frame_;
+};
+
+#endif
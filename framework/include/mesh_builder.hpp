@@ -0,0 +1,104 @@
+#ifndef MESH_BUILDER_HPP
+#define MESH_BUILDER_HPP
+
+#include "structs.hpp"
+#include "vertex_layout.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+// creates gpu meshes from vertex data with a compile-time layout
+namespace mesh_builder {
+  // check if VAOs can use separate attribute formats and buffer bindings
+  bool separate_format_supported();
+
+  // VAO holding the attribute formats of a layout, shared by all its meshes
+  template<typename Layout>
+  GLuint shared_vertex_array();
+
+  // create buffers and VAO for vertices of the given layout
+  // data may be null to only allocate storage, e.g. for mapping
+  // without indices the mesh is drawn with glDrawArrays
+  template<typename Layout>
+  model_object create(GLvoid const* vertices, std::size_t vertex_num,
+                      GLuint const* indices, std::size_t index_num, GLenum draw_mode);
+
+  // create mesh from a model, its attributes must match the layout
+  template<typename Layout>
+  model_object create(model const& source, GLenum draw_mode = GL_TRIANGLES);
+
+  // create mesh from tightly packed vertex components
+  template<typename Layout>
+  model_object create(std::vector<GLfloat> const& vertices, std::vector<GLuint> const& indices, GLenum draw_mode);
+
+  // bind VAO and, for shared VAOs, the mesh buffers
+  void bind(model_object const& object);
+  // draw the bound mesh, offset by its base vertex and first index
+  void draw(model_object const& object);
+  // free buffers and the VAO if it is not shared, arena meshes are freed by their arena
+  void free(model_object& object);
+
+  // create vertex and index buffers, without indices only the vertex buffer
+  void create_buffers(model_object& object, GLvoid const* vertices, GLsizeiptr vertex_bytes,
+                      GLuint const* indices, std::size_t index_num);
+}
+
+namespace mesh_builder {
+
+template<typename Layout>
+GLuint shared_vertex_array() {
+  // one VAO per layout and context
+  static GLuint vertex_AO = 0;
+  if (vertex_AO == 0) {
+    glGenVertexArrays(1, &vertex_AO);
+    glBindVertexArray(vertex_AO);
+    apply_vertex_layout<Layout>(true);
+  }
+  return vertex_AO;
+}
+
+template<typename Layout>
+model_object create(GLvoid const* vertices, std::size_t vertex_num,
+                    GLuint const* indices, std::size_t index_num, GLenum draw_mode) {
+  model_object object{};
+  object.draw_mode = draw_mode;
+  object.num_elements = GLsizei(index_num > 0 ? index_num : vertex_num);
+
+  if (separate_format_supported()) {
+    // formats are already stored in the shared VAO, only buffers are needed
+    object.vertex_AO = shared_vertex_array<Layout>();
+    object.vertex_stride = Layout::stride;
+    glBindVertexArray(object.vertex_AO);
+    create_buffers(object, vertices, GLsizeiptr(Layout::stride) * GLsizeiptr(vertex_num), indices, index_num);
+    // keep buffers of the shared VAO unbound between meshes
+    glBindVertexArray(0);
+  }
+  else {
+    glGenVertexArrays(1, &object.vertex_AO);
+    glBindVertexArray(object.vertex_AO);
+    create_buffers(object, vertices, GLsizeiptr(Layout::stride) * GLsizeiptr(vertex_num), indices, index_num);
+    apply_vertex_layout<Layout>(false);
+  }
+
+  return object;
+}
+
+template<typename Layout>
+model_object create(model const& source, GLenum draw_mode) {
+  if (source.vertex_bytes != Layout::stride) {
+    throw std::logic_error("mesh_builder: model attributes do not match vertex layout");
+  }
+  return create<Layout>(source.data.data(), source.vertex_num,
+                        source.indices.empty() ? nullptr : source.indices.data(), source.indices.size(), draw_mode);
+}
+
+template<typename Layout>
+model_object create(std::vector<GLfloat> const& vertices, std::vector<GLuint> const& indices, GLenum draw_mode) {
+  std::size_t vertex_num = vertices.size() * sizeof(GLfloat) / std::size_t(Layout::stride);
+  return create<Layout>(vertices.data(), vertex_num,
+                        indices.empty() ? nullptr : indices.data(), indices.size(), draw_mode);
+}
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef OPENGL_FRAMEWORK_MICRO_BENCHMARK_HPP
+#define OPENGL_FRAMEWORK_MICRO_BENCHMARK_HPP
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// measures cases over repetitions after warmup runs, reporting median and median absolute deviation
+/// both are robust against the outliers of a busy machine, unlike mean and standard deviation
+class MicroBenchmark {
+
+public:
+    struct result {
+        std::string name;
+        std::size_t repetitions;
+        double median_us;
+        /// median absolute deviation from the median
+        double mad_us;
+        double min_us;
+    };
+
+    MicroBenchmark(std::size_t warmup = 2, std::size_t repetitions = 15);
+
+    /// measure function once per run, setup is called before every run and not measured
+    void run(std::string const& name, std::function<void()> const& function,
+             std::function<void()> const& setup = std::function<void()>{});
+    std::vector<result> const& getResults() const;
+
+    /// print a table of the results
+    void print(std::ostream& stream) const;
+    /// write the results as json, returns false if the file cannot be written
+    bool writeJson(std::string const& file_name) const;
+    /// compare with results written by writeJson, printing the ratio of the medians per case
+    /// a case regressed if its median grew by more than tolerance and three deviations of both runs
+    /// returns the number of regressed cases, throws std::invalid_argument if the baseline cannot be read
+    std::size_t compare(std::string const& baseline_file, std::ostream& stream, double tolerance = 0.1) const;
+
+    /// keeps the compiler from dropping computations whose results are unused
+    template<typename T>
+    static void keep(T const& value) {
+        keepAddress(&value);
+    }
+
+private:
+    static void keepAddress(void const* address);
+
+    std::size_t warmup_;
+    std::size_t repetitions_;
+    std::vector<result> results_;
+};
+
+#endif
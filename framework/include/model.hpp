@@ -3,11 +3,29 @@
 
 #include <glbinding/gl/types.h>
 
+#include <glm/gtc/type_precision.hpp>
+
 #include <map>
 #include <vector>
 // use gl definitions from glbinding 
 using namespace gl;
 
+// cluster of neighbouring triangles with bounds for culling
+struct meshlet {
+  // index range of the triangles in the model index buffer
+  GLuint first_index;
+  GLuint index_count;
+  // number of unique vertices referenced by the triangles
+  GLuint vertex_count;
+  // bounding sphere in model space
+  glm::fvec3 center;
+  float radius;
+  // normal cone, cluster faces away from viewer at p if
+  // dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius
+  glm::fvec3 cone_axis;
+  float cone_cutoff;
+};
+
 // holds vertex information and triangle indices
 struct model {
 
@@ -56,6 +74,8 @@ struct model {
 
   std::vector<GLfloat> data;
   std::vector<GLuint> indices;
+  // triangle clusters covering consecutive ranges of the indices
+  std::vector<meshlet> meshlets;
   // byte offsets of individual element attributes
   std::map<attrib_flag_t, GLvoid*> offsets;
   // size of one vertex element in bytes
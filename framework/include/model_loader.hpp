@@ -5,10 +5,35 @@
 
 #include "tiny_obj_loader.h"
 
+#include <cstddef>
+
 namespace model_loader {
 
+// tessellation schemes for procedurally generated unit spheres
+enum sphere_type {
+  // latitude/longitude grid, subdivisions is the number of rings
+  UV_SPHERE,
+  // icosahedron, every face edge is split into subdivisions segments
+  ICO_SPHERE,
+  // normalized cube, every face edge is split into subdivisions segments
+  CUBE_SPHERE
+};
+
 model obj(std::string const& path, model::attrib_flag_t import_attribs = model::POSITION);
 
+// generate unit sphere, attribute layout matches obj()
+model sphere(sphere_type type, unsigned subdivisions, model::attrib_flag_t import_attribs = model::POSITION);
+// write sphere into preallocated storage, e.g. a mapped buffer
+// vertex_data must hold sphere_vertex_num() vertices of the requested layout, indices sphere_index_num() entries
+void sphere(sphere_type type, unsigned subdivisions, model::attrib_flag_t import_attribs, GLfloat* vertex_data, GLuint* indices);
+// number of vertices and indices emitted for the given tessellation
+std::size_t sphere_vertex_num(sphere_type type, unsigned subdivisions);
+std::size_t sphere_index_num(sphere_type type, unsigned subdivisions);
+
+// split triangles into clusters with bounding spheres and normal cones
+// clusters are consecutive ranges of the indices in file order, the indices are not modified
+void generate_meshlets(model& model, unsigned max_vertices = 64, unsigned max_triangles = 124);
+
 }
 
 #endif
\ No newline at end of file
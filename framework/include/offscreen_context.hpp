@@ -0,0 +1,20 @@
+#ifndef OFFSCREEN_CONTEXT_HPP
+#define OFFSCREEN_CONTEXT_HPP
+
+#include <glm/gtc/type_precision.hpp>
+
+// gl context without window or display, e.g. for benchmarks on mesa llvmpipe
+// uses an egl pbuffer, on the surfaceless platform if the driver supports it
+// only available if EGL was found at configure time
+namespace offscreen_context {
+  // create the context and make it current, returns false if not possible
+  // the pbuffer of the given resolution is the default framebuffer
+  // a compatibility profile keeps the fixed function pipeline available in versions from 3.2
+  bool initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool compatibility = false);
+  // finish the frame, waits for the gpu so frame times include rendering
+  void swap_buffers();
+  // free context and display
+  void terminate();
+}
+
+#endif
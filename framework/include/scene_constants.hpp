@@ -2,6 +2,7 @@
 #define OPENGL_FRAMEWORK_SCENE_CONSTANTS_HPP
 
 #include "model.hpp"
+#include <map>
 #include <ostream>
 
 
@@ -80,6 +81,11 @@ std::vector<std::string> PLANET_TEXTURE {
         "2k_pluto_1.jpg"
 };
 
+// high resolution maps sampled through virtual texturing, used instead of PLANET_TEXTURE if present
+std::map<std::string, std::string> PLANET_VIRTUAL_TEXTURE {
+        {"Earth", "16k_earth_nightmap.jpg"}
+};
+
 #pragma endregion
 
 
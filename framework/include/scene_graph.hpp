@@ -3,6 +3,10 @@
 
 #include <iostream>
 #include "node.hpp"
+#include "pixel_data.hpp"
+#include "texture_loader.hpp"
+#include "texture_streamer.hpp"
+#include "virtual_texturing.hpp"
 
 class SceneGraph {
 private:
@@ -27,7 +31,13 @@ public:
     ~SceneGraph();
 };
 
-SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_objects, std::string const& resource_path);
+SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_objects, std::string const& resource_path,
+                            TextureStreamer& textureStreamer, VirtualTexturing& virtualTexturing);
+void freeSolarSystem(SceneGraph& sceneGraph, TextureStreamer& textureStreamer);
+texture_object setupTexture(std::string const& textureFileName);
+texture_object setupTexture(pixel_data const& pixelData);
+texture_object setupTexture(texture_loader::mip_chain const& mipChain);
 texture_object setupSkybox(std::string const& variant);
+void freeTexture(texture_object& texture);
 
 #endif //OPENGL_FRAMEWORK_SCENE_GRAPH_HPP
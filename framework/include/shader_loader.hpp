@@ -2,16 +2,45 @@
 #define SHADER_LOADER_HPP
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <glbinding/gl/enum.h>
 using namespace gl;
 
 namespace shader_loader {
+  // read a source, resolve #include "file" relative to the including file and insert the defines after #version
+  // each file is included once per source, #line numbers the stage file 0 and included files in order
+  // the canonical paths of all read files are appended to files
+  std::string preprocess(std::string const& file_path, std::set<std::string> const& defines,
+                         std::vector<std::string>& files);
+  // identifies a permutation, "NAME" or "NAME value" defines joined in order
+  std::string permutation_key(std::set<std::string> const& defines);
+
   // compile shader
-  unsigned shader(std::string const& file_path, GLenum shader_type);
+  unsigned shader(std::string const& file_path, GLenum shader_type, std::set<std::string> const& defines = {});
   // create program from given list of stages
-  unsigned program(std::map<GLenum, std::string> const&);
+  // retrievable programs can be stored with save_binary
+  unsigned program(std::map<GLenum, std::string> const&, std::set<std::string> const& defines = {},
+                   bool retrievable = false);
+
+  // check if the driver compiles and links on its own threads
+  bool parallel_compile_supported();
+  // start compiling and linking without waiting for the driver, errors are reported by end_program
+  unsigned begin_program(std::map<GLenum, std::string> const&, std::set<std::string> const& defines = {},
+                         bool retrievable = false);
+  // check if the driver finished a started program, always true without parallel compilation
+  bool program_completed(unsigned program);
+  // check compilation and linking of a started program, frees it and throws if unsuccessful
+  void end_program(unsigned program, std::map<GLenum, std::string> const&);
+
+  // check if programs can be stored and restored as driver binaries
+  bool binary_supported();
+  // restore a program stored with save_binary, 0 if missing or rejected by the driver
+  unsigned load_binary(std::string const& file_path);
+  // store the driver binary of a retrievable program, fails silently
+  void save_binary(unsigned program, std::string const& file_path);
 }
 
 #endif
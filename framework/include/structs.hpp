@@ -1,8 +1,14 @@
 #ifndef STRUCTS_HPP
 #define STRUCTS_HPP
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 #include <glbinding/gl/gl.h>
+#include "model.hpp"
 // use gl definitions from glbinding 
 using namespace gl;
 
@@ -18,6 +24,34 @@ struct model_object {
   GLenum draw_mode = GL_NONE;
   // indices number, if EBO exists
   GLsizei num_elements = 0;
+  // vertex size if the VAO is shared and the buffers must be bound per mesh
+  GLsizei vertex_stride = 0;
+  // position of the mesh inside buffers shared with other meshes
+  GLint base_vertex = 0;
+  GLuint first_index = 0;
+  // buffers belong to a geometry arena and must not be deleted with the mesh
+  bool suballocated = false;
+  // cluster bounds and indirect draw commands, if geometry is clustered
+  GLuint cluster_BO = 0;
+  GLuint command_BO = 0;
+  // cpu copy of clusters, for culling without compute shaders
+  std::shared_ptr<std::vector<meshlet> const> meshlets{};
+};
+
+// mip levels of a streamed texture, only accessed on the gl thread
+struct texture_residency {
+  // size of level 0 and number of levels of the full chain, 0 until the texture is loaded
+  GLint width = 0;
+  GLint num_levels = 0;
+  // finest level on the gpu, sampling is clamped to it, equals num_levels while nothing is resident
+  GLint base_level = 0;
+  // finest level needed for the current view, set by the renderer
+  GLint requested_level = 0;
+  // set by the renderer when drawing, turned into the last use frame by the streamer
+  bool used = false;
+  std::uint64_t last_use_frame = 0;
+  // video memory of all defined levels
+  std::size_t bytes = 0;
 };
 
 // gpu representation of texture
@@ -26,6 +60,26 @@ struct texture_object {
   GLuint handle = 0;
   // binding point
   GLenum target = GL_ZERO;
+  // residency of streamed textures, shared by all copies
+  std::shared_ptr<texture_residency> residency{};
+};
+
+// texture sampled through a page table, only tiles seen on screen are resident
+struct virtual_texture_object {
+  // identifies the texture in the feedback pass, 0 for none
+  GLuint id = 0;
+  // finest resident tile per virtual tile, one mip level per texture level
+  GLuint page_table = 0;
+  // physical tiles of all virtual textures
+  GLuint tile_cache = 0;
+  // level 0 in texels, tile size without border and number of levels
+  GLint width = 0;
+  GLint height = 0;
+  GLint tile_size = 0;
+  GLint num_levels = 0;
+  // tiles per side of the cache and border texels around each tile
+  GLint cache_tiles = 0;
+  GLint border = 0;
 };
 
 // shader handle and uniform storage
@@ -39,6 +93,18 @@ struct shader_program {
   std::map<GLenum, std::string> shader_paths;
   // object handle
   GLuint handle;
+  // keeps the program alive, programs with identical sources are shared
+  std::shared_ptr<GLuint const> shared_handle{};
+  // defines inserted after #version, select the permutation
+  std::set<std::string> defines{};
+  // canonical paths of the stage files and their includes
+  std::set<std::string> dependencies{};
+  // linked permutations kept alive to switch back without compiling
+  std::map<std::string, std::shared_ptr<GLuint const>> variants{};
+  // program linking in the background after a source change, 0 if none
+  GLuint pending_handle{0};
+  // source hash of the pending program
+  std::uint64_t pending_hash{0};
   // uniform locations mapped to name
   std::map<std::string, GLint> u_locs{};
 };
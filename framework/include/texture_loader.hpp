@@ -2,11 +2,151 @@
 #define TEXTURE_LOADER_HPP
 
 #include "pixel_data.hpp"
+#include "utils.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace texture_loader {
   pixel_data file(std::string const& file_name);
+
+  // level of a mip chain, data points into the storage of the chain
+  struct mip_level {
+    std::size_t width;
+    std::size_t height;
+    std::size_t size;
+    void const* data;
+  };
+
+  // texture with full mip chain, ready for upload
+  struct mip_chain {
+    // sized or block compressed internal format
+    GLenum internal_format = GL_NONE;
+    // pixel format of uncompressed levels
+    GLenum channels = GL_NONE;
+    GLenum channel_type = GL_NONE;
+    // compressed levels are uploaded with glCompressedTexImage2D
+    bool compressed = false;
+    std::vector<mip_level> levels{};
+    // owner of the level data, a mapped cache file or decoded pixels
+    std::shared_ptr<void const> storage{};
+  };
+
+  // filter for downsampling mip levels
+  enum mip_filter {
+    BOX_FILTER,
+    // windowed sinc, keeps more detail in small levels
+    KAISER_FILTER
+  };
+
+  // successively halved images down to 1x1, starting with the image itself
+  // srgb colour channels are averaged in linear space, levels are filtered in parallel
+  std::vector<pixel_data> generate_mipmaps(pixel_data const& image, mip_filter filter = BOX_FILTER, bool srgb = true);
+  // wrap uncompressed levels for upload
+  mip_chain mipmapped(std::vector<pixel_data> levels);
+
+  // check if the context can sample block compressed textures
+  bool compression_supported();
+  // load file with full mip chain
+  // compressed chains are cached next to the file and mapped on later runs without decoding it
+  mip_chain mipmapped_file(std::string const& file_name, bool compress);
+
+  // loads a list of files on worker threads, upload must stay on the gl thread
+  template<typename T>
+  class batch {
+   public:
+    // starts loading immediately, uses one thread per core if num_threads is 0
+    batch(std::vector<std::string> const& file_names, std::function<T(std::string const&)> const& load,
+          unsigned num_threads = 0);
+    // waits for outstanding loads
+    ~batch();
+    batch(batch const&) = delete;
+    batch& operator=(batch const&) = delete;
+
+    std::size_t size() const;
+    // blocks until file i is loaded, can be called once per file
+    // rethrows errors of the load
+    T get(std::size_t i);
+
+   private:
+    void load();
+
+    std::vector<std::packaged_task<T()>> tasks_;
+    std::vector<std::future<T>> results_;
+    std::atomic<std::size_t> next_task_;
+    std::vector<std::thread> workers_;
+  };
+
+  // decodes image files on worker threads
+  class file_batch : public batch<pixel_data> {
+   public:
+    explicit file_batch(std::vector<std::string> const& file_names, unsigned num_threads = 0);
+  };
+
+  // decode all files in parallel, results are in the order of the names
+  std::vector<pixel_data> files(std::vector<std::string> const& file_names);
+}
+
+namespace texture_loader {
+
+template<typename T>
+batch<T>::batch(std::vector<std::string> const& file_names, std::function<T(std::string const&)> const& load,
+                unsigned num_threads)
+ :tasks_{}
+ ,results_{}
+ ,next_task_{0}
+ ,workers_{}
+{
+  for (auto const& file_name : file_names) {
+    tasks_.emplace_back([file_name, load] { return load(file_name); });
+    results_.push_back(tasks_.back().get_future());
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  num_threads = std::min(num_threads, unsigned(tasks_.size()));
+  for (unsigned i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this, num_threads] {
+      // with several workers the cores are busy, loads do not split their work further
+      utils::set_worker_thread(num_threads > 1);
+      this->load();
+    });
+  }
+}
+
+template<typename T>
+batch<T>::~batch() {
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+template<typename T>
+std::size_t batch<T>::size() const {
+  return results_.size();
+}
+
+template<typename T>
+T batch<T>::get(std::size_t i) {
+  return results_.at(i).get();
+}
+
+template<typename T>
+void batch<T>::load() {
+  // take tasks in order, so files needed first are loaded first
+  for (std::size_t i = next_task_++; i < tasks_.size(); i = next_task_++) {
+    // errors are stored in the future
+    tasks_[i]();
+  }
+}
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#ifndef OPENGL_FRAMEWORK_TEXTURE_STREAMER_HPP
+#define OPENGL_FRAMEWORK_TEXTURE_STREAMER_HPP
+
+#include "structs.hpp"
+#include "texture_loader.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// loads textures in the background and uploads them over several frames
+/// worker threads decode and copy levels into a pixel unpack staging ring,
+/// the gl thread transfers them from there under a per-frame byte budget
+/// only the mip tail is loaded up front, finer levels follow the requested level of each texture
+/// finer levels of least recently used textures are dropped to stay within a memory budget
+class TextureStreamer {
+
+public:
+    /// staging_bytes must hold the largest level, rgba8 2k levels need 8 MB
+    explicit TextureStreamer(std::size_t staging_bytes = 32 << 20, std::size_t frame_budget = 4 << 20,
+                             unsigned num_threads = 0);
+    TextureStreamer(TextureStreamer const&) = delete;
+    TextureStreamer& operator=(TextureStreamer const&) = delete;
+    /// stops loading and deletes all streamed textures
+    ~TextureStreamer();
+
+    /// create texture and queue loading of the file, its mip tail arrives over the next frames
+    /// requests of the same file share the texture
+    texture_object request(std::string const& file_name);
+    /// release a requested texture, deleted with its last request, pending levels are dropped
+    /// call on the gl thread, loads in progress are discarded when they finish
+    void free(texture_object& texture);
+    /// transfer staged data within the frame budget and queue levels requested by the renderer
+    /// call once per frame on the gl thread
+    void update();
+
+    /// loads and levels not yet transferred
+    std::size_t getPending() const;
+    std::size_t getFrameBudget() const;
+    void setFrameBudget(std::size_t frame_budget);
+    /// video memory of all streamed textures, mip tails are always kept
+    std::size_t getMemoryBudget() const;
+    void setMemoryBudget(std::size_t memory_budget);
+    std::size_t getResidentBytes() const;
+
+private:
+    // request handled by a worker, loads the file if level is negative, otherwise stages the level
+    struct load_job {
+        GLuint texture;
+        std::uint64_t id;
+        std::string file_name;
+        GLint level;
+    };
+
+    // mip level copied into the staging ring, waiting for transfer
+    struct staged_level {
+        GLuint texture;
+        std::uint64_t id;
+        GLint level;
+        std::size_t num_levels;
+        std::size_t base_width;
+        std::size_t width;
+        std::size_t height;
+        GLenum internal_format;
+        bool compressed;
+        // position in the staging ring
+        std::size_t offset;
+        std::size_t size;
+        // rows already transferred
+        std::size_t uploaded_rows;
+    };
+
+    // range of the staging ring, freed in order of reservation
+    struct staging_range {
+        std::size_t offset;
+        std::size_t size;
+        bool released;
+    };
+
+    // transfers of one frame, the ranges are reusable once the fence signals
+    struct frame_fence {
+        GLsync sync;
+        std::vector<std::size_t> offsets;
+    };
+
+    // cpu side of a streamed texture
+    struct streamed_texture {
+        std::shared_ptr<texture_residency> residency;
+        // loaded chain, kept to stage finer levels on demand
+        texture_loader::mip_chain chain;
+        bool loaded;
+        // finest level staged or being staged
+        GLint staged_level;
+        // coarsest level outside of the mip tail is tail_level - 1
+        GLint tail_level;
+        // bytes of a level queued by refine, not yet defined
+        std::size_t queued_bytes;
+        // requests sharing the texture and the canonical path they are keyed by
+        std::size_t references;
+        std::string path;
+        // names of deleted textures are reused, jobs and levels of a freed texture must not match its successor
+        std::uint64_t id;
+    };
+
+    void work();
+    // the texture a job or level belongs to, null if it was freed, mutex_ must be held
+    streamed_texture* lookup(GLuint texture, std::uint64_t id);
+    // copy levels [first, last) of the chain into the staging ring, finest last
+    void stage(GLuint texture, std::uint64_t id, texture_loader::mip_chain const& chain, std::size_t first, std::size_t last);
+    // block until a range is free, returns false if stopped
+    bool reserve(std::size_t bytes, std::size_t& offset);
+    void release(std::size_t offset);
+    bool tryReserve(std::size_t bytes, std::size_t& offset);
+    // queue the next finer level of textures whose requested level is not resident
+    void refine();
+    // drop the finest level of the least recently used texture last used before the frame
+    // returns false if no texture can be demoted, mutex_ must be held
+    bool demote(std::uint64_t before_frame);
+    // transfer up to budget bytes of the level, returns transferred bytes
+    std::size_t transfer(staged_level& level, std::size_t budget);
+    // clamp sampling to the newly completed level
+    void makeResident(staged_level const& level);
+
+    GLuint pixel_BO_;
+    // persistently mapped buffer or client memory copied at transfer time
+    std::uint8_t* staging_;
+    std::vector<std::uint8_t> client_staging_;
+    bool persistent_;
+    bool compress_;
+    std::size_t capacity_;
+    std::size_t frame_budget_;
+    std::size_t memory_budget_;
+
+    // guarded by mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable jobs_available_;
+    std::condition_variable staging_available_;
+    std::deque<load_job> jobs_;
+    std::deque<staged_level> staged_;
+    std::deque<staging_range> ranges_;
+    std::map<GLuint, streamed_texture> textures_;
+    std::map<std::string, GLuint> paths_;
+    std::size_t head_;
+    std::size_t pending_;
+    std::uint64_t next_id_;
+    bool stop_;
+
+    // only used on the gl thread
+    std::deque<staged_level> uploads_;
+    std::deque<frame_fence> fences_;
+    std::uint64_t frame_;
+    // bytes of defined levels and of levels queued by refine
+    std::size_t resident_bytes_;
+    std::size_t queued_bytes_;
+    std::vector<std::thread> workers_;
+};
+
+#endif
@@ -7,7 +7,12 @@ using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 
+#include <cstdint>
+#include <exception>
 #include <map>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 struct pixel_data;
@@ -18,6 +23,8 @@ namespace utils {
   texture_object create_texture_object(pixel_data const& tex);
   // print bound textures for all texture units
   void print_bound_textures();
+  // trilinear, anisotropic if available, clamped sampling of the bound texture with num_levels mip levels
+  void set_mipmap_sampler(GLenum target, std::size_t num_levels);
 
   // get uniform location, throwing exception if name describes no active uniform variable
   GLint glGetUniformLocation(GLuint, const GLchar*);
@@ -28,14 +35,104 @@ namespace utils {
   // return handle of bound vertex array object
   GLint get_bound_VAO();
 
+  // check if the current context has at least the given version
+  bool has_version(unsigned major, unsigned minor);
+  // check if the current context exposes the named extension
+  bool has_extension(std::string const& name);
+
   // read file and write content to string
   std::string read_file(std::string const& name);
 
+  // size and modification time of a file, invalidates caches derived from it
+  struct file_stamp {
+    std::uint64_t size;
+    std::uint64_t modified;
+  };
+  // returns false if the file does not exist
+  bool stamp_file(std::string const& name, file_stamp& stamp);
+  // map whole file read-only, the mapping lives as long as the returned pointer, null on failure
+  std::shared_ptr<void const> map_file(std::string const& name, std::size_t& size);
+  // absolute path without links and dot segments, the name itself if the file does not exist
+  std::string canonical_path(std::string const& name);
+  // 64 bit FNV-1a, stable across runs, pass the previous result to continue hashing
+  std::uint64_t hash_bytes(void const* data, std::size_t bytes, std::uint64_t hash = 14695981039346656037ull);
+
+  // quotes and backslashes escaped for a json string
+  std::string escape_json(std::string const& text);
+
   // return path to resources depending on cmdline args
   std::string read_resource_path(int argc, char* argv[]);
 
   // calculate Vert+ FOV projection matrix
   glm::fmat4 calculate_projection_matrix(float aspect);
+
+  // number of ranges for splitting count elements over the cores, each range has at least min_range_size elements
+  // 1 on worker threads, the cores are already busy
+  std::size_t range_num(std::size_t count, std::size_t min_range_size = 4096);
+  // call function(begin, end, range) for contiguous ranges of [0, count) in parallel
+  // on worker threads, including those of parallel_for, the ranges run one after another
+  template<typename Function>
+  void parallel_for(std::size_t count, std::size_t ranges, Function const& function);
+  // mark the calling thread as one of a pool using all cores, e.g. a loader thread
+  void set_worker_thread(bool worker);
+  bool is_worker_thread();
+}
+
+namespace utils {
+
+// joins the threads of parallel_for and clears the worker mark of the calling thread on every exit
+struct parallel_scope {
+  parallel_scope()
+   :workers{}
+  {
+    set_worker_thread(true);
+  }
+  parallel_scope(parallel_scope const&) = delete;
+  parallel_scope& operator=(parallel_scope const&) = delete;
+  ~parallel_scope() {
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    set_worker_thread(false);
+  }
+
+  std::vector<std::thread> workers;
+};
+
+template<typename Function>
+void parallel_for(std::size_t count, std::size_t ranges, Function const& function) {
+  if (is_worker_thread()) {
+    // nested calls would start threads per core from every worker
+    for (std::size_t r = 0; r < ranges; ++r) {
+      function(count * r / ranges, count * (r + 1) / ranges, r);
+    }
+    return;
+  }
+
+  // errors of the other threads are rethrown once all ranges are done
+  std::vector<std::exception_ptr> errors(ranges);
+  {
+    parallel_scope scope{};
+    for (std::size_t r = 1; r < ranges; ++r) {
+      scope.workers.emplace_back([&function, &errors, count, ranges, r] {
+        set_worker_thread(true);
+        try {
+          function(count * r / ranges, count * (r + 1) / ranges, r);
+        }
+        catch (...) {
+          errors[r] = std::current_exception();
+        }
+      });
+    }
+    // first range runs on the calling thread
+    function(0, count / ranges, 0);
+  }
+  for (auto const& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
 }
 
 #endif
\ No newline at end of file
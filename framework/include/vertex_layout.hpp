@@ -0,0 +1,98 @@
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding 
+using namespace gl;
+
+#include <cstddef>
+#include <cstdint>
+
+// maps component types to gl type enums
+template<typename T> struct gl_type;
+template<> struct gl_type<GLfloat>  { static constexpr GLenum value = GL_FLOAT; };
+template<> struct gl_type<GLint>    { static constexpr GLenum value = GL_INT; };
+template<> struct gl_type<GLuint>   { static constexpr GLenum value = GL_UNSIGNED_INT; };
+template<> struct gl_type<GLshort>  { static constexpr GLenum value = GL_SHORT; };
+template<> struct gl_type<GLushort> { static constexpr GLenum value = GL_UNSIGNED_SHORT; };
+template<> struct gl_type<GLbyte>   { static constexpr GLenum value = GL_BYTE; };
+template<> struct gl_type<GLubyte>  { static constexpr GLenum value = GL_UNSIGNED_BYTE; };
+
+// vertex attribute with shader location and format known at compile time
+template<GLuint Location, GLint Components, typename T = GLfloat, bool Normalized = false>
+struct vertex_attribute {
+  static constexpr GLuint location = Location;
+  static constexpr GLint components = Components;
+  static constexpr GLenum type = gl_type<T>::value;
+  static constexpr bool normalized = Normalized;
+  // size in bytes
+  static constexpr GLsizei size = GLsizei(sizeof(T)) * Components;
+};
+
+// interleaved vertex format, attributes are packed in the given order
+template<typename... Attributes>
+struct vertex_layout;
+
+template<>
+struct vertex_layout<> {
+  static constexpr GLsizei stride = 0;
+  static constexpr std::size_t attribute_num = 0;
+};
+
+template<typename First, typename... Rest>
+struct vertex_layout<First, Rest...> {
+  // size of one vertex in bytes
+  static constexpr GLsizei stride = First::size + vertex_layout<Rest...>::stride;
+  static constexpr std::size_t attribute_num = 1 + sizeof...(Rest);
+};
+
+// byte offset of the attribute with the given index from the vertex beginning
+template<typename Layout, std::size_t Index>
+struct attribute_offset;
+
+template<typename First, typename... Rest>
+struct attribute_offset<vertex_layout<First, Rest...>, 0> {
+  static constexpr GLsizei value = 0;
+};
+
+template<typename First, typename... Rest, std::size_t Index>
+struct attribute_offset<vertex_layout<First, Rest...>, Index> {
+  static constexpr GLsizei value = First::size + attribute_offset<vertex_layout<Rest...>, Index - 1>::value;
+};
+
+namespace vertex_layout_detail {
+  // configures the attributes of the bound VAO, offsets are accumulated at compile time
+  template<GLsizei Offset, typename Layout>
+  struct attribute_setup;
+
+  template<GLsizei Offset>
+  struct attribute_setup<Offset, vertex_layout<>> {
+    static void apply(GLsizei, GLuint, bool) {}
+  };
+
+  template<GLsizei Offset, typename First, typename... Rest>
+  struct attribute_setup<Offset, vertex_layout<First, Rest...>> {
+    static void apply(GLsizei stride, GLuint binding, bool separate_format) {
+      glEnableVertexAttribArray(First::location);
+      if (separate_format) {
+        glVertexAttribFormat(First::location, First::components, First::type, First::normalized ? GL_TRUE : GL_FALSE, GLuint(Offset));
+        glVertexAttribBinding(First::location, binding);
+      }
+      else {
+        glVertexAttribPointer(First::location, First::components, First::type, First::normalized ? GL_TRUE : GL_FALSE,
+                              stride, reinterpret_cast<GLvoid const*>(std::uintptr_t(Offset)));
+      }
+      attribute_setup<Offset + First::size, vertex_layout<Rest...>>::apply(stride, binding, separate_format);
+    }
+  };
+}
+
+// set attribute formats of the bound VAO
+// with separate formats the attributes read from the given binding point,
+// otherwise from the buffer bound to GL_ARRAY_BUFFER
+template<typename Layout>
+void apply_vertex_layout(bool separate_format, GLuint binding = 0) {
+  vertex_layout_detail::attribute_setup<0, Layout>::apply(Layout::stride, binding, separate_format);
+}
+
+#endif
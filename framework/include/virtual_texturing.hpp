@@ -0,0 +1,128 @@
+#ifndef OPENGL_FRAMEWORK_VIRTUAL_TEXTURING_HPP
+#define OPENGL_FRAMEWORK_VIRTUAL_TEXTURING_HPP
+
+#include "structs.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// software virtual texturing for textures too large for video memory
+/// images are split into a tile file with mip levels, a feedback pass records the tiles seen on screen
+/// and a worker copies them from the mapped tile file into a fixed-size tile cache texture,
+/// the page table of each texture points every virtual tile to its finest resident tile
+class VirtualTexturing {
+
+public:
+    /// tile size without border, level 0 of an image must be a multiple of it
+    static const std::size_t TILE_SIZE = 128;
+    /// texels copied from neighbouring tiles for bilinear filtering
+    static const std::size_t TILE_BORDER = 1;
+
+    /// cache of cache_tiles x cache_tiles tiles, 16 need 17 MB
+    /// feedback is rendered at 1/feedback_scale of the framebuffer resolution
+    explicit VirtualTexturing(std::size_t cache_tiles = 16, unsigned feedback_scale = 8);
+    VirtualTexturing(VirtualTexturing const&) = delete;
+    VirtualTexturing& operator=(VirtualTexturing const&) = delete;
+    ~VirtualTexturing();
+
+    /// split a power of two image into tiles of all levels, levels are filtered in approximately linear space
+    /// holds the decoded image and its next level in memory, run offline through vt_tiler
+    static void buildTileFile(std::string const& image_file, std::string const& tile_file);
+    /// open the tile file built next to the image, throws if it is missing or outdated
+    /// the coarsest tile stays resident, at most 15 textures
+    virtual_texture_object add(std::string const& image_file);
+    bool empty() const;
+
+    /// adapt the feedback buffer to the framebuffer
+    void resize(unsigned width, unsigned height);
+    /// bind and clear the feedback buffer, render the textured geometry with feedback output in between
+    void beginFeedback();
+    /// start the asynchronous read back of the feedback and restore the default framebuffer
+    void endFeedback();
+    /// log2 of the feedback scale, added to the level chosen in the feedback pass
+    float getFeedbackBias() const;
+
+    /// request tiles seen in the last feedback, upload loaded tiles and update the page tables
+    /// call once per frame on the gl thread
+    void update();
+
+    std::size_t getResidentTiles() const;
+
+private:
+    // mapped tile file of one texture
+    struct tile_store {
+        std::shared_ptr<void const> data;
+        virtual_texture_object texture;
+        // tiles per row and offset of each level in the file
+        std::vector<std::size_t> tiles_x;
+        std::vector<std::size_t> tiles_y;
+        std::vector<std::size_t> offsets;
+        // page table levels, rebuilt when residency changes
+        std::vector<std::vector<std::uint8_t>> page_entries;
+        bool dirty;
+    };
+
+    // tile copied from the mapped file, ready for upload
+    struct loaded_tile {
+        std::uint64_t key;
+        std::vector<std::uint8_t> texels;
+    };
+
+    // position in the tile cache
+    struct cache_slot {
+        std::uint64_t key;
+        std::uint64_t last_use_frame;
+        bool used;
+        // coarsest tiles are never evicted
+        bool locked;
+    };
+
+    void work();
+    // read a tile from its store, called by the worker or at creation
+    loaded_tile load(std::uint64_t key);
+    // request the tile and its missing ancestors, mark resident ones as used
+    void touch(std::uint64_t key);
+    // copy into a free or the least recently used slot, returns false if all slots are in use
+    bool upload(loaded_tile const& tile, bool locked);
+    void updatePageTable(tile_store& store);
+
+    std::size_t cache_tiles_;
+    unsigned feedback_scale_;
+    GLuint tile_cache_;
+    std::vector<cache_slot> slots_;
+    // slot of each resident tile
+    std::unordered_map<std::uint64_t, std::size_t> resident_;
+    // tiles queued or being loaded
+    std::unordered_set<std::uint64_t> requested_;
+    std::uint64_t frame_;
+
+    GLuint feedback_FBO_;
+    GLuint feedback_color_;
+    GLuint feedback_depth_;
+    // read back alternates between two buffers, the previous frame is read while the current one is copied
+    GLuint feedback_BOs_[2];
+    unsigned width_;
+    unsigned height_;
+    unsigned feedback_width_;
+    unsigned feedback_height_;
+    unsigned feedback_frames_;
+
+    // guarded by mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable jobs_available_;
+    std::vector<tile_store> stores_;
+    std::deque<std::uint64_t> jobs_;
+    std::deque<loaded_tile> loaded_;
+    bool stop_;
+    std::thread worker_;
+};
+
+#endif
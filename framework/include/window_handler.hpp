@@ -9,17 +9,43 @@
 
 // forward declarations
 class Application;
+class FrameStatistics;
 struct GLFWwindow;
 
 namespace window_handler { 
+  // gl error checking, from cheapest to most thorough
+  enum class error_mode {
+    off,
+    // the driver reports errors through the debug callback whenever it gets to them
+    debug,
+    // glGetError once every few frames, names the frames but not the call
+    sampled,
+    // glGetError after every call and synchronous debug output, throws at the failing call
+    // requires GL_ERROR_CALLBACKS at compile time, debug is used otherwise
+    per_call
+  };
+
   // create window and set callbacks
+  // the error mode is read from the GL_ERROR_MODE environment variable (off, debug, sampled or call)
   GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor);
   // load shader programs and update uniform locations
   void set_callback_object(GLFWwindow* window, Application* app);
   // free resources
   void close_and_quit(GLFWwindow* window, int status);
-    // calculate fps and show in window title
-  void show_fps(GLFWwindow* window);
+  // show fps and the 99th percentile frame interval in the window title
+  void show_fps(GLFWwindow* window, FrameStatistics const& statistics);
+
+  // change the error checking, the frame time of the previous mode is printed
+  void set_error_mode(error_mode mode);
+  error_mode get_error_mode();
+  // count gl calls per function, redundant binds and uploaded bytes per frame, see gl_call_statistics
+  // requires GL_ERROR_CALLBACKS at compile time, enabled on initialize if GL_CALL_STATISTICS is 1
+  void set_call_statistics(bool enable);
+  bool get_call_statistics();
+  // frames between checks in sampled mode
+  void set_error_interval(unsigned frames);
+  // call once per frame after swapping, checks in sampled mode and measures the frame time of the mode
+  void check_errors();
 }
 
 #endif
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "application.hpp"
 
+#include "cpu_profiler.hpp"
+#include "gl_call_statistics.hpp"
+#include "shader_loader.hpp"
 #include "utils.hpp"
 #include "window_handler.hpp"
-#include "shader_loader.hpp"
 
 #include <glbinding/gl/gl.h>
 // use gl definitions from glbinding 
@@ -12,32 +14,102 @@ using namespace gl;
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing);
+#include <cstdlib>
+#include <iostream>
+
+static void update_shader_programs(std::map<std::string, shader_program>& shaders, AssetCache& assets, bool throwing);
+static bool begin_shader_update(shader_program& program, AssetCache& assets, FileWatcher& watcher);
+static bool finish_shader_update(shader_program& program, AssetCache& assets);
+static void print_gpu_profile(GpuProfiler const& profiler);
+static void print_frame_statistics(FrameStatistics const& statistics, GpuProfiler const& profiler);
+static std::uint32_t configure_input(InputRecording& input);
+
+// seed of procedural content unless RANDOM_SEED is set, fixed so runs are comparable
+static const std::uint32_t DEFAULT_SEED = 5489u;
 
 const glm::uvec2 Application::initial_resolution = {640u, 480u};
 const float Application::initial_aspect_ratio = float(initial_resolution.x) / float(initial_resolution.y);
 
 Application::Application(std::string const& resource_path)
  :m_resource_path{resource_path}
+ ,m_assets{}
  ,m_shaders{}
-{}
+ ,m_shader_watcher{}
+ ,m_gpu_profiler{}
+ ,m_frame_statistics{}
+ ,m_gpu_frames_recorded{0}
+ ,m_shown_second{0}
+ ,m_time{0.0}
+ ,m_input{}
+ ,m_random{}
+{
+  // procedural content of derived classes is generated from this seed
+  m_random.seed(configure_input(m_input));
+  // linked programs are restored from driver binaries on later launches
+  m_assets.setProgramCache(m_resource_path + "shaders/binaries/");
+}
 
 Application::~Application() {
-  // free all shader program objects
+  print_frame_statistics(m_frame_statistics, m_gpu_profiler);
+  // shader program objects are freed with their last shared handle
   for (auto const& pair : m_shaders) {
-    glDeleteProgram(pair.second.handle);
+    if (pair.second.pending_handle != 0) {
+      glDeleteProgram(pair.second.pending_handle);
+    }
   }
 }
 
 void Application::reloadShaders(bool throwing) {
+  PROFILE_ZONE("Application::reloadShaders");
   // recompile shaders from source files
-  update_shader_programs(m_shaders, throwing);
+  update_shader_programs(m_shaders, m_assets, throwing);
+  // later changes are picked up by updateShaders
+  for (auto const& pair : m_shaders) {
+    for (auto const& file : pair.second.dependencies) {
+      m_shader_watcher.watch(file);
+    }
+  }
   // after shader programs are recompiled, uniform locations may change
   updateUniformLocations();
   // upload values to new locations
   uploadUniforms();
 }
 
+void Application::updateShaders() {
+  PROFILE_ZONE("Application::updateShaders");
+  bool swapped = false;
+  // recompile only the programs using a changed file or include
+  for (auto const& file : m_shader_watcher.changed()) {
+    for (auto& pair : m_shaders) {
+      if (pair.second.dependencies.count(file) > 0) {
+        // other permutations are outdated as well, they are compiled again when selected
+        pair.second.variants.clear();
+        swapped = begin_shader_update(pair.second, m_assets, m_shader_watcher) || swapped;
+      }
+    }
+  }
+  for (auto& pair : m_shaders) {
+    swapped = finish_shader_update(pair.second, m_assets) || swapped;
+  }
+  // new programs are only used with their uniforms
+  if (swapped) {
+    updateUniformLocations();
+    uploadUniforms();
+  }
+}
+
+void Application::setShaderDefines(std::string const& name, std::set<std::string> const& defines) {
+  shader_program& program = m_shaders.at(name);
+  if (program.defines == defines) {
+    return;
+  }
+  program.defines = defines;
+  if (begin_shader_update(program, m_assets, m_shader_watcher)) {
+    updateUniformLocations();
+    uploadUniforms();
+  }
+}
+
 // update shader uniform locations
 void Application::updateUniformLocations() {
   for (auto& pair : m_shaders) {
@@ -50,13 +122,60 @@ void Application::updateUniformLocations() {
 
 ///////////////////////////// callback functions for window events ////////////
 // handle key input
-void Application::key_callback(GLFWwindow* m_window, int key, int action, int mods) {
+void Application::key_callback(GLFWwindow* window, int key, int action, int mods) {
+  // the recording replaces live input, quitting still works
+  if (m_input.getMode() == InputRecording::REPLAY && key != GLFW_KEY_ESCAPE && key != GLFW_KEY_Q) {
+    return;
+  }
+  m_input.recordKey(key, action, mods);
+  handleKey(window, key, action, mods);
+}
+
+void Application::handleKey(GLFWwindow* m_window, int key, int action, int mods) {
   // handle special keys
   if ((key == GLFW_KEY_ESCAPE || key == GLFW_KEY_Q) && action == GLFW_PRESS) {
     glfwSetWindowShouldClose(m_window, 1);
   }
   else if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-    reloadShaders(false);
+    // unchanged programs are kept, changed ones are swapped in by updateShaders
+    bool swapped = false;
+    for (auto& pair : m_shaders) {
+      pair.second.variants.clear();
+      swapped = begin_shader_update(pair.second, m_assets, m_shader_watcher) || swapped;
+    }
+    if (swapped) {
+      updateUniformLocations();
+      uploadUniforms();
+    }
+  }
+  else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+#ifdef CPU_PROFILER
+    if (cpu_profiler::write_chrome_trace("cpu_trace.json")) {
+      std::cout << "CPU zones written to cpu_trace.json" << std::endl;
+    }
+#else
+    std::cout << "CPU zones are compiled out, enable CPU_PROFILER" << std::endl;
+#endif
+  }
+  else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    print_gpu_profile(m_gpu_profiler);
+  }
+  else if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+    print_frame_statistics(m_frame_statistics, m_gpu_profiler);
+    // shift starts a new measurement, e.g. after loading
+    if (mods & GLFW_MOD_SHIFT) {
+      m_frame_statistics.reset();
+      gl_call_statistics::reset();
+    }
+  }
+  else if (key == GLFW_KEY_E && action == GLFW_PRESS) {
+    // cycle gl error checking, the frame time of each mode is printed when leaving it
+    auto const mode = static_cast<unsigned>(window_handler::get_error_mode());
+    window_handler::set_error_mode(window_handler::error_mode((mode + 1) % 4));
+  }
+  else if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+    // gl calls per frame, printed with the frame statistics
+    window_handler::set_call_statistics(!window_handler::get_call_statistics());
   }
   // else pass input to derived class
   else {
@@ -64,10 +183,50 @@ void Application::key_callback(GLFWwindow* m_window, int key, int action, int mo
   }
 }
 
+void Application::recordFrame(GLFWwindow* window, double cpu_ms, double present_ms) {
+  m_frame_statistics.record(FrameStatistics::CPU, cpu_ms);
+  m_frame_statistics.record(FrameStatistics::PRESENT, present_ms);
+  if (m_gpu_profiler.getFramesRead() != m_gpu_frames_recorded) {
+    m_gpu_frames_recorded = m_gpu_profiler.getFramesRead();
+    m_frame_statistics.record(FrameStatistics::GPU, m_gpu_profiler.getLastFrameMs());
+  }
+  if (window_handler::get_call_statistics()) {
+    gl_call_statistics::end_frame();
+  }
+  // the title is updated once per second, offscreen frames have no window
+  if (window != nullptr && m_frame_statistics.getSeconds() != m_shown_second) {
+    m_shown_second = m_frame_statistics.getSeconds();
+    window_handler::show_fps(window, m_frame_statistics);
+  }
+}
+
+void Application::setTime(double seconds) {
+  m_time = seconds;
+}
+
+bool Application::replayInput(GLFWwindow* window) {
+  if (!m_input.hasFrame()) {
+    std::cout << "Input replay finished" << std::endl;
+    return false;
+  }
+  for (auto const& event : m_input.getEvents()) {
+    if (event.type == InputRecording::event::KEY) {
+      handleKey(window, event.key, event.action, event.mods);
+    }
+    else {
+      mouseCallback(event.x, event.y);
+    }
+  }
+  return true;
+}
+
 //handle mouse movement input
 void Application::mouse_callback(GLFWwindow* window, double pos_x, double pos_y) {
-  // pass input to derived class
-  mouseCallback(pos_x, pos_y);
+  if (m_input.getMode() != InputRecording::REPLAY) {
+    m_input.recordMouse(pos_x, pos_y);
+    // pass input to derived class
+    mouseCallback(pos_x, pos_y);
+  }
   // reset cursor pos to receive position delta next frame
   glfwSetCursorPos(window, 0.0, 0.0);
 }
@@ -81,15 +240,21 @@ void Application::resize_callback(unsigned width, unsigned height) {
 }
 ///////////////////////////// local helper functions //////////////////////////
 // update uniform locations
-static void update_shader_programs(std::map<std::string, shader_program>& shaders, bool throwing) {
+static void update_shader_programs(std::map<std::string, shader_program>& shaders, AssetCache& assets, bool throwing) {
   // actual functionality in lambda to allow update with and without throwing
-  auto update_lambda = [](shader_program& program){
+  auto update_lambda = [&assets](shader_program& program){
     // throws exception when compiling was unsuccessfull
-    GLuint new_program = shader_loader::program(program.shader_paths);
-    // free old shader program
-    glDeleteProgram(program.handle);
-    // save new shader program
-    program.handle = new_program;
+    // unchanged sources return the current program, identical ones a shared program
+    std::uint64_t const hash = AssetCache::programHash(program.shader_paths, program.defines, &program.dependencies);
+    std::shared_ptr<GLuint const> shared = assets.findProgram(hash);
+    if (!shared) {
+      shared = assets.addProgram(hash, shader_loader::program(program.shader_paths, program.defines,
+                                                             assets.getProgramsRetrievable()));
+    }
+    // old shader program is freed with its last handle
+    program.shared_handle = shared;
+    program.handle = *shared;
+    program.variants[shader_loader::permutation_key(program.defines)] = shared;
   };
 
   // reload all shader programs
@@ -108,3 +273,119 @@ static void update_shader_programs(std::map<std::string, shader_program>& shader
   }
 }
 
+// start linking the current sources in the background, replaces an unfinished update
+// returns true if a shared or stored program was swapped in immediately
+static bool begin_shader_update(shader_program& program, AssetCache& assets, FileWatcher& watcher) {
+  if (program.pending_handle != 0) {
+    glDeleteProgram(program.pending_handle);
+    program.pending_handle = 0;
+  }
+  try {
+    std::uint64_t const hash = AssetCache::programHash(program.shader_paths, program.defines, &program.dependencies);
+    // includes may have been added
+    for (auto const& file : program.dependencies) {
+      watcher.watch(file);
+    }
+    // unchanged sources and kept permutations return a linked program
+    std::shared_ptr<GLuint const> shared = assets.findProgram(hash);
+    if (shared) {
+      bool const swapped = shared != program.shared_handle;
+      program.shared_handle = shared;
+      program.handle = *shared;
+      program.variants[shader_loader::permutation_key(program.defines)] = shared;
+      return swapped;
+    }
+    program.pending_handle = shader_loader::begin_program(program.shader_paths, program.defines,
+                                                          assets.getProgramsRetrievable());
+    program.pending_hash = hash;
+  }
+  catch(std::exception&) {
+    // source missing while the editor replaces it, the next change retries
+  }
+  return false;
+}
+
+// swap in the pending program once the driver finished it and linking succeeded
+static bool finish_shader_update(shader_program& program, AssetCache& assets) {
+  if (program.pending_handle == 0 || !shader_loader::program_completed(program.pending_handle)) {
+    return false;
+  }
+  GLuint const handle = program.pending_handle;
+  program.pending_handle = 0;
+  try {
+    shader_loader::end_program(handle, program.shader_paths);
+  }
+  catch(std::exception&) {
+    // keep the current program, errors were printed
+    return false;
+  }
+  // programs with identical sources may have finished this frame
+  std::shared_ptr<GLuint const> shared = assets.findProgram(program.pending_hash);
+  if (shared) {
+    glDeleteProgram(handle);
+  }
+  else {
+    shared = assets.addProgram(program.pending_hash, handle);
+  }
+  // old shader program is freed with its last handle
+  program.shared_handle = shared;
+  program.handle = *shared;
+  program.variants[shader_loader::permutation_key(program.defines)] = shared;
+  return true;
+}
+
+// rolling pass times as table and csv
+static void print_gpu_profile(GpuProfiler const& profiler) {
+  auto const statistics = profiler.getStatistics();
+  if (statistics.empty()) {
+    std::cout << "No GPU pass times, timer queries are " << (profiler.supported() ? "pending" : "unsupported") << std::endl;
+    return;
+  }
+  // the frame pass is recorded every frame
+  std::cout << "GPU pass times in ms (min / avg / max over " << statistics.front().samples << " frames)\n";
+  for (auto const& pass : statistics) {
+    std::cout << "  " << pass.name << ": " << pass.min_ms << " / " << pass.avg_ms << " / " << pass.max_ms << "\n";
+  }
+  if (profiler.writeCsv("gpu_profile.csv")) {
+    std::cout << "written to gpu_profile.csv" << std::endl;
+  }
+}
+
+// percentile table of the frame times
+static void print_frame_statistics(FrameStatistics const& statistics, GpuProfiler const& profiler) {
+  statistics.print(std::cout);
+  if (profiler.getDroppedFrames() > 0) {
+    std::cout << profiler.getDroppedFrames() << " frames without gpu time, their queries were pending" << std::endl;
+  }
+  if (window_handler::get_call_statistics()) {
+    gl_call_statistics::print(std::cout);
+  }
+}
+
+// INPUT_REPLAY replays a recording with its seed, INPUT_RECORD records one, returns the seed to use
+static std::uint32_t configure_input(InputRecording& input) {
+  char const* seed_text = std::getenv("RANDOM_SEED");
+  std::uint32_t seed = seed_text != nullptr ? std::uint32_t(std::strtoul(seed_text, nullptr, 10)) : DEFAULT_SEED;
+
+  char const* replay_file = std::getenv("INPUT_REPLAY");
+  char const* record_file = std::getenv("INPUT_RECORD");
+  if (replay_file != nullptr) {
+    try {
+      input.replay(replay_file);
+      std::cout << "Replaying input from " << replay_file << std::endl;
+      return input.getSeed();
+    }
+    catch (std::exception const& error) {
+      std::cerr << "Input replay failed, " << error.what() << std::endl;
+    }
+  }
+  else if (record_file != nullptr) {
+    if (input.record(record_file, seed)) {
+      std::cout << "Recording input to " << record_file << std::endl;
+    }
+    else {
+      std::cerr << "Input recording to " << record_file << " failed" << std::endl;
+    }
+  }
+  return seed;
+}
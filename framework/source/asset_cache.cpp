@@ -0,0 +1,154 @@
+#include "asset_cache.hpp"
+
+#include "shader_loader.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+static std::uint64_t driver_hash();
+
+AssetCache::AssetCache():
+    programs_{},
+    hits_{0},
+    misses_{0},
+    program_cache_{},
+    program_binary_hits_{0}
+{}
+
+std::shared_ptr<GLuint const> AssetCache::program(std::map<GLenum, std::string> const& stages,
+                                                  std::set<std::string> const& defines) {
+    std::uint64_t const hash = programHash(stages, defines);
+    std::shared_ptr<GLuint const> program = findProgram(hash);
+    if (!program) {
+        program = addProgram(hash, shader_loader::program(stages, defines, getProgramsRetrievable()));
+    }
+    return program;
+}
+
+std::uint64_t AssetCache::programHash(std::map<GLenum, std::string> const& stages,
+                                      std::set<std::string> const& defines, std::set<std::string>* files) {
+    // the same sources give the same program, wherever they are loaded from
+    // defines and includes are part of the preprocessed source
+    std::uint64_t hash = utils::hash_bytes(nullptr, 0);
+    std::vector<std::string> read_files{};
+    for (auto const& stage : stages) {
+        std::string const source{shader_loader::preprocess(stage.second, defines, read_files)};
+        hash = utils::hash_bytes(&stage.first, sizeof(stage.first), hash);
+        hash = utils::hash_bytes(source.data(), source.size(), hash);
+    }
+    if (files != nullptr) {
+        *files = std::set<std::string>(read_files.begin(), read_files.end());
+    }
+    return hash;
+}
+
+std::shared_ptr<GLuint const> AssetCache::findProgram(std::uint64_t hash) {
+    auto const shared = programs_.find(hash);
+    std::shared_ptr<GLuint const> program = shared != programs_.end() ? shared->second.lock() : nullptr;
+    if (program) {
+        ++hits_;
+        return program;
+    }
+    std::string const binary_file{programBinaryFile(hash)};
+    GLuint const restored = binary_file.empty() ? 0 : shader_loader::load_binary(binary_file);
+    if (restored == 0) {
+        return nullptr;
+    }
+    ++program_binary_hits_;
+    return shareProgram(hash, restored);
+}
+
+std::shared_ptr<GLuint const> AssetCache::addProgram(std::uint64_t hash, GLuint program) {
+    std::string const binary_file{programBinaryFile(hash)};
+    if (!binary_file.empty()) {
+        shader_loader::save_binary(program, binary_file);
+    }
+    return shareProgram(hash, program);
+}
+
+bool AssetCache::getProgramsRetrievable() const {
+    return !program_cache_.empty() && shader_loader::binary_supported();
+}
+
+void AssetCache::setProgramCache(std::string const& directory) {
+    program_cache_ = directory;
+    if (!program_cache_.empty() && program_cache_.back() != '/' && program_cache_.back() != '\\') {
+        program_cache_ += '/';
+    }
+    if (!program_cache_.empty()) {
+#ifdef _WIN32
+        _mkdir(program_cache_.c_str());
+#else
+        mkdir(program_cache_.c_str(), 0755);
+#endif
+    }
+}
+
+std::string AssetCache::programBinaryFile(std::uint64_t hash) const {
+    if (!getProgramsRetrievable()) {
+        return std::string{};
+    }
+    // binaries are only valid for the driver which created them
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.glbin", static_cast<unsigned long long>(hash ^ driver_hash()));
+    return program_cache_ + name;
+}
+
+std::shared_ptr<GLuint const> AssetCache::shareProgram(std::uint64_t hash, GLuint program) {
+    std::shared_ptr<GLuint const> shared{new GLuint{program}, [](GLuint const* program) {
+        glDeleteProgram(*program);
+        delete program;
+    }};
+    // unloaded once all handles are gone, the entry is reused
+    programs_[hash] = shared;
+    ++misses_;
+    return shared;
+}
+
+std::size_t AssetCache::size() const {
+    std::size_t count = 0;
+    for (auto const& entry : programs_) {
+        count += entry.second.expired() ? 0 : 1;
+    }
+    return count;
+}
+
+std::size_t AssetCache::getHits() const {
+    return hits_;
+}
+
+std::size_t AssetCache::getMisses() const {
+    return misses_;
+}
+
+std::size_t AssetCache::getProgramBinaryHits() const {
+    return program_binary_hits_;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// vendor, renderer and version of the current context
+static std::uint64_t driver_hash() {
+    static std::uint64_t const hash = [] {
+        std::uint64_t result = utils::hash_bytes(nullptr, 0);
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            auto string = reinterpret_cast<char const*>(glGetString(name));
+            if (string) {
+                result = utils::hash_bytes(string, std::strlen(string), result);
+            }
+        }
+        return result;
+    }();
+    return hash;
+}
@@ -0,0 +1,137 @@
+#include "benchmark.hpp"
+
+#include "frame_statistics.hpp"
+#include "gl_call_statistics.hpp"
+#include "gpu_profiler.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+static bool parse_number(char const* text, double& number);
+static void print_usage(char const* executable);
+
+namespace benchmark {
+
+bool parse_options(int argc, char* argv[], options& parsed) {
+  parsed = options{"", 600, 60, 1.0 / 60.0, "", "bench_report.json"};
+  std::string resource_path{};
+  for (int i = 1; i < argc; ++i) {
+    std::string const argument{argv[i]};
+    if (argument.compare(0, 2, "--") != 0) {
+      if (!resource_path.empty()) {
+        print_usage(argv[0]);
+        return false;
+      }
+      resource_path = argument;
+      continue;
+    }
+    // every option takes a value
+    if (i + 1 >= argc) {
+      print_usage(argv[0]);
+      return false;
+    }
+    char const* value = argv[++i];
+    double number = 0.0;
+    if (argument == "--frames" && parse_number(value, number) && number >= 1.0) {
+      parsed.frames = unsigned(number);
+    }
+    else if (argument == "--warmup" && parse_number(value, number) && number >= 0.0) {
+      parsed.warmup = unsigned(number);
+    }
+    else if (argument == "--timestep" && parse_number(value, number) && number > 0.0) {
+      parsed.timestep = number;
+    }
+    else if (argument == "--path") {
+      parsed.camera_path = value;
+    }
+    else if (argument == "--report") {
+      parsed.report = value;
+    }
+    else {
+      print_usage(argv[0]);
+      return false;
+    }
+  }
+  // without argument, the default is derived from the executable path
+  if (resource_path.empty()) {
+    parsed.resource_path = utils::read_resource_path(1, argv);
+  }
+  else {
+    parsed.resource_path = resource_path;
+  }
+  if (parsed.camera_path.empty()) {
+    parsed.camera_path = parsed.resource_path + "benchmarks/flyby.path";
+  }
+  return true;
+}
+
+bool write_report(options const& settings, FrameStatistics const& statistics, GpuProfiler const& profiler,
+                  double wall_seconds) {
+  std::ofstream file{settings.report};
+  GLint viewport[4] = {0, 0, 0, 0};
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  file << "{\n"
+       << "  \"renderer\": \"" << utils::escape_json(reinterpret_cast<char const*>(glGetString(GL_RENDERER))) << "\",\n"
+       << "  \"version\": \"" << utils::escape_json(reinterpret_cast<char const*>(glGetString(GL_VERSION))) << "\",\n"
+       << "  \"resolution\": [" << viewport[2] << ", " << viewport[3] << "],\n"
+       << "  \"frames\": " << settings.frames << ",\n"
+       << "  \"warmup_frames\": " << settings.warmup << ",\n"
+       << "  \"timestep_s\": " << settings.timestep << ",\n"
+       << "  \"camera_path\": \"" << utils::escape_json(settings.camera_path) << "\",\n"
+       << "  \"wall_s\": " << wall_seconds << ",\n"
+       << "  \"frame_times_ms\": {";
+
+  char const* const metric_names[FrameStatistics::METRICS] = {"cpu", "gpu", "present"};
+  for (int i = 0; i < FrameStatistics::METRICS; ++i) {
+    FrameStatistics::summary const times{statistics.getSummary(FrameStatistics::metric(i))};
+    file << (i > 0 ? ",\n" : "\n")
+         << "    \"" << metric_names[i] << "\": {\"samples\": " << times.samples << ", \"p50\": " << times.p50_ms
+         << ", \"p90\": " << times.p90_ms << ", \"p99\": " << times.p99_ms << ", \"max\": " << times.max_ms
+         << ", \"hitches\": " << times.hitches << "}";
+  }
+
+  file << "\n  },\n"
+       << "  \"passes_ms\": [";
+  bool first = true;
+  for (auto const& pass : profiler.getStatistics()) {
+    file << (first ? "\n" : ",\n")
+         << "    {\"name\": \"" << utils::escape_json(pass.name) << "\", \"samples\": " << pass.samples << ", \"min\": " << pass.min_ms
+         << ", \"avg\": " << pass.avg_ms << ", \"max\": " << pass.max_ms << "}";
+    first = false;
+  }
+  file << "\n  ],\n";
+  // averages of the measured frames, only counted with GL_CALL_STATISTICS
+  if (gl_call_statistics::get_frames() > 0) {
+    gl_call_statistics::counters const& totals = gl_call_statistics::get_totals();
+    double const frames = double(gl_call_statistics::get_frames());
+    file << "  \"gl_calls_per_frame\": {\"calls\": " << double(totals.calls) / frames
+         << ", \"redundant_binds\": " << double(totals.redundant_binds) / frames
+         << ", \"buffer_bytes\": " << double(totals.buffer_bytes) / frames
+         << ", \"texture_bytes\": " << double(totals.texture_bytes) / frames
+         << ", \"uniform_bytes\": " << double(totals.uniform_bytes) / frames << "},\n";
+  }
+  file << "  \"dropped_gpu_frames\": " << profiler.getDroppedFrames() << "\n"
+       << "}\n";
+  return bool(file);
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static bool parse_number(char const* text, double& number) {
+  char* end = nullptr;
+  number = std::strtod(text, &end);
+  return end != text && *end == '\0';
+}
+
+static void print_usage(char const* executable) {
+  std::cerr << "usage: " << executable << " [resource path] [--frames n] [--warmup n] [--timestep seconds]"
+            << " [--path camera path] [--report json file]" << std::endl;
+}
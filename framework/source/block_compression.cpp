@@ -0,0 +1,160 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+// colour of a block texel in 0-255 range
+struct block_color {
+  float r, g, b;
+};
+
+static void encode_bc1_block(std::array<block_color, 16> const& texels, std::uint8_t* block);
+static std::uint16_t pack_565(block_color const& color);
+static block_color unpack_565(std::uint16_t packed);
+
+namespace block_compression {
+
+std::size_t bc1_size(std::size_t width, std::size_t height) {
+  return std::max<std::size_t>((width + 3) / 4, 1) * std::max<std::size_t>((height + 3) / 4, 1) * 8;
+}
+
+void encode_bc1(pixel_data const& image, std::uint8_t* blocks) {
+  std::size_t num_components = 0;
+  if (image.channels == GL_RGB) {
+    num_components = 3;
+  }
+  else if (image.channels == GL_RGBA) {
+    num_components = 4;
+  }
+  else {
+    throw std::logic_error("block_compression: BC1 needs rgb or rgba images");
+  }
+
+  std::array<block_color, 16> texels{};
+  for (std::size_t block_y = 0; block_y < image.height; block_y += 4) {
+    for (std::size_t block_x = 0; block_x < image.width; block_x += 4) {
+      for (std::size_t i = 0; i < 16; ++i) {
+        // repeat border texels of blocks exceeding the image
+        std::size_t x = std::min(block_x + i % 4, image.width - 1);
+        std::size_t y = std::min(block_y + i / 4, image.height - 1);
+        std::uint8_t const* texel = &image.pixels[(y * image.width + x) * num_components];
+        texels[i] = block_color{float(texel[0]), float(texel[1]), float(texel[2])};
+      }
+      encode_bc1_block(texels, blocks);
+      blocks += 8;
+    }
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// endpoints at the extremes of the principal axis, texels mapped to the nearest palette entry
+static void encode_bc1_block(std::array<block_color, 16> const& texels, std::uint8_t* block) {
+  block_color mean{0.0f, 0.0f, 0.0f};
+  for (auto const& texel : texels) {
+    mean.r += texel.r / 16.0f;
+    mean.g += texel.g / 16.0f;
+    mean.b += texel.b / 16.0f;
+  }
+
+  // covariance matrix, symmetric
+  float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for (auto const& texel : texels) {
+    float r = texel.r - mean.r;
+    float g = texel.g - mean.g;
+    float b = texel.b - mean.b;
+    cov[0] += r * r;
+    cov[1] += r * g;
+    cov[2] += r * b;
+    cov[3] += g * g;
+    cov[4] += g * b;
+    cov[5] += b * b;
+  }
+
+  // principal axis by power iteration
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 4; ++iteration) {
+    float r = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+    float g = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+    float b = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+    float length = std::max(std::max(std::fabs(r), std::fabs(g)), std::fabs(b));
+    if (length < 1e-6f) {
+      break;
+    }
+    axis[0] = r / length;
+    axis[1] = g / length;
+    axis[2] = b / length;
+  }
+
+  float min_t = 0.0f;
+  float max_t = 0.0f;
+  for (auto const& texel : texels) {
+    float t = (texel.r - mean.r) * axis[0] + (texel.g - mean.g) * axis[1] + (texel.b - mean.b) * axis[2];
+    min_t = std::min(min_t, t);
+    max_t = std::max(max_t, t);
+  }
+  float axis_length = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  min_t /= axis_length;
+  max_t /= axis_length;
+
+  std::uint16_t color0 = pack_565(block_color{mean.r + axis[0] * max_t, mean.g + axis[1] * max_t, mean.b + axis[2] * max_t});
+  std::uint16_t color1 = pack_565(block_color{mean.r + axis[0] * min_t, mean.g + axis[1] * min_t, mean.b + axis[2] * min_t});
+  // color0 > color1 selects the four colour mode
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  std::uint32_t indices = 0;
+  if (color0 != color1) {
+    block_color palette[4] = {unpack_565(color0), unpack_565(color1), {}, {}};
+    palette[2] = block_color{(2.0f * palette[0].r + palette[1].r) / 3.0f,
+                             (2.0f * palette[0].g + palette[1].g) / 3.0f,
+                             (2.0f * palette[0].b + palette[1].b) / 3.0f};
+    palette[3] = block_color{(palette[0].r + 2.0f * palette[1].r) / 3.0f,
+                             (palette[0].g + 2.0f * palette[1].g) / 3.0f,
+                             (palette[0].b + 2.0f * palette[1].b) / 3.0f};
+
+    for (std::size_t i = 0; i < 16; ++i) {
+      std::uint32_t best_index = 0;
+      float best_distance = INFINITY;
+      for (std::uint32_t p = 0; p < 4; ++p) {
+        float r = texels[i].r - palette[p].r;
+        float g = texels[i].g - palette[p].g;
+        float b = texels[i].b - palette[p].b;
+        float distance = r * r + g * g + b * b;
+        if (distance < best_distance) {
+          best_distance = distance;
+          best_index = p;
+        }
+      }
+      indices |= best_index << (2 * i);
+    }
+  }
+
+  // little endian endpoints followed by 2 bit indices in row-major order
+  block[0] = std::uint8_t(color0 & 0xff);
+  block[1] = std::uint8_t(color0 >> 8);
+  block[2] = std::uint8_t(color1 & 0xff);
+  block[3] = std::uint8_t(color1 >> 8);
+  for (std::size_t i = 0; i < 4; ++i) {
+    block[4 + i] = std::uint8_t((indices >> (8 * i)) & 0xff);
+  }
+}
+
+static std::uint16_t pack_565(block_color const& color) {
+  auto quantize = [](float value, float max) {
+    return unsigned(std::min(std::max(value, 0.0f), 255.0f) * max / 255.0f + 0.5f);
+  };
+  return std::uint16_t((quantize(color.r, 31.0f) << 11) | (quantize(color.g, 63.0f) << 5) | quantize(color.b, 31.0f));
+}
+
+static block_color unpack_565(std::uint16_t packed) {
+  unsigned r = (packed >> 11) & 31u;
+  unsigned g = (packed >> 5) & 63u;
+  unsigned b = packed & 31u;
+  // replicate high bits like the hardware decoder
+  return block_color{float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2))};
+}
@@ -0,0 +1,76 @@
+#include "camera_path.hpp"
+
+#include "utils.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+static glm::fvec3 catmull_rom(glm::fvec3 const& p0, glm::fvec3 const& p1, glm::fvec3 const& p2, glm::fvec3 const& p3, float t);
+
+CameraPath::CameraPath():
+    keys_{}
+{}
+
+CameraPath CameraPath::load(std::string const& file_name) {
+    CameraPath path{};
+    std::istringstream lines{utils::read_file(file_name)};
+    std::string line{};
+    for (unsigned number = 1; std::getline(lines, line); ++number) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::istringstream values{line};
+        glm::fvec3 position{};
+        glm::fvec3 target{};
+        std::string rest{};
+        if (!(values >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z) || values >> rest) {
+            throw std::invalid_argument(file_name + ":" + std::to_string(number) + ": expected six numbers");
+        }
+        path.addKey(position, target);
+    }
+    if (path.keys_.empty()) {
+        throw std::invalid_argument(file_name + ": no keys");
+    }
+    return path;
+}
+
+void CameraPath::addKey(glm::fvec3 const& position, glm::fvec3 const& target) {
+    keys_.push_back(key{position, target});
+}
+
+std::vector<CameraPath::key> const& CameraPath::getKeys() const {
+    return keys_;
+}
+
+glm::fmat4 CameraPath::getTransform(float t) const {
+    if (keys_.empty()) {
+        return glm::fmat4{};
+    }
+    // segment and position within it, the ends are repeated as outer control points
+    float const position = std::min(std::max(t, 0.0f), 1.0f) * float(keys_.size() - 1);
+    std::size_t const segment = std::min(std::size_t(position), keys_.size() > 1 ? keys_.size() - 2 : 0);
+    float const local = position - float(segment);
+    std::size_t const last = keys_.size() - 1;
+    key const& k0 = keys_[segment > 0 ? segment - 1 : 0];
+    key const& k1 = keys_[segment];
+    key const& k2 = keys_[std::min(segment + 1, last)];
+    key const& k3 = keys_[std::min(segment + 2, last)];
+
+    glm::fvec3 const eye = catmull_rom(k0.position, k1.position, k2.position, k3.position, local);
+    glm::fvec3 const target = catmull_rom(k0.target, k1.target, k2.target, k3.target, local);
+    // the camera transform places the camera, so the view matrix is inverted
+    return glm::inverse(glm::lookAt(eye, target, glm::fvec3{0.0f, 1.0f, 0.0f}));
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// uniform catmull-rom spline between p1 and p2
+static glm::fvec3 catmull_rom(glm::fvec3 const& p0, glm::fvec3 const& p1, glm::fvec3 const& p2, glm::fvec3 const& p3, float t) {
+    float const t2 = t * t;
+    float const t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                   + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
@@ -0,0 +1,145 @@
+#include "cluster_culling.hpp"
+
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding 
+using namespace gl;
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// gpu layout of a cluster, matches cluster_cull.comp
+struct gpu_cluster {
+  // center and radius of bounding sphere
+  glm::fvec4 bounds;
+  // cone axis and cutoff
+  glm::fvec4 cone;
+};
+
+// layout defined by glMultiDrawElementsIndirect
+struct draw_elements_command {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// workgroup size of cluster_cull.comp
+static const GLuint WORKGROUP_SIZE = 64;
+
+static bool cluster_visible(meshlet const& cluster, std::array<glm::fvec4, 6> const& planes, glm::fvec3 const& camera_position);
+
+namespace cluster_culling {
+
+bool gpu_supported() {
+  // compute shaders, storage buffers and indirect multi-draw are core in 4.3
+  return utils::has_version(4, 3);
+}
+
+void upload(model const& clustered_model, model_object& object) {
+  object.meshlets = std::make_shared<std::vector<meshlet> const>(clustered_model.meshlets);
+
+  if (!gpu_supported()) {
+    return;
+  }
+
+  std::vector<gpu_cluster> clusters{};
+  std::vector<draw_elements_command> commands{};
+  clusters.reserve(clustered_model.meshlets.size());
+  commands.reserve(clustered_model.meshlets.size());
+  for (auto const& cluster : clustered_model.meshlets) {
+    clusters.push_back(gpu_cluster{glm::fvec4{cluster.center, cluster.radius}, glm::fvec4{cluster.cone_axis, cluster.cone_cutoff}});
+    // instance count is written by culling
+    commands.push_back(draw_elements_command{cluster.index_count, 1, object.first_index + cluster.first_index, object.base_vertex, 0});
+  }
+
+  glGenBuffers(1, &object.cluster_BO);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, object.cluster_BO);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(gpu_cluster) * clusters.size()), clusters.data(), GL_STATIC_DRAW);
+
+  glGenBuffers(1, &object.command_BO);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, object.command_BO);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(sizeof(draw_elements_command) * commands.size()), commands.data(), GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void free(model_object& object) {
+  glDeleteBuffers(1, &object.cluster_BO);
+  glDeleteBuffers(1, &object.command_BO);
+  object.cluster_BO = 0;
+  object.command_BO = 0;
+  object.meshlets.reset();
+}
+
+void cull(model_object const& object, glm::fmat4 const& model_view_projection, glm::fvec3 const& camera_position,
+          shader_program const* cull_program, draw_list& visible) {
+  visible.counts.clear();
+  visible.offsets.clear();
+  visible.base_vertices.clear();
+  GLuint num_clusters = GLuint(object.meshlets->size());
+
+  if (cull_program && object.command_BO != 0) {
+    glUseProgram(cull_program->handle);
+    glUniformMatrix4fv(cull_program->u_locs.at("ModelViewProjection"), 1, GL_FALSE, glm::value_ptr(model_view_projection));
+    glUniform3fv(cull_program->u_locs.at("CameraPosition"), 1, glm::value_ptr(camera_position));
+    glUniform1ui(cull_program->u_locs.at("ClusterCount"), num_clusters);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, object.cluster_BO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, object.command_BO);
+    glDispatchCompute((num_clusters + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    // make written commands visible to the indirect draw
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+    visible.indirect = true;
+    return;
+  }
+
+  // frustum planes in model space from rows of the matrix
+  glm::fmat4 rows = glm::transpose(model_view_projection);
+  std::array<glm::fvec4, 6> planes{{rows[3] + rows[0], rows[3] - rows[0],
+                                    rows[3] + rows[1], rows[3] - rows[1],
+                                    rows[3] + rows[2], rows[3] - rows[2]}};
+  for (auto& plane : planes) {
+    plane /= glm::length(glm::fvec3{plane});
+  }
+
+  for (auto const& cluster : *object.meshlets) {
+    if (cluster_visible(cluster, planes, camera_position)) {
+      visible.counts.push_back(GLsizei(cluster.index_count));
+      visible.offsets.push_back(reinterpret_cast<GLvoid const*>(std::uintptr_t((object.first_index + cluster.first_index) * model::INDEX.size)));
+      visible.base_vertices.push_back(object.base_vertex);
+    }
+  }
+  visible.indirect = false;
+}
+
+void draw(model_object const& object, draw_list const& visible) {
+  if (visible.indirect) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, object.command_BO);
+    glMultiDrawElementsIndirect(object.draw_mode, model::INDEX.type, nullptr, GLsizei(object.meshlets->size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+  else if (!visible.counts.empty()) {
+    glMultiDrawElementsBaseVertex(object.draw_mode, visible.counts.data(), model::INDEX.type, visible.offsets.data(),
+                                  GLsizei(visible.counts.size()), visible.base_vertices.data());
+  }
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// same tests as cluster_cull.comp
+static bool cluster_visible(meshlet const& cluster, std::array<glm::fvec4, 6> const& planes, glm::fvec3 const& camera_position) {
+  for (auto const& plane : planes) {
+    if (glm::dot(glm::fvec3{plane}, cluster.center) + plane.w < -cluster.radius) {
+      return false;
+    }
+  }
+  glm::fvec3 view = cluster.center - camera_position;
+  return glm::dot(view, cluster.cone_axis) < cluster.cone_cutoff * glm::length(view) + cluster.radius;
+}
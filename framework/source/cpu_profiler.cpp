@@ -0,0 +1,150 @@
+#include "cpu_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// finished zone
+struct zone_event {
+  char const* name;
+  std::uint64_t begin_ns;
+  std::uint64_t end_ns;
+};
+
+// zones of one thread, only written by that thread
+struct thread_ring {
+  std::vector<zone_event> events;
+  // zones recorded so far, the ring holds the last RING_SIZE
+  std::atomic<std::uint64_t> written;
+  std::atomic<char const*> name;
+  unsigned id;
+};
+
+static std::mutex& rings_mutex();
+static std::vector<std::unique_ptr<thread_ring>>& rings();
+#ifdef CPU_PROFILER
+static thread_ring& current_ring();
+#endif
+static void write_escaped(std::FILE* file, char const* text);
+
+namespace cpu_profiler {
+
+// without CPU_PROFILER no zones are recorded and no thread allocates a ring
+#ifdef CPU_PROFILER
+zone::zone(char const* zone_name)
+ :name{zone_name}
+ ,begin_ns{now_ns()}
+{}
+
+zone::~zone() {
+  thread_ring& ring = current_ring();
+  std::uint64_t const index = ring.written.load(std::memory_order_relaxed);
+  ring.events[index % RING_SIZE] = zone_event{name, begin_ns, now_ns()};
+  // publishes the event to write_chrome_trace
+  ring.written.store(index + 1, std::memory_order_release);
+}
+#endif
+
+std::uint64_t now_ns() {
+  static auto const epoch = std::chrono::steady_clock::now();
+  return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void set_thread_name(char const* name) {
+#ifdef CPU_PROFILER
+  current_ring().name.store(name);
+#else
+  (void)name;
+#endif
+}
+
+bool write_chrome_trace(std::string const& file_name) {
+  std::FILE* file = std::fopen(file_name.c_str(), "w");
+  if (file == nullptr) {
+    return false;
+  }
+  std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+  bool first = true;
+
+  std::lock_guard<std::mutex> lock{rings_mutex()};
+  std::vector<zone_event> events{};
+  for (auto const& ring : rings()) {
+    char const* name = ring->name.load();
+    if (name != nullptr) {
+      std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", ring->id);
+      write_escaped(file, name);
+      std::fputs("\"}}", file);
+      first = false;
+    }
+
+    // copy first, the owning thread keeps recording
+    std::uint64_t const written = ring->written.load(std::memory_order_acquire);
+    std::uint64_t const begin = written > RING_SIZE ? written - RING_SIZE : 0;
+    events.clear();
+    for (std::uint64_t i = begin; i < written; ++i) {
+      events.push_back(ring->events[i % RING_SIZE]);
+    }
+    // zones overwritten while copying are dropped, including the slot the owning thread may be writing
+    std::uint64_t const rewritten = ring->written.load(std::memory_order_acquire);
+    std::uint64_t const valid = rewritten + 1 > RING_SIZE ? rewritten + 1 - RING_SIZE : 0;
+
+    for (std::uint64_t i = std::max(begin, valid); i < written; ++i) {
+      zone_event const& event = events[std::size_t(i - begin)];
+      std::fprintf(file, "%s{\"ph\":\"X\",\"name\":\"", first ? "" : ",\n");
+      write_escaped(file, event.name);
+      // microseconds with nanosecond precision
+      std::fprintf(file, "\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u}", ring->id,
+                   static_cast<unsigned long long>(event.begin_ns / 1000), unsigned(event.begin_ns % 1000),
+                   static_cast<unsigned long long>((event.end_ns - event.begin_ns) / 1000),
+                   unsigned((event.end_ns - event.begin_ns) % 1000));
+      first = false;
+    }
+  }
+  std::fputs("\n]}\n", file);
+  return std::fclose(file) == 0;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// rings outlive their threads, zones of finished workers are still written
+static std::mutex& rings_mutex() {
+  static std::mutex mutex{};
+  return mutex;
+}
+
+static std::vector<std::unique_ptr<thread_ring>>& rings() {
+  static std::vector<std::unique_ptr<thread_ring>> rings{};
+  return rings;
+}
+
+#ifdef CPU_PROFILER
+// only the first zone of a thread locks
+static thread_ring& current_ring() {
+  thread_local thread_ring* ring = nullptr;
+  if (ring == nullptr) {
+    std::unique_ptr<thread_ring> created{new thread_ring{}};
+    created->events.resize(cpu_profiler::RING_SIZE);
+    created->written.store(0);
+    created->name.store(nullptr);
+    std::lock_guard<std::mutex> lock{rings_mutex()};
+    created->id = unsigned(rings().size() + 1);
+    ring = created.get();
+    rings().push_back(std::move(created));
+  }
+  return *ring;
+}
+#endif
+
+static void write_escaped(std::FILE* file, char const* text) {
+  for (; *text != '\0'; ++text) {
+    if (*text == '"' || *text == '\\') {
+      std::fputc('\\', file);
+    }
+    std::fputc(*text, file);
+  }
+}
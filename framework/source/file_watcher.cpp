@@ -0,0 +1,92 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// interval of the stamp comparison without inotify
+static const std::chrono::milliseconds CHECK_INTERVAL{500};
+
+FileWatcher::FileWatcher():
+    files_{},
+    last_check_{std::chrono::steady_clock::now()}
+#ifdef __linux__
+    ,inotify_{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+    ,directories_{}
+#endif
+{}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (inotify_ >= 0) {
+        close(inotify_);
+    }
+#endif
+}
+
+void FileWatcher::watch(std::string const& file_name) {
+    std::string const file{utils::canonical_path(file_name)};
+    if (files_.count(file) > 0) {
+        return;
+    }
+    utils::file_stamp stamp{0, 0};
+    utils::stamp_file(file, stamp);
+    files_.emplace(file, stamp);
+#ifdef __linux__
+    if (inotify_ >= 0) {
+        // editors often replace files instead of writing them, so the directory is watched
+        std::string const directory{file.substr(0, file.find_last_of('/'))};
+        int descriptor = inotify_add_watch(inotify_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (descriptor >= 0) {
+            directories_[descriptor] = directory;
+        }
+    }
+#endif
+}
+
+std::vector<std::string> FileWatcher::changed() {
+    std::vector<std::string> files{};
+#ifdef __linux__
+    if (inotify_ >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length = 0;
+        // non-blocking, returns -1 once all events are read
+        while ((length = read(inotify_, buffer, sizeof(buffer))) > 0) {
+            for (char const* ptr = buffer; ptr < buffer + length;) {
+                auto event = reinterpret_cast<inotify_event const*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                auto directory = directories_.find(event->wd);
+                if (event->len == 0 || directory == directories_.end()) {
+                    continue;
+                }
+                std::string const file{directory->second + "/" + event->name};
+                // other files in the directory and repeated writes are ignored
+                if (files_.count(file) > 0 && std::find(files.begin(), files.end(), file) == files.end()) {
+                    files.push_back(file);
+                }
+            }
+        }
+        return files;
+    }
+#endif
+    auto const now = std::chrono::steady_clock::now();
+    if (now - last_check_ < CHECK_INTERVAL) {
+        return files;
+    }
+    last_check_ = now;
+    for (auto& file : files_) {
+        utils::file_stamp stamp{0, 0};
+        // missing while an editor replaces it, reported once it is back
+        if (utils::stamp_file(file.first, stamp)
+         && (stamp.size != file.second.size || stamp.modified != file.second.modified)) {
+            file.second = stamp;
+            files.push_back(file.first);
+        }
+    }
+    return files;
+}
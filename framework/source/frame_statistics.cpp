@@ -0,0 +1,106 @@
+#include "frame_statistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+static char const* const METRIC_NAMES[FrameStatistics::METRICS] = {"cpu", "gpu", "present"};
+
+FrameStatistics::FrameStatistics(double bucket_ms, double range_ms):
+    bucket_ms_{bucket_ms > 0.0 ? bucket_ms : 0.05},
+    histograms_{},
+    second_frames_{0},
+    second_ms_{0.0},
+    frames_per_second_{0},
+    seconds_{0}
+{
+    std::size_t const buckets = std::size_t(std::ceil(std::max(range_ms, bucket_ms_) / bucket_ms_));
+    for (auto& times : histograms_) {
+        times.buckets.assign(buckets, 0);
+    }
+    reset();
+}
+
+void FrameStatistics::record(metric type, double milliseconds) {
+    histogram& times = histograms_[type];
+    milliseconds = std::max(milliseconds, 0.0);
+    std::size_t const bucket = std::min(std::size_t(milliseconds / bucket_ms_), times.buckets.size() - 1);
+    ++times.buckets[bucket];
+    ++times.samples;
+    times.max_ms = std::max(times.max_ms, milliseconds);
+
+    if (type == PRESENT) {
+        ++second_frames_;
+        second_ms_ += milliseconds;
+        if (second_ms_ >= 1000.0) {
+            frames_per_second_ = second_frames_;
+            second_frames_ = 0;
+            second_ms_ -= 1000.0;
+            ++seconds_;
+        }
+    }
+}
+
+FrameStatistics::summary FrameStatistics::getSummary(metric type) const {
+    histogram const& times = histograms_[type];
+    summary result{times.samples, percentile(times, 0.5), percentile(times, 0.9),
+                   percentile(times, 0.99), times.max_ms, 0};
+    // buckets completely above the threshold, so a tight distribution has no hitches
+    std::size_t const first = std::size_t(std::ceil(2.0 * result.p50_ms / bucket_ms_));
+    for (std::size_t i = first; i < times.buckets.size(); ++i) {
+        result.hitches += times.buckets[i];
+    }
+    return result;
+}
+
+unsigned FrameStatistics::getFramesPerSecond() const {
+    return frames_per_second_;
+}
+
+std::uint64_t FrameStatistics::getSeconds() const {
+    return seconds_;
+}
+
+void FrameStatistics::print(std::ostream& stream) const {
+    std::ios::fmtflags const flags{stream.flags()};
+    stream << "Frame times in ms\n"
+           << std::setw(10) << "" << std::setw(10) << "samples" << std::setw(9) << "p50" << std::setw(9) << "p90"
+           << std::setw(9) << "p99" << std::setw(9) << "max" << std::setw(9) << "hitches" << "\n"
+           << std::fixed << std::setprecision(2);
+    for (int i = 0; i < METRICS; ++i) {
+        summary const times{getSummary(metric(i))};
+        stream << std::setw(10) << METRIC_NAMES[i] << std::setw(10) << times.samples;
+        if (times.samples == 0) {
+            stream << "  -\n";
+            continue;
+        }
+        stream << std::setw(9) << times.p50_ms << std::setw(9) << times.p90_ms << std::setw(9) << times.p99_ms
+               << std::setw(9) << times.max_ms << std::setw(9) << times.hitches << "\n";
+    }
+    stream.flush();
+    stream.flags(flags);
+}
+
+void FrameStatistics::reset() {
+    for (auto& times : histograms_) {
+        std::fill(times.buckets.begin(), times.buckets.end(), 0);
+        times.samples = 0;
+        times.max_ms = 0.0;
+    }
+}
+
+double FrameStatistics::percentile(histogram const& times, double fraction) const {
+    if (times.samples == 0) {
+        return 0.0;
+    }
+    // rank of the sample, counted from one
+    std::uint64_t const rank = std::max(std::uint64_t(std::ceil(fraction * double(times.samples))), std::uint64_t{1});
+    std::uint64_t counted = 0;
+    for (std::size_t i = 0; i < times.buckets.size(); ++i) {
+        counted += times.buckets[i];
+        if (counted >= rank) {
+            return std::min(double(i + 1) * bucket_ms_, times.max_ms);
+        }
+    }
+    return times.max_ms;
+}
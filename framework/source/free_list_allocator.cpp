@@ -0,0 +1,80 @@
+#include "free_list_allocator.hpp"
+
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+const std::size_t FreeListAllocator::INVALID = std::numeric_limits<std::size_t>::max();
+
+FreeListAllocator::FreeListAllocator(std::size_t capacity):
+    free_ranges_{},
+    capacity_{capacity},
+    used_{0}
+{
+    if (capacity_ > 0) {
+        free_ranges_.emplace(0, capacity_);
+    }
+}
+
+std::size_t FreeListAllocator::allocate(std::size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    for (auto range = free_ranges_.begin(); range != free_ranges_.end(); ++range) {
+        if (range->second < size) {
+            continue;
+        }
+        std::size_t offset = range->first;
+        std::size_t remaining = range->second - size;
+        free_ranges_.erase(range);
+        // keep the tail of the range available
+        if (remaining > 0) {
+            free_ranges_.emplace(offset + size, remaining);
+        }
+        used_ += size;
+        return offset;
+    }
+    return INVALID;
+}
+
+void FreeListAllocator::free(std::size_t offset, std::size_t size) {
+    if (size == 0) {
+        return;
+    }
+    if (offset + size > capacity_ || size > used_) {
+        throw std::logic_error("FreeListAllocator: range was not allocated");
+    }
+    used_ -= size;
+
+    auto next = free_ranges_.lower_bound(offset);
+    // merge with the following range
+    if (next != free_ranges_.end() && offset + size == next->first) {
+        size += next->second;
+        next = free_ranges_.erase(next);
+    }
+    // merge with the preceding range
+    if (next != free_ranges_.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    free_ranges_.emplace_hint(next, offset, size);
+}
+
+std::size_t FreeListAllocator::getCapacity() const {
+    return capacity_;
+}
+
+std::size_t FreeListAllocator::getUsed() const {
+    return used_;
+}
+
+std::size_t FreeListAllocator::getLargestFree() const {
+    std::size_t largest = 0;
+    for (auto const& range : free_ranges_) {
+        largest = range.second > largest ? range.second : largest;
+    }
+    return largest;
+}
@@ -0,0 +1,224 @@
+#include "geometry_arena.hpp"
+
+#include "mesh_builder.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+static void create_storage(GLenum target, GLsizeiptr bytes);
+
+GeometryArena::GeometryArena():
+    vertex_stride_{0},
+    vertex_AO_{0},
+    vertex_BO_{0},
+    element_BO_{0},
+    vertices_{},
+    indices_{},
+    vertex_ranges_{},
+    indices_mapped_{false}
+{}
+
+GeometryArena::GeometryArena(GLsizei vertex_stride, void (*apply_layout)(bool, GLuint),
+                             std::size_t vertex_capacity, std::size_t index_capacity):
+    vertex_stride_{vertex_stride},
+    vertex_AO_{0},
+    vertex_BO_{0},
+    element_BO_{0},
+    vertices_{vertex_capacity},
+    indices_{index_capacity},
+    vertex_ranges_{},
+    indices_mapped_{false}
+{
+    glGenVertexArrays(1, &vertex_AO_);
+    glBindVertexArray(vertex_AO_);
+
+    glGenBuffers(1, &vertex_BO_);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_BO_);
+    create_storage(GL_ARRAY_BUFFER, GLsizeiptr(vertex_stride_) * GLsizeiptr(vertex_capacity));
+
+    // index binding is stored in the VAO and stays there for all meshes
+    glGenBuffers(1, &element_BO_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_BO_);
+    create_storage(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(model::INDEX.size * index_capacity));
+
+    if (mesh_builder::separate_format_supported()) {
+        apply_layout(true, 0);
+        glBindVertexBuffer(0, vertex_BO_, 0, vertex_stride_);
+    }
+    else {
+        apply_layout(false, 0);
+    }
+    glBindVertexArray(0);
+}
+
+GeometryArena::GeometryArena(GeometryArena&& other):
+    GeometryArena{}
+{
+    *this = std::move(other);
+}
+
+GeometryArena& GeometryArena::operator=(GeometryArena&& other) {
+    if (this != &other) {
+        release();
+        vertex_stride_ = other.vertex_stride_;
+        vertex_AO_ = other.vertex_AO_;
+        vertex_BO_ = other.vertex_BO_;
+        element_BO_ = other.element_BO_;
+        vertices_ = std::move(other.vertices_);
+        indices_ = std::move(other.indices_);
+        vertex_ranges_ = std::move(other.vertex_ranges_);
+        // other no longer owns the gpu objects
+        other.vertex_AO_ = 0;
+        other.vertex_BO_ = 0;
+        other.element_BO_ = 0;
+        other.vertex_ranges_.clear();
+    }
+    return *this;
+}
+
+GeometryArena::~GeometryArena() {
+    release();
+}
+
+void GeometryArena::release() {
+    glDeleteBuffers(1, &vertex_BO_);
+    glDeleteBuffers(1, &element_BO_);
+    glDeleteVertexArrays(1, &vertex_AO_);
+    vertex_AO_ = 0;
+    vertex_BO_ = 0;
+    element_BO_ = 0;
+}
+
+model_object GeometryArena::allocate(GLvoid const* vertices, std::size_t vertex_num,
+                                     GLuint const* indices, std::size_t index_num, GLenum draw_mode) {
+    // an empty range has no offset of its own, it would share the base vertex of another mesh
+    if (vertex_num == 0) {
+        throw std::logic_error("GeometryArena: mesh has no vertices");
+    }
+    std::size_t base_vertex = vertices_.allocate(vertex_num);
+    if (base_vertex == FreeListAllocator::INVALID) {
+        throw std::runtime_error("GeometryArena: out of vertex storage");
+    }
+    std::size_t first_index = indices_.allocate(index_num);
+    if (first_index == FreeListAllocator::INVALID) {
+        vertices_.free(base_vertex, vertex_num);
+        throw std::runtime_error("GeometryArena: out of index storage");
+    }
+
+    model_object object{};
+    object.vertex_AO = vertex_AO_;
+    object.vertex_BO = vertex_BO_;
+    // meshes without indices are drawn with glDrawArrays
+    object.element_BO = index_num > 0 ? element_BO_ : 0;
+    object.draw_mode = draw_mode;
+    object.num_elements = GLsizei(index_num > 0 ? index_num : vertex_num);
+    object.base_vertex = GLint(base_vertex);
+    object.first_index = GLuint(first_index);
+    object.suballocated = true;
+    vertex_ranges_[object.base_vertex] = vertex_num;
+
+    // copy targets do not touch the index binding of the VAO
+    if (vertices && vertex_num > 0) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_BO_);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(vertex_stride_) * GLintptr(base_vertex),
+                        GLsizeiptr(vertex_stride_) * GLsizeiptr(vertex_num), vertices);
+    }
+    if (indices && index_num > 0) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, element_BO_);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(model::INDEX.size * first_index),
+                        GLsizeiptr(model::INDEX.size * index_num), indices);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return object;
+}
+
+model_object GeometryArena::allocate(model const& source, GLenum draw_mode) {
+    if (GLsizei(source.vertex_bytes) != vertex_stride_) {
+        throw std::logic_error("GeometryArena: model attributes do not match vertex layout");
+    }
+    return allocate(source.data.data(), source.vertex_num,
+                    source.indices.empty() ? nullptr : source.indices.data(), source.indices.size(), draw_mode);
+}
+
+void GeometryArena::free(model_object& object) {
+    auto range = vertex_ranges_.find(object.base_vertex);
+    if (!object.suballocated || object.vertex_AO != vertex_AO_ || range == vertex_ranges_.end()) {
+        throw std::logic_error("GeometryArena: mesh was not allocated from this arena");
+    }
+    vertices_.free(std::size_t(object.base_vertex), range->second);
+    if (object.element_BO != 0) {
+        indices_.free(object.first_index, std::size_t(object.num_elements));
+    }
+    vertex_ranges_.erase(range);
+    object = model_object{};
+}
+
+void GeometryArena::map(model_object const& object, GLvoid*& vertices, GLuint*& indices) {
+    std::size_t vertex_num = vertex_ranges_.at(object.base_vertex);
+    // copy targets do not touch VAO state
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_BO_);
+    vertices = glMapBufferRange(GL_COPY_WRITE_BUFFER, GLintptr(vertex_stride_) * object.base_vertex,
+                                GLsizeiptr(vertex_stride_) * GLsizeiptr(vertex_num),
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    indices = nullptr;
+    if (object.element_BO != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, element_BO_);
+        indices = static_cast<GLuint*>(glMapBufferRange(GL_COPY_READ_BUFFER, GLintptr(model::INDEX.size * object.first_index),
+                                                        GLsizeiptr(model::INDEX.size) * object.num_elements,
+                                                        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+        indices_mapped_ = true;
+    }
+}
+
+void GeometryArena::unmap() {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertex_BO_);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    // index buffer is only mapped for indexed meshes
+    if (indices_mapped_) {
+        glBindBuffer(GL_COPY_READ_BUFFER, element_BO_);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        indices_mapped_ = false;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+GLuint GeometryArena::getVertexArray() const {
+    return vertex_AO_;
+}
+
+std::size_t GeometryArena::getVertexCapacity() const {
+    return vertices_.getCapacity();
+}
+
+std::size_t GeometryArena::getIndexCapacity() const {
+    return indices_.getCapacity();
+}
+
+std::size_t GeometryArena::getUsedVertices() const {
+    return vertices_.getUsed();
+}
+
+std::size_t GeometryArena::getUsedIndices() const {
+    return indices_.getUsed();
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// allocate fixed-size storage, immutable if supported
+static void create_storage(GLenum target, GLsizeiptr bytes) {
+    static bool const immutable = utils::has_version(4, 4) || utils::has_extension("GL_ARB_buffer_storage");
+    if (immutable) {
+        // sub data uploads and mapping for procedural meshes
+        glBufferStorage(target, bytes, nullptr, GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT);
+    }
+    else {
+        glBufferData(target, bytes, nullptr, GL_STATIC_DRAW);
+    }
+}
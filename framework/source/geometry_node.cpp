@@ -1,9 +1,21 @@
 #include "geometry_node.hpp"
+#include "cpu_profiler.hpp"
+#include "mesh_builder.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
-#include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+
+static GLint requested_level(texture_residency const& residency, glm::fmat4 const& model_matrix,
+                             glm::mat4 const& view_transform, glm::mat4 const& projection_matrix,
+                             float viewport_height);
+
+glm::mat4 GeometryNode::projection_matrix_{};
+float GeometryNode::viewport_height_ = 1.0f;
+GpuProfiler* GeometryNode::profiler_ = nullptr;
+double GeometryNode::time_ = 0.0;
 
 /// getter of geometry
 /// \return model_object geometry
@@ -25,6 +37,36 @@ void GeometryNode::setTexture(const texture_object &texture) {
     texture_ = texture;
 }
 
+const virtual_texture_object &GeometryNode::getVirtualTexture() const {
+    return virtual_texture_;
+}
+
+void GeometryNode::setVirtualTexture(const virtual_texture_object &virtual_texture) {
+    virtual_texture_ = virtual_texture;
+}
+
+/// setter for projection used to cull clustered geometry
+/// \param projection_matrix
+void GeometryNode::setProjectionMatrix(const glm::mat4 &projection_matrix) {
+    projection_matrix_ = projection_matrix;
+}
+
+/// setter for framebuffer height used to pick streamed mip levels
+/// \param viewport_height
+void GeometryNode::setViewportHeight(float viewport_height) {
+    viewport_height_ = viewport_height;
+}
+
+void GeometryNode::setProfiler(GpuProfiler* profiler) {
+    profiler_ = profiler;
+}
+
+/// setter for the scene time, set by the application instead of read from the window clock
+/// \param seconds
+void GeometryNode::setTime(double seconds) {
+    time_ = seconds;
+}
+
 void GeometryNode::renderPlanet(const std::map<std::string, shader_program> &m_shaders,
                                 const glm::mat4 &m_view_transform) const {
 
@@ -32,7 +74,7 @@ void GeometryNode::renderPlanet(const std::map<std::string, shader_program> &m_s
     glUseProgram(m_shaders.at("planet").handle);
     // rotate planets around own y-axis
     glm::fmat4 model_matrix = getWorldTransform() * getLocalTransform();
-    model_matrix = model_matrix * glm::rotate(glm::fmat4{}, float(glfwGetTime()), glm::fvec3{0.0f, 1.0f, 0.0f});
+    model_matrix = model_matrix * glm::rotate(glm::fmat4{}, float(time_), glm::fvec3{0.0f, 1.0f, 0.0f});
     glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("ModelMatrix"),
                        1, GL_FALSE, glm::value_ptr(model_matrix));
 
@@ -41,10 +83,31 @@ void GeometryNode::renderPlanet(const std::map<std::string, shader_program> &m_s
     gl::glUniformMatrix4fv(m_shaders.at("planet").u_locs.at("NormalMatrix"),
                            1, GL_FALSE, glm::value_ptr(normal_matrix));
 
+    // finer levels are streamed in once the planet covers enough pixels
+    if (texture_.residency) {
+        texture_.residency->requested_level = requested_level(*texture_.residency, model_matrix, m_view_transform,
+                                                              projection_matrix_, viewport_height_);
+        texture_.residency->used = true;
+    }
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_.handle);
     glUniform1i(m_shaders.at("planet").u_locs.at("TextureSampler"), 0);
 
+    // virtual textures are sampled through their page table
+    glUniform1i(m_shaders.at("planet").u_locs.at("VirtualTexture"), GLint(virtual_texture_.id));
+    if (virtual_texture_.id != 0) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, virtual_texture_.page_table);
+        glUniform1i(m_shaders.at("planet").u_locs.at("PageTable"), 1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, virtual_texture_.tile_cache);
+        glUniform1i(m_shaders.at("planet").u_locs.at("TileCache"), 2);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform4i(m_shaders.at("planet").u_locs.at("VirtualLayout"), virtual_texture_.width, virtual_texture_.height,
+                    virtual_texture_.tile_size, virtual_texture_.num_levels);
+        glUniform2i(m_shaders.at("planet").u_locs.at("CacheLayout"), virtual_texture_.cache_tiles, virtual_texture_.border);
+    }
+
     // camera position as derived from m_view_transform (last column)
     glm::vec4 camera_position = m_view_transform[3];
     gl::glUniform4fv(m_shaders.at("planet").u_locs.at("CameraPosition"), 1, glm::value_ptr(camera_position));
@@ -62,13 +125,13 @@ void GeometryNode::renderPlanet(const std::map<std::string, shader_program> &m_s
     }
 
     // bind the VAO to draw
-    gl::glBindVertexArray(geometry_.vertex_AO);
+    mesh_builder::bind(geometry_);
 
     // draw bound vertex array using bound shader
-    gl::glDrawElements(geometry_.draw_mode, geometry_.num_elements, model::INDEX.type, nullptr);
+    mesh_builder::draw(geometry_);
 }
 
-/// renders the stars using glDrawArray
+/// renders the stars as points
 /// \param m_shaders shader information
 /// \param m_view_transform camera information
 void GeometryNode::renderStars(const std::map<std::string, shader_program> &m_shaders,
@@ -80,11 +143,11 @@ void GeometryNode::renderStars(const std::map<std::string, shader_program> &m_sh
     glUniformMatrix4fv(m_shaders.at("stars").u_locs.at("ModelMatrix"),
                        1, GL_FALSE, glm::value_ptr(model_matrix));
 
-    gl::glBindVertexArray(geometry_.vertex_AO);
-    glDrawArrays(geometry_.draw_mode, 0,geometry_.num_elements);
+    mesh_builder::bind(geometry_);
+    mesh_builder::draw(geometry_);
 }
 
-/// renders orbits using glDrawArray
+/// renders orbits as line loops
 /// \param m_shaders shader information
 /// \param m_view_transform camera information
 void GeometryNode::renderOrbit(const std::map<std::string, shader_program> &m_shaders,
@@ -95,19 +158,29 @@ void GeometryNode::renderOrbit(const std::map<std::string, shader_program> &m_sh
     glUniformMatrix4fv(m_shaders.at("orbit").u_locs.at("ModelMatrix"),
                        1, GL_FALSE, glm::value_ptr(model_matrix));
 
-    gl::glBindVertexArray(geometry_.vertex_AO);
+    mesh_builder::bind(geometry_);
 
-    glDrawArrays(geometry_.draw_mode,0, geometry_.num_elements);
+    mesh_builder::draw(geometry_);
 }
 
 /// renders USS Enterprise orbiting around Jupiter
 /// \param m_shaders
 /// \param m_view_transform
 void GeometryNode::renderEnterprise(const std::map<std::string, shader_program> &m_shaders,
-                                    const glm::mat4 &m_view_transform) const {
+                                    const glm::mat4 &m_view_transform) {
 
-    glUseProgram(m_shaders.at("enterprise").handle);
     glm::fmat4 model_matrix = getWorldTransform() * getLocalTransform();
+
+    // cull clusters before binding the render program, gpu culling uses its own program
+    if (geometry_.meshlets) {
+        auto cull_program = m_shaders.find("cluster-cull");
+        glm::fmat4 model_view_projection = projection_matrix_ * glm::inverse(m_view_transform) * model_matrix;
+        glm::fvec3 camera_position{glm::inverse(model_matrix) * m_view_transform[3]};
+        cluster_culling::cull(geometry_, model_view_projection, camera_position,
+                              cull_program != m_shaders.end() ? &cull_program->second : nullptr, visible_clusters_);
+    }
+
+    glUseProgram(m_shaders.at("enterprise").handle);
     glUniformMatrix4fv(m_shaders.at("enterprise").u_locs.at("ModelMatrix"),
                        1, GL_FALSE, glm::value_ptr(model_matrix));
 
@@ -127,15 +200,27 @@ void GeometryNode::renderEnterprise(const std::map<std::string, shader_program>
     gl::glUniform3f(m_shaders.at("enterprise").u_locs.at("AmbientColor"),
                     0.5f, 0.5f, 0.5f);
 
+    if (texture_.residency) {
+        texture_.residency->requested_level = requested_level(*texture_.residency, model_matrix, m_view_transform,
+                                                              projection_matrix_, viewport_height_);
+        texture_.residency->used = true;
+    }
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, texture_.handle);
     glUniform1i(m_shaders.at("enterprise").u_locs.at("TextureSampler"), 0);
+    // the program is shared with the planets, which may have left a virtual texture set
+    glUniform1i(m_shaders.at("enterprise").u_locs.at("VirtualTexture"), 0);
 
     // bind the VAO to draw
-    gl::glBindVertexArray(geometry_.vertex_AO);
+    mesh_builder::bind(geometry_);
 
-    // draw bound vertex array using bound shader
-    gl::glDrawElements(geometry_.draw_mode, geometry_.num_elements, model::INDEX.type, nullptr);
+    // draw only visible clusters if geometry is clustered
+    if (geometry_.meshlets) {
+        cluster_culling::draw(geometry_, visible_clusters_);
+    } else {
+        // draw bound vertex array using bound shader
+        mesh_builder::draw(geometry_);
+    }
 }
 
 /// render geometry Node
@@ -143,11 +228,14 @@ void GeometryNode::renderEnterprise(const std::map<std::string, shader_program>
 /// \param m_view_transform cemara information
 void GeometryNode::renderNode(const std::map<std::string, shader_program> &m_shaders,
                               const glm::mat4 &m_view_transform) {
+    PROFILE_ZONE("GeometryNode::renderNode");
     if (name_.find("Planet") != std::string::npos) {
         renderPlanet(m_shaders, m_view_transform);
     } else if (name_ == "Star-Geometry") {
+        GpuProfiler::Scope scope{profiler_, "stars"};
         renderStars(m_shaders, m_view_transform);
     } else if (name_ == "Orbit") {
+        GpuProfiler::Scope scope{profiler_, "orbits"};
         renderOrbit(m_shaders, m_view_transform);
     } else if (name_ == "Enterprise-Geometry") {
         //std::cout << "rendering enterprise \n";
@@ -155,5 +243,22 @@ void GeometryNode::renderNode(const std::map<std::string, shader_program> &m_sha
     }
 }
 
-
-
+///////////////////////////// local helper functions //////////////////////////
+// finest mip level needed for the projected size of a unit radius mesh
+static GLint requested_level(texture_residency const& residency, glm::fmat4 const& model_matrix,
+                             glm::mat4 const& view_transform, glm::mat4 const& projection_matrix,
+                             float viewport_height) {
+    if (residency.num_levels == 0) {
+        return 0;
+    }
+    float radius = glm::length(glm::fvec3{model_matrix[0]});
+    float distance = glm::length(glm::fvec3{model_matrix[3] - view_transform[3]});
+    if (distance <= radius) {
+        return 0;
+    }
+    // diameter in pixels, the texture wraps around so half its width covers it
+    float pixels = 2.0f * radius / distance * projection_matrix[1][1] * viewport_height * 0.5f;
+    float texels = float(residency.width) * 0.5f;
+    GLint level = GLint(std::floor(std::log2(texels / std::max(pixels, 1.0f))));
+    return std::min(std::max(level, 0), residency.num_levels - 1);
+}
@@ -0,0 +1,497 @@
+#include "gl_call_statistics.hpp"
+
+#include <glbinding/Binding.h>
+#include <glbinding/FunctionCall.h>
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <unordered_map>
+
+// functions listed by print
+static const std::size_t PRINTED_FUNCTIONS = 10;
+// bound objects are unknown until bound once
+static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+static gl_call_statistics::counters current{0, 0, 0, 0, 0};
+static gl_call_statistics::counters last{0, 0, 0, 0, 0};
+static gl_call_statistics::counters totals{0, 0, 0, 0, 0};
+static std::uint64_t frames = 0;
+// calls of the current frame per function, kept when the frame ends so functions are only inserted once
+static std::unordered_map<glbinding::AbstractFunction const*, std::uint64_t> function_counts{};
+static std::vector<gl_call_statistics::function_calls> last_functions{};
+
+// tracked bindings, textures per unit and target, or of glBindTextureUnit with target GL_NONE
+static GLuint bound_program = UNKNOWN;
+static GLuint bound_vertex_array = UNKNOWN;
+static GLuint bound_unpack_buffer = UNKNOWN;
+static unsigned active_texture_unit = 0;
+static std::unordered_map<std::uint64_t, GLuint> bound_textures{};
+
+// write mapping of a buffer, keyed by target or by name with bit 32 set for named buffers
+struct buffer_mapping {
+  std::uint64_t length;
+  bool explicit_flush;
+  std::uint64_t flushed;
+};
+static std::unordered_map<std::uint64_t, buffer_mapping> mappings{};
+
+static void track_binds(bool enable);
+static void track_uploads(bool enable);
+static void track_uniforms(bool enable);
+static void bind(GLuint& bound, GLuint object);
+static void bind_texture(unsigned unit, GLenum target, GLuint texture);
+static void count_texture_upload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                 void const* pixels);
+static void count_compressed_upload(GLsizei bytes, void const* data);
+static void map_buffer(std::uint64_t key, GLsizeiptr length, BufferAccessMask access);
+static void flush_buffer(std::uint64_t key, GLsizeiptr length);
+static void unmap_buffer(std::uint64_t key);
+static std::uint64_t pixel_bytes(GLenum format, GLenum type);
+template<typename... Arguments>
+static void track_uniform(glbinding::Function<void, GLint, Arguments...>& function, std::uint64_t bytes, bool enable);
+template<typename Value>
+static void track_uniform_array(glbinding::Function<void, GLint, GLsizei, Value const*>& function, std::uint64_t bytes,
+                                bool enable);
+static void track_uniform_matrix(glbinding::Function<void, GLint, GLsizei, GLboolean, GLfloat const*>& function,
+                                 std::uint64_t bytes, bool enable);
+static void print_counters(std::ostream& stream, char const* label, double calls, double redundant_binds,
+                           double buffer_bytes, double texture_bytes, double uniform_bytes);
+
+namespace gl_call_statistics {
+
+bool requested() {
+  char const* value = std::getenv("GL_CALL_STATISTICS");
+  return value != nullptr && std::strcmp(value, "1") == 0;
+}
+
+void track(bool enable) {
+  track_binds(enable);
+  track_uploads(enable);
+  track_uniforms(enable);
+  // calls were missed while not tracking
+  bound_program = UNKNOWN;
+  bound_vertex_array = UNKNOWN;
+  bound_unpack_buffer = UNKNOWN;
+  active_texture_unit = 0;
+  bound_textures.clear();
+  mappings.clear();
+}
+
+void count(glbinding::FunctionCall const& call) {
+  ++current.calls;
+  ++function_counts[call.function];
+}
+
+void end_frame() {
+  last_functions.clear();
+  for (auto& pair : function_counts) {
+    if (pair.second > 0) {
+      last_functions.push_back(function_calls{pair.first->name(), pair.second});
+      pair.second = 0;
+    }
+  }
+  last = current;
+  totals.calls += current.calls;
+  totals.redundant_binds += current.redundant_binds;
+  totals.buffer_bytes += current.buffer_bytes;
+  totals.texture_bytes += current.texture_bytes;
+  totals.uniform_bytes += current.uniform_bytes;
+  current = counters{0, 0, 0, 0, 0};
+  ++frames;
+}
+
+counters const& get_last_frame() {
+  return last;
+}
+
+std::vector<function_calls> get_last_frame_functions() {
+  std::vector<function_calls> sorted{last_functions};
+  std::sort(sorted.begin(), sorted.end(), [](function_calls const& a, function_calls const& b) {
+    return a.calls > b.calls || (a.calls == b.calls && std::strcmp(a.name, b.name) < 0);
+  });
+  return sorted;
+}
+
+counters const& get_totals() {
+  return totals;
+}
+
+std::uint64_t get_frames() {
+  return frames;
+}
+
+void print(std::ostream& stream) {
+  if (frames == 0) {
+    stream << "No gl calls counted yet" << std::endl;
+    return;
+  }
+  std::ios::fmtflags const flags{stream.flags()};
+  stream << "GL calls per frame" << std::right << std::setw(12) << "calls" << std::setw(12) << "redundant"
+         << std::setw(14) << "buffer bytes" << std::setw(15) << "texture bytes" << std::setw(15) << "uniform bytes" << "\n"
+         << std::fixed << std::setprecision(0);
+  print_counters(stream, "  last", double(last.calls), double(last.redundant_binds), double(last.buffer_bytes),
+                 double(last.texture_bytes), double(last.uniform_bytes));
+  double const count = double(frames);
+  print_counters(stream, "  average", double(totals.calls) / count, double(totals.redundant_binds) / count,
+                 double(totals.buffer_bytes) / count, double(totals.texture_bytes) / count,
+                 double(totals.uniform_bytes) / count);
+  stream << "most called in the last frame, over " << frames << " frames\n";
+  std::vector<function_calls> const functions{get_last_frame_functions()};
+  for (std::size_t i = 0; i < functions.size() && i < PRINTED_FUNCTIONS; ++i) {
+    stream << "  " << std::left << std::setw(28) << functions[i].name << std::right << std::setw(8) << functions[i].calls << "\n";
+  }
+  stream.flush();
+  stream.flags(flags);
+}
+
+void reset() {
+  totals = counters{0, 0, 0, 0, 0};
+  frames = 0;
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// callbacks only run with the after callback mask, which window_handler sets
+static void track_binds(bool enable) {
+  using glbinding::Binding;
+  if (!enable) {
+    Binding::UseProgram.clearAfterCallback();
+    Binding::BindVertexArray.clearAfterCallback();
+    Binding::DeleteVertexArrays.clearAfterCallback();
+    Binding::ActiveTexture.clearAfterCallback();
+    Binding::BindTexture.clearAfterCallback();
+    Binding::BindTextureUnit.clearAfterCallback();
+    Binding::DeleteTextures.clearAfterCallback();
+    return;
+  }
+  Binding::UseProgram.setAfterCallback([](GLuint program) {
+    bind(bound_program, program);
+  });
+  Binding::BindVertexArray.setAfterCallback([](GLuint vertex_array) {
+    bind(bound_vertex_array, vertex_array);
+  });
+  // deleting the bound vertex array binds 0
+  Binding::DeleteVertexArrays.setAfterCallback([](GLsizei count, GLuint const* vertex_arrays) {
+    if (std::find(vertex_arrays, vertex_arrays + count, bound_vertex_array) != vertex_arrays + count) {
+      bound_vertex_array = 0;
+    }
+  });
+  Binding::ActiveTexture.setAfterCallback([](GLenum texture) {
+    active_texture_unit = static_cast<unsigned>(texture) - static_cast<unsigned>(GL_TEXTURE0);
+  });
+  Binding::BindTexture.setAfterCallback([](GLenum target, GLuint texture) {
+    bind_texture(active_texture_unit, target, texture);
+  });
+  Binding::BindTextureUnit.setAfterCallback([](GLuint unit, GLuint texture) {
+    bind_texture(unit, GL_NONE, texture);
+  });
+  // deleted textures are unbound from all units
+  Binding::DeleteTextures.setAfterCallback([](GLsizei count, GLuint const* textures) {
+    for (auto& pair : bound_textures) {
+      if (std::find(textures, textures + count, pair.second) != textures + count) {
+        pair.second = 0;
+      }
+    }
+  });
+}
+
+static void track_uploads(bool enable) {
+  using glbinding::Binding;
+  if (!enable) {
+    Binding::BindBuffer.clearAfterCallback();
+    Binding::DeleteBuffers.clearAfterCallback();
+    Binding::BufferData.clearAfterCallback();
+    Binding::BufferSubData.clearAfterCallback();
+    Binding::NamedBufferData.clearAfterCallback();
+    Binding::NamedBufferSubData.clearAfterCallback();
+    Binding::MapBufferRange.clearAfterCallback();
+    Binding::MapNamedBufferRange.clearAfterCallback();
+    Binding::FlushMappedBufferRange.clearAfterCallback();
+    Binding::FlushMappedNamedBufferRange.clearAfterCallback();
+    Binding::UnmapBuffer.clearAfterCallback();
+    Binding::UnmapNamedBuffer.clearAfterCallback();
+    Binding::TexImage2D.clearAfterCallback();
+    Binding::TexImage3D.clearAfterCallback();
+    Binding::TexSubImage2D.clearAfterCallback();
+    Binding::TexSubImage3D.clearAfterCallback();
+    Binding::CompressedTexImage2D.clearAfterCallback();
+    Binding::CompressedTexImage3D.clearAfterCallback();
+    Binding::CompressedTexSubImage2D.clearAfterCallback();
+    Binding::CompressedTexSubImage3D.clearAfterCallback();
+    return;
+  }
+  // texture data comes from the bound unpack buffer, even with a null offset
+  Binding::BindBuffer.setAfterCallback([](GLenum target, GLuint buffer) {
+    if (target == GL_PIXEL_UNPACK_BUFFER) {
+      bound_unpack_buffer = buffer;
+    }
+  });
+  Binding::DeleteBuffers.setAfterCallback([](GLsizei count, GLuint const* buffers) {
+    if (std::find(buffers, buffers + count, bound_unpack_buffer) != buffers + count) {
+      bound_unpack_buffer = 0;
+    }
+  });
+  // allocations without data upload nothing
+  Binding::BufferData.setAfterCallback([](GLenum, GLsizeiptr size, void const* data, GLenum) {
+    current.buffer_bytes += data != nullptr ? std::uint64_t(size) : 0;
+  });
+  Binding::BufferSubData.setAfterCallback([](GLenum, GLintptr, GLsizeiptr size, void const*) {
+    current.buffer_bytes += std::uint64_t(size);
+  });
+  Binding::NamedBufferData.setAfterCallback([](GLuint, GLsizeiptr size, void const* data, GLenum) {
+    current.buffer_bytes += data != nullptr ? std::uint64_t(size) : 0;
+  });
+  Binding::NamedBufferSubData.setAfterCallback([](GLuint, GLintptr, GLsizeiptr size, void const*) {
+    current.buffer_bytes += std::uint64_t(size);
+  });
+  // mapped writes are counted when unmapped, the application may not write the whole range
+  Binding::MapBufferRange.setAfterCallback([](void* pointer, GLenum target, GLintptr, GLsizeiptr length,
+                                              BufferAccessMask access) {
+    if (pointer != nullptr) {
+      map_buffer(static_cast<unsigned>(target), length, access);
+    }
+  });
+  Binding::MapNamedBufferRange.setAfterCallback([](void* pointer, GLuint buffer, GLintptr, GLsizeiptr length,
+                                                   BufferAccessMask access) {
+    if (pointer != nullptr) {
+      map_buffer(std::uint64_t(1) << 32 | buffer, length, access);
+    }
+  });
+  Binding::FlushMappedBufferRange.setAfterCallback([](GLenum target, GLintptr, GLsizeiptr length) {
+    flush_buffer(static_cast<unsigned>(target), length);
+  });
+  Binding::FlushMappedNamedBufferRange.setAfterCallback([](GLuint buffer, GLintptr, GLsizeiptr length) {
+    flush_buffer(std::uint64_t(1) << 32 | buffer, length);
+  });
+  Binding::UnmapBuffer.setAfterCallback([](GLboolean, GLenum target) {
+    unmap_buffer(static_cast<unsigned>(target));
+  });
+  Binding::UnmapNamedBuffer.setAfterCallback([](GLboolean, GLuint buffer) {
+    unmap_buffer(std::uint64_t(1) << 32 | buffer);
+  });
+  Binding::TexImage2D.setAfterCallback([](GLenum, GLint, GLint, GLsizei width, GLsizei height, GLint, GLenum format,
+                                          GLenum type, void const* pixels) {
+    count_texture_upload(width, height, 1, format, type, pixels);
+  });
+  Binding::TexImage3D.setAfterCallback([](GLenum, GLint, GLint, GLsizei width, GLsizei height, GLsizei depth, GLint,
+                                          GLenum format, GLenum type, void const* pixels) {
+    count_texture_upload(width, height, depth, format, type, pixels);
+  });
+  Binding::TexSubImage2D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLsizei width, GLsizei height, GLenum format,
+                                             GLenum type, void const* pixels) {
+    count_texture_upload(width, height, 1, format, type, pixels);
+  });
+  Binding::TexSubImage3D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLint, GLsizei width, GLsizei height,
+                                             GLsizei depth, GLenum format, GLenum type, void const* pixels) {
+    count_texture_upload(width, height, depth, format, type, pixels);
+  });
+  Binding::CompressedTexImage2D.setAfterCallback([](GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei bytes,
+                                                    void const* data) {
+    count_compressed_upload(bytes, data);
+  });
+  Binding::CompressedTexImage3D.setAfterCallback([](GLenum, GLint, GLenum, GLsizei, GLsizei, GLsizei, GLint,
+                                                    GLsizei bytes, void const* data) {
+    count_compressed_upload(bytes, data);
+  });
+  Binding::CompressedTexSubImage2D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum,
+                                                       GLsizei bytes, void const* data) {
+    count_compressed_upload(bytes, data);
+  });
+  Binding::CompressedTexSubImage3D.setAfterCallback([](GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei,
+                                                       GLenum, GLsizei bytes, void const* data) {
+    count_compressed_upload(bytes, data);
+  });
+}
+
+// 4 bytes per component of float, int and unsigned uniforms
+static void track_uniforms(bool enable) {
+  using glbinding::Binding;
+  track_uniform(Binding::Uniform1f, 4, enable);
+  track_uniform(Binding::Uniform2f, 8, enable);
+  track_uniform(Binding::Uniform3f, 12, enable);
+  track_uniform(Binding::Uniform4f, 16, enable);
+  track_uniform(Binding::Uniform1i, 4, enable);
+  track_uniform(Binding::Uniform2i, 8, enable);
+  track_uniform(Binding::Uniform3i, 12, enable);
+  track_uniform(Binding::Uniform4i, 16, enable);
+  track_uniform(Binding::Uniform1ui, 4, enable);
+  track_uniform(Binding::Uniform2ui, 8, enable);
+  track_uniform(Binding::Uniform3ui, 12, enable);
+  track_uniform(Binding::Uniform4ui, 16, enable);
+  track_uniform_array(Binding::Uniform1fv, 4, enable);
+  track_uniform_array(Binding::Uniform2fv, 8, enable);
+  track_uniform_array(Binding::Uniform3fv, 12, enable);
+  track_uniform_array(Binding::Uniform4fv, 16, enable);
+  track_uniform_array(Binding::Uniform1iv, 4, enable);
+  track_uniform_array(Binding::Uniform2iv, 8, enable);
+  track_uniform_array(Binding::Uniform3iv, 12, enable);
+  track_uniform_array(Binding::Uniform4iv, 16, enable);
+  track_uniform_array(Binding::Uniform1uiv, 4, enable);
+  track_uniform_array(Binding::Uniform2uiv, 8, enable);
+  track_uniform_array(Binding::Uniform3uiv, 12, enable);
+  track_uniform_array(Binding::Uniform4uiv, 16, enable);
+  track_uniform_matrix(Binding::UniformMatrix2fv, 16, enable);
+  track_uniform_matrix(Binding::UniformMatrix3fv, 36, enable);
+  track_uniform_matrix(Binding::UniformMatrix4fv, 64, enable);
+  track_uniform_matrix(Binding::UniformMatrix2x3fv, 24, enable);
+  track_uniform_matrix(Binding::UniformMatrix3x2fv, 24, enable);
+  track_uniform_matrix(Binding::UniformMatrix2x4fv, 32, enable);
+  track_uniform_matrix(Binding::UniformMatrix4x2fv, 32, enable);
+  track_uniform_matrix(Binding::UniformMatrix3x4fv, 48, enable);
+  track_uniform_matrix(Binding::UniformMatrix4x3fv, 48, enable);
+}
+
+static void bind(GLuint& bound, GLuint object) {
+  current.redundant_binds += bound == object ? 1 : 0;
+  bound = object;
+}
+
+static void bind_texture(unsigned unit, GLenum target, GLuint texture) {
+  // target binds and glBindTextureUnit of the same unit replace each other
+  for (auto& pair : bound_textures) {
+    if (pair.first >> 32 == unit && (target == GL_NONE) != ((pair.first & 0xFFFFFFFF) == 0)) {
+      pair.second = UNKNOWN;
+    }
+  }
+  auto const inserted = bound_textures.emplace(std::uint64_t(unit) << 32 | static_cast<unsigned>(target), UNKNOWN);
+  bind(inserted.first->second, texture);
+}
+
+static void count_texture_upload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                 void const* pixels) {
+  // null pixels without unpack buffer only allocate
+  if (pixels != nullptr || (bound_unpack_buffer != 0 && bound_unpack_buffer != UNKNOWN)) {
+    current.texture_bytes += std::uint64_t(width) * std::uint64_t(height) * std::uint64_t(depth) * pixel_bytes(format, type);
+  }
+}
+
+static void count_compressed_upload(GLsizei bytes, void const* data) {
+  if (data != nullptr || (bound_unpack_buffer != 0 && bound_unpack_buffer != UNKNOWN)) {
+    current.texture_bytes += std::uint64_t(bytes);
+  }
+}
+
+static void map_buffer(std::uint64_t key, GLsizeiptr length, BufferAccessMask access) {
+  unsigned const bits = static_cast<unsigned>(access);
+  // persistent mappings stay mapped while written, reads upload nothing
+  if ((bits & static_cast<unsigned>(GL_MAP_WRITE_BIT)) == 0 || (bits & static_cast<unsigned>(GL_MAP_PERSISTENT_BIT)) != 0) {
+    mappings.erase(key);
+    return;
+  }
+  mappings[key] = buffer_mapping{std::uint64_t(length), (bits & static_cast<unsigned>(GL_MAP_FLUSH_EXPLICIT_BIT)) != 0, 0};
+}
+
+static void flush_buffer(std::uint64_t key, GLsizeiptr length) {
+  auto const mapping = mappings.find(key);
+  if (mapping != mappings.end()) {
+    mapping->second.flushed += std::uint64_t(length);
+  }
+}
+
+static void unmap_buffer(std::uint64_t key) {
+  auto const mapping = mappings.find(key);
+  if (mapping == mappings.end()) {
+    return;
+  }
+  current.buffer_bytes += mapping->second.explicit_flush ? mapping->second.flushed : mapping->second.length;
+  mappings.erase(mapping);
+}
+
+// bytes per pixel of tightly packed client data, row alignment is ignored
+static std::uint64_t pixel_bytes(GLenum format, GLenum type) {
+  switch (type) {
+    // packed types hold all components
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+      return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+      return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+      return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+      return 8;
+    default:
+      break;
+  }
+  std::uint64_t component_bytes = 1;
+  if (type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT) {
+    component_bytes = 2;
+  }
+  else if (type == GL_INT || type == GL_UNSIGNED_INT || type == GL_FLOAT) {
+    component_bytes = 4;
+  }
+  switch (format) {
+    case GL_RG:
+    case GL_RG_INTEGER:
+      return 2 * component_bytes;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+      return 3 * component_bytes;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+    case GL_BGRA_INTEGER:
+      return 4 * component_bytes;
+    default:
+      return component_bytes;
+  }
+}
+
+template<typename... Arguments>
+static void track_uniform(glbinding::Function<void, GLint, Arguments...>& function, std::uint64_t bytes, bool enable) {
+  if (!enable) {
+    function.clearAfterCallback();
+    return;
+  }
+  function.setAfterCallback([bytes](GLint, Arguments...) {
+    current.uniform_bytes += bytes;
+  });
+}
+
+template<typename Value>
+static void track_uniform_array(glbinding::Function<void, GLint, GLsizei, Value const*>& function, std::uint64_t bytes,
+                                bool enable) {
+  if (!enable) {
+    function.clearAfterCallback();
+    return;
+  }
+  function.setAfterCallback([bytes](GLint, GLsizei count, Value const*) {
+    current.uniform_bytes += bytes * std::uint64_t(count);
+  });
+}
+
+static void track_uniform_matrix(glbinding::Function<void, GLint, GLsizei, GLboolean, GLfloat const*>& function,
+                                 std::uint64_t bytes, bool enable) {
+  if (!enable) {
+    function.clearAfterCallback();
+    return;
+  }
+  function.setAfterCallback([bytes](GLint, GLsizei count, GLboolean, GLfloat const*) {
+    current.uniform_bytes += bytes * std::uint64_t(count);
+  });
+}
+
+static void print_counters(std::ostream& stream, char const* label, double calls, double redundant_binds,
+                           double buffer_bytes, double texture_bytes, double uniform_bytes) {
+  stream << std::left << std::setw(18) << label << std::right << std::setw(12) << calls << std::setw(12) << redundant_binds
+         << std::setw(14) << buffer_bytes << std::setw(15) << texture_bytes << std::setw(15) << uniform_bytes << "\n";
+}
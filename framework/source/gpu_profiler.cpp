@@ -0,0 +1,198 @@
+#include "gpu_profiler.hpp"
+
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+GpuProfiler::Scope::Scope(GpuProfiler* profiler, char const* name):
+    profiler_{profiler != nullptr && profiler->recording_ ? profiler : nullptr},
+    marker_{profiler_ != nullptr ? profiler_->begin(name) : 0}
+{}
+
+GpuProfiler::Scope::~Scope() {
+    if (profiler_ != nullptr) {
+        profiler_->end(marker_);
+    }
+}
+
+GpuProfiler::GpuProfiler(std::size_t window):
+    supported_{utils::has_version(3, 3) || utils::has_extension("GL_ARB_timer_query")},
+    window_{std::max(window, std::size_t{1})},
+    frame_{0},
+    recording_{false},
+    pools_{},
+    passes_{},
+    frame_marker_{0},
+    dropped_frames_{0},
+    frames_read_{0},
+    last_frame_ms_{0.0}
+{}
+
+GpuProfiler::~GpuProfiler() {
+    for (auto& pool : pools_) {
+        if (!pool.queries.empty()) {
+            glDeleteQueries(GLsizei(pool.queries.size()), pool.queries.data());
+        }
+    }
+}
+
+bool GpuProfiler::supported() const {
+    return supported_;
+}
+
+void GpuProfiler::beginFrame() {
+    if (!supported_) {
+        return;
+    }
+    frame_pool& pool = pools_[frame_ % FRAMES];
+    readFrame(pool);
+    pool.markers.clear();
+    pool.used_queries = 0;
+    recording_ = true;
+    frame_marker_ = begin("frame");
+}
+
+void GpuProfiler::endFrame() {
+    if (!recording_) {
+        return;
+    }
+    end(frame_marker_);
+    recording_ = false;
+    ++frame_;
+}
+
+std::size_t GpuProfiler::begin(char const* name) {
+    frame_pool& pool = pools_[frame_ % FRAMES];
+    pool.markers.push_back(marker{findPass(name), query()});
+    // the end time stamp follows in the next query, written by end
+    reserve();
+    return pool.markers.size() - 1;
+}
+
+void GpuProfiler::end(std::size_t marker) {
+    frame_pool& pool = pools_[frame_ % FRAMES];
+    glQueryCounter(pool.queries[pool.markers[marker].query + 1], GL_TIMESTAMP);
+}
+
+void GpuProfiler::setWindow(std::size_t window) {
+    window_ = std::max(window, std::size_t{1});
+    for (auto& pass : passes_) {
+        while (pass.samples.size() > window_) {
+            pass.samples.pop_front();
+        }
+    }
+}
+
+void GpuProfiler::reset() {
+    for (auto& pass : passes_) {
+        pass.samples.clear();
+    }
+    dropped_frames_ = 0;
+}
+
+std::vector<GpuProfiler::pass_statistics> GpuProfiler::getStatistics() const {
+    std::vector<pass_statistics> statistics{};
+    for (auto const& pass : passes_) {
+        if (pass.samples.empty()) {
+            continue;
+        }
+        double sum = 0.0;
+        for (double sample : pass.samples) {
+            sum += sample;
+        }
+        auto const range = std::minmax_element(pass.samples.begin(), pass.samples.end());
+        statistics.push_back(pass_statistics{pass.name, pass.samples.size(), *range.first,
+                                             sum / double(pass.samples.size()), *range.second});
+    }
+    return statistics;
+}
+
+std::size_t GpuProfiler::getDroppedFrames() const {
+    return dropped_frames_;
+}
+
+std::uint64_t GpuProfiler::getFramesRead() const {
+    return frames_read_;
+}
+
+double GpuProfiler::getLastFrameMs() const {
+    return last_frame_ms_;
+}
+
+bool GpuProfiler::writeCsv(std::string const& file_name) const {
+    std::ofstream file{file_name};
+    file << "pass,samples,min_ms,avg_ms,max_ms\n";
+    for (auto const& pass : getStatistics()) {
+        file << pass.name << "," << pass.samples << "," << pass.min_ms << "," << pass.avg_ms << "," << pass.max_ms << "\n";
+    }
+    return bool(file);
+}
+
+std::size_t GpuProfiler::findPass(char const* name) {
+    // few passes, a linear search is cheaper than hashing
+    for (std::size_t i = 0; i < passes_.size(); ++i) {
+        if (std::strcmp(passes_[i].name.c_str(), name) == 0) {
+            return i;
+        }
+    }
+    passes_.push_back(pass{name, {}});
+    return passes_.size() - 1;
+}
+
+std::size_t GpuProfiler::reserve() {
+    frame_pool& pool = pools_[frame_ % FRAMES];
+    // pools only grow, frames usually record the same scopes
+    if (pool.used_queries == pool.queries.size()) {
+        std::size_t const previous = pool.queries.size();
+        pool.queries.resize(std::max(previous * 2, std::size_t{16}));
+        glGenQueries(GLsizei(pool.queries.size() - previous), pool.queries.data() + previous);
+    }
+    return pool.used_queries++;
+}
+
+std::size_t GpuProfiler::query() {
+    std::size_t const index = reserve();
+    glQueryCounter(pools_[frame_ % FRAMES].queries[index], GL_TIMESTAMP);
+    return index;
+}
+
+void GpuProfiler::readFrame(frame_pool& pool) {
+    if (pool.markers.empty()) {
+        return;
+    }
+    // results become available in order, the end of the frame marker is written last by endFrame
+    GLuint available = 0;
+    glGetQueryObjectuiv(pool.queries[pool.markers.front().query + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == 0) {
+        ++dropped_frames_;
+        return;
+    }
+
+    std::vector<double> pass_times(passes_.size(), -1.0);
+    for (auto const& marker : pool.markers) {
+        GLuint64 begin_time = 0;
+        GLuint64 end_time = 0;
+        glGetQueryObjectui64v(pool.queries[marker.query], GL_QUERY_RESULT, &begin_time);
+        glGetQueryObjectui64v(pool.queries[marker.query + 1], GL_QUERY_RESULT, &end_time);
+        double const milliseconds = double(end_time - begin_time) * 1e-6;
+        pass_times[marker.pass] = std::max(pass_times[marker.pass], 0.0) + milliseconds;
+    }
+    // the frame pass is begun first
+    last_frame_ms_ = pass_times[pool.markers.front().pass];
+    ++frames_read_;
+    for (std::size_t i = 0; i < passes_.size(); ++i) {
+        if (pass_times[i] < 0.0) {
+            continue;
+        }
+        passes_[i].samples.push_back(pass_times[i]);
+        if (passes_[i].samples.size() > window_) {
+            passes_[i].samples.pop_front();
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "input_recording.hpp"
+
+#include "utils.hpp"
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+// first line of a recording, changed with the format
+static char const* const HEADER = "input_recording 1";
+
+InputRecording::InputRecording():
+    mode_{OFF},
+    seed_{0},
+    file_{},
+    frames_{},
+    frame_{0}
+{}
+
+bool InputRecording::record(std::string const& file_name, std::uint32_t seed) {
+    file_.open(file_name);
+    if (!file_) {
+        return false;
+    }
+    // round trip of doubles, so replayed times and cursor positions are exact
+    file_.precision(std::numeric_limits<double>::max_digits10);
+    file_ << HEADER << "\nseed " << seed << "\n";
+    mode_ = RECORD;
+    seed_ = seed;
+    return true;
+}
+
+void InputRecording::replay(std::string const& file_name) {
+    std::istringstream lines{utils::read_file(file_name)};
+    std::string line{};
+    if (!std::getline(lines, line) || line != HEADER) {
+        throw std::invalid_argument(file_name + ": not an input recording");
+    }
+    std::vector<frame> frames{};
+    std::uint32_t seed = 0;
+    for (unsigned number = 2; std::getline(lines, line); ++number) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream values{line};
+        std::string type{};
+        values >> type;
+        bool valid = false;
+        if (type == "seed") {
+            valid = bool(values >> seed);
+        }
+        else if (type == "f") {
+            frames.push_back(frame{0.0, {}});
+            valid = bool(values >> frames.back().time);
+        }
+        // events belong to the last frame
+        else if (type == "k" && !frames.empty()) {
+            event key{event::KEY, 0, 0, 0, 0.0, 0.0};
+            valid = bool(values >> key.key >> key.action >> key.mods);
+            frames.back().events.push_back(key);
+        }
+        else if (type == "m" && !frames.empty()) {
+            event mouse{event::MOUSE, 0, 0, 0, 0.0, 0.0};
+            valid = bool(values >> mouse.x >> mouse.y);
+            frames.back().events.push_back(mouse);
+        }
+        if (!valid) {
+            throw std::invalid_argument(file_name + ":" + std::to_string(number) + ": malformed line '" + line + "'");
+        }
+    }
+    mode_ = REPLAY;
+    seed_ = seed;
+    frames_ = std::move(frames);
+    frame_ = 0;
+}
+
+InputRecording::mode InputRecording::getMode() const {
+    return mode_;
+}
+
+std::uint32_t InputRecording::getSeed() const {
+    return seed_;
+}
+
+double InputRecording::beginFrame(double time) {
+    ++frame_;
+    if (mode_ == RECORD) {
+        file_ << "f " << time << "\n";
+    }
+    else if (mode_ == REPLAY && hasFrame()) {
+        return frames_[frame_ - 1].time;
+    }
+    return time;
+}
+
+bool InputRecording::hasFrame() const {
+    return mode_ != REPLAY || frame_ <= frames_.size();
+}
+
+std::vector<InputRecording::event> const& InputRecording::getEvents() const {
+    static std::vector<event> const none{};
+    return mode_ == REPLAY && frame_ > 0 && hasFrame() ? frames_[frame_ - 1].events : none;
+}
+
+void InputRecording::recordKey(int key, int action, int mods) {
+    // events before the first frame could not be replayed
+    if (mode_ == RECORD && frame_ > 0) {
+        file_ << "k " << key << " " << action << " " << mods << "\n";
+    }
+}
+
+void InputRecording::recordMouse(double x, double y) {
+    if (mode_ == RECORD && frame_ > 0) {
+        file_ << "m " << x << " " << y << "\n";
+    }
+}
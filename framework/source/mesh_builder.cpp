@@ -0,0 +1,65 @@
+#include "mesh_builder.hpp"
+
+#include "utils.hpp"
+
+#include <cstdint>
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding 
+using namespace gl;
+
+namespace mesh_builder {
+
+bool separate_format_supported() {
+  // query once, the context does not change
+  static bool const supported = utils::has_version(4, 3) || utils::has_extension("GL_ARB_vertex_attrib_binding");
+  return supported;
+}
+
+void create_buffers(model_object& object, GLvoid const* vertices, GLsizeiptr vertex_bytes,
+                    GLuint const* indices, std::size_t index_num) {
+  glGenBuffers(1, &object.vertex_BO);
+  glBindBuffer(GL_ARRAY_BUFFER, object.vertex_BO);
+  glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertices, GL_STATIC_DRAW);
+
+  if (index_num > 0) {
+    glGenBuffers(1, &object.element_BO);
+    // binding is stored in the currently bound VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.element_BO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(model::INDEX.size * index_num), indices, GL_STATIC_DRAW);
+  }
+}
+
+void bind(model_object const& object) {
+  glBindVertexArray(object.vertex_AO);
+  // shared VAOs need the buffers of this mesh
+  if (object.vertex_stride != 0) {
+    glBindVertexBuffer(0, object.vertex_BO, 0, object.vertex_stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.element_BO);
+  }
+}
+
+void draw(model_object const& object) {
+  if (object.element_BO != 0) {
+    GLvoid const* offset = reinterpret_cast<GLvoid const*>(std::uintptr_t(model::INDEX.size * object.first_index));
+    glDrawElementsBaseVertex(object.draw_mode, object.num_elements, model::INDEX.type, offset, object.base_vertex);
+  }
+  else {
+    glDrawArrays(object.draw_mode, object.base_vertex, object.num_elements);
+  }
+}
+
+void free(model_object& object) {
+  if (object.suballocated) {
+    object = model_object{};
+    return;
+  }
+  glDeleteBuffers(1, &object.vertex_BO);
+  glDeleteBuffers(1, &object.element_BO);
+  if (object.vertex_stride == 0) {
+    glDeleteVertexArrays(1, &object.vertex_AO);
+  }
+  object = model_object{};
+}
+
+}
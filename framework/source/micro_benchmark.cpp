@@ -0,0 +1,174 @@
+#include "micro_benchmark.hpp"
+
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+static double median(std::vector<double> values);
+static bool read_string(std::string const& line, std::string const& key, std::string& value);
+static bool read_number(std::string const& line, std::string const& key, double& value);
+
+// written by keep, volatile so stores cannot be elided
+static void const* volatile kept_address = nullptr;
+
+MicroBenchmark::MicroBenchmark(std::size_t warmup, std::size_t repetitions):
+    warmup_{warmup},
+    repetitions_{std::max(repetitions, std::size_t{1})},
+    results_{}
+{}
+
+void MicroBenchmark::run(std::string const& name, std::function<void()> const& function,
+                         std::function<void()> const& setup) {
+    std::vector<double> times{};
+    for (std::size_t i = 0; i < warmup_ + repetitions_; ++i) {
+        if (setup) {
+            setup();
+        }
+        std::uint64_t const begin = cpu_profiler::now_ns();
+        function();
+        std::uint64_t const end = cpu_profiler::now_ns();
+        if (i >= warmup_) {
+            times.push_back(double(end - begin) * 1e-3);
+        }
+    }
+
+    double const center = median(times);
+    std::vector<double> deviations{};
+    for (double time : times) {
+        deviations.push_back(std::abs(time - center));
+    }
+    results_.push_back(result{name, times.size(), center, median(deviations),
+                              *std::min_element(times.begin(), times.end())});
+}
+
+std::vector<MicroBenchmark::result> const& MicroBenchmark::getResults() const {
+    return results_;
+}
+
+void MicroBenchmark::print(std::ostream& stream) const {
+    std::ios::fmtflags const flags{stream.flags()};
+    stream << std::left << std::setw(40) << "case" << std::right << std::setw(14) << "median us"
+           << std::setw(12) << "mad us" << std::setw(14) << "min us" << "\n"
+           << std::fixed << std::setprecision(1);
+    for (auto const& case_result : results_) {
+        stream << std::left << std::setw(40) << case_result.name << std::right << std::setw(14) << case_result.median_us
+               << std::setw(12) << case_result.mad_us << std::setw(14) << case_result.min_us << "\n";
+    }
+    stream.flush();
+    stream.flags(flags);
+}
+
+bool MicroBenchmark::writeJson(std::string const& file_name) const {
+    std::ofstream file{file_name};
+    // one case per line, so baselines diff line by line
+    file << "{\n  \"warmup\": " << warmup_ << ",\n  \"cases\": [";
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+        result const& case_result = results_[i];
+        file << (i > 0 ? ",\n" : "\n")
+             << "    {\"name\": \"" << utils::escape_json(case_result.name) << "\", \"repetitions\": " << case_result.repetitions
+             << ", \"median_us\": " << case_result.median_us << ", \"mad_us\": " << case_result.mad_us
+             << ", \"min_us\": " << case_result.min_us << "}";
+    }
+    file << "\n  ]\n}\n";
+    return bool(file);
+}
+
+std::size_t MicroBenchmark::compare(std::string const& baseline_file, std::ostream& stream, double tolerance) const {
+    // reads the format of writeJson, not arbitrary json
+    std::vector<result> baseline{};
+    std::istringstream lines{utils::read_file(baseline_file)};
+    std::string line{};
+    while (std::getline(lines, line)) {
+        result case_result{"", 0, 0.0, 0.0, 0.0};
+        double repetitions = 0.0;
+        if (!read_string(line, "name", case_result.name)) {
+            continue;
+        }
+        if (!read_number(line, "repetitions", repetitions) || !read_number(line, "median_us", case_result.median_us)
+         || !read_number(line, "mad_us", case_result.mad_us) || !read_number(line, "min_us", case_result.min_us)) {
+            throw std::invalid_argument(baseline_file + ": malformed case '" + line + "'");
+        }
+        case_result.repetitions = std::size_t(repetitions);
+        baseline.push_back(case_result);
+    }
+
+    std::ios::fmtflags const flags{stream.flags()};
+    stream << std::left << std::setw(40) << "case" << std::right << std::setw(14) << "baseline us"
+           << std::setw(14) << "median us" << std::setw(9) << "ratio" << "\n"
+           << std::fixed << std::setprecision(1);
+    std::size_t regressions = 0;
+    for (auto const& current : results_) {
+        auto const previous = std::find_if(baseline.begin(), baseline.end(),
+                                           [&current](result const& candidate) { return candidate.name == current.name; });
+        stream << std::left << std::setw(40) << current.name << std::right;
+        if (previous == baseline.end()) {
+            stream << std::setw(14) << "-" << std::setw(14) << current.median_us << "  new\n";
+            continue;
+        }
+        double const ratio = previous->median_us > 0.0 ? current.median_us / previous->median_us : 1.0;
+        // noisy cases need a larger change to count
+        bool const regressed = current.median_us > previous->median_us * (1.0 + tolerance)
+                            && current.median_us - previous->median_us > 3.0 * (current.mad_us + previous->mad_us);
+        regressions += regressed ? 1 : 0;
+        stream << std::setw(14) << previous->median_us << std::setw(14) << current.median_us
+               << std::setw(8) << std::setprecision(2) << ratio << "x" << std::setprecision(1)
+               << (regressed ? "  regressed" : "") << "\n";
+    }
+    stream.flush();
+    stream.flags(flags);
+    return regressions;
+}
+
+void MicroBenchmark::keepAddress(void const* address) {
+    kept_address = address;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::size_t const middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + std::ptrdiff_t(middle), values.end());
+    if (values.size() % 2 == 1) {
+        return values[middle];
+    }
+    // mean of both middle values, the lower one is the largest of the lower half
+    double const upper = values[middle];
+    return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + std::ptrdiff_t(middle)));
+}
+
+static bool read_string(std::string const& line, std::string const& key, std::string& value) {
+    std::string const pattern{"\"" + key + "\": \""};
+    std::size_t position = line.find(pattern);
+    if (position == std::string::npos) {
+        return false;
+    }
+    value.clear();
+    for (position += pattern.size(); position < line.size() && line[position] != '"'; ++position) {
+        if (line[position] == '\\' && position + 1 < line.size()) {
+            ++position;
+        }
+        value += line[position];
+    }
+    return position < line.size();
+}
+
+static bool read_number(std::string const& line, std::string const& key, double& value) {
+    std::string const pattern{"\"" + key + "\": "};
+    std::size_t const position = line.find(pattern);
+    if (position == std::string::npos) {
+        return false;
+    }
+    char const* begin = line.c_str() + position + pattern.size();
+    char* end = nullptr;
+    value = std::strtod(begin, &end);
+    return end != begin;
+}
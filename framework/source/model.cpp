@@ -23,6 +23,7 @@ model::attribute const  model::INDEX{1 << 5, sizeof(unsigned),  1, GL_UNSIGNED_I
 model::model()
  :data{}
  ,indices{}
+ ,meshlets{}
  ,offsets{}
  ,vertex_bytes{0}
  ,vertex_num{0}
@@ -31,6 +32,7 @@ model::model()
 model::model(std::vector<GLfloat> const& databuff, attrib_flag_t contained_attributes, std::vector<GLuint> const& trianglebuff)
  :data(databuff)
  ,indices(trianglebuff)
+ ,meshlets{}
  ,offsets{}
  ,vertex_bytes{0}
  ,vertex_num{0}
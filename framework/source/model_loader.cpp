@@ -1,18 +1,245 @@
 #include "model_loader.hpp"
 
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
 // use floats and med precision operations
 #include <glm/gtc/type_precision.hpp>
 #include <glm/geometric.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MODEL_LOADER_SSE
+#endif
 
 namespace model_loader {
 
+// attributes generated for one shape, cached on disk
+struct shape_frames {
+  // only filled if the file provides no normals
+  std::vector<float> normals;
+  std::vector<float> tangents;
+  std::vector<float> bitangents;
+};
+
+// area weighted vertex normals, written to model.normals
 void generate_normals(tinyobj::mesh_t& model);
+// angle weighted tangents approximating MikkTSpace, bitangents carry the handedness
+// vertices are not split where tangent frames diverge, e.g. at mirrored uv seams they are averaged
+void generate_tangents(tinyobj::mesh_t const& model, std::vector<float>& tangents, std::vector<float>& bitangents);
+
+// checksum of the data the generated attributes depend on
+static std::uint32_t frames_checksum(std::vector<tinyobj::shape_t> const& shapes, model::attrib_flag_t attributes);
+// read cached attributes, fails if the cache is missing or outdated
+static bool read_frames(std::string const& path, std::uint32_t checksum, std::vector<shape_frames>& frames);
+static void write_frames(std::string const& path, std::uint32_t checksum, std::vector<shape_frames> const& frames);
+
+// vec3 attribute stored as structure of arrays for vectorized processing
+struct vec3_array {
+  explicit vec3_array(std::size_t size)
+   :x(size, 0.0f)
+   ,y(size, 0.0f)
+   ,z(size, 0.0f)
+  {}
+
+  // deinterleave xyz triples
+  explicit vec3_array(std::vector<float> const& interleaved)
+   :vec3_array{interleaved.size() / 3}
+  {
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      x[i] = interleaved[i * 3];
+      y[i] = interleaved[i * 3 + 1];
+      z[i] = interleaved[i * 3 + 2];
+    }
+  }
+
+  void add(std::size_t i, glm::fvec3 const& vec) {
+    x[i] += vec.x;
+    y[i] += vec.y;
+    z[i] += vec.z;
+  }
+
+  // add elements of other array in range
+  void add(vec3_array const& other, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      x[i] += other.x[i];
+      y[i] += other.y[i];
+      z[i] += other.z[i];
+    }
+  }
+
+  // normalize elements in range, zero vectors stay zero
+  void normalize(std::size_t begin, std::size_t end) {
+    std::size_t i = begin;
+#ifdef MODEL_LOADER_SSE
+    __m128 const epsilon = _mm_set1_ps(1e-30f);
+    __m128 const one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= end; i += 4) {
+      __m128 vx = _mm_loadu_ps(&x[i]);
+      __m128 vy = _mm_loadu_ps(&y[i]);
+      __m128 vz = _mm_loadu_ps(&z[i]);
+      __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+      __m128 inverse = _mm_div_ps(one, _mm_sqrt_ps(_mm_max_ps(length2, epsilon)));
+      _mm_storeu_ps(&x[i], _mm_mul_ps(vx, inverse));
+      _mm_storeu_ps(&y[i], _mm_mul_ps(vy, inverse));
+      _mm_storeu_ps(&z[i], _mm_mul_ps(vz, inverse));
+    }
+#endif
+    for (; i < end; ++i) {
+      float inverse = 1.0f / std::sqrt(std::max(x[i] * x[i] + y[i] * y[i] + z[i] * z[i], 1e-30f));
+      x[i] *= inverse;
+      y[i] *= inverse;
+      z[i] *= inverse;
+    }
+  }
+
+  // write elements in range as interleaved xyz triples
+  void store(std::vector<float>& interleaved, std::size_t begin, std::size_t end) const {
+    for (std::size_t i = begin; i < end; ++i) {
+      interleaved[i * 3] = x[i];
+      interleaved[i * 3 + 1] = y[i];
+      interleaved[i * 3 + 2] = z[i];
+    }
+  }
+
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+};
+
+static glm::fvec3 position(tinyobj::mesh_t const& mesh, unsigned index) {
+  return glm::fvec3{mesh.positions[index * 3], mesh.positions[index * 3 + 1], mesh.positions[index * 3 + 2]};
+}
+
+static glm::fvec2 texcoord(tinyobj::mesh_t const& mesh, unsigned index) {
+  return glm::fvec2{mesh.texcoords[index * 2], mesh.texcoords[index * 2 + 1]};
+}
+
+// Gram-Schmidt orthogonalize tangents against normals in range
+// bitangents are rebuilt from normal and tangent with the sign of the accumulated bitangent
+static void orthogonalize(vec3_array const& normal, vec3_array& tangent, vec3_array& bitangent, std::size_t begin, std::size_t end) {
+  for (std::size_t i = begin; i < end; ++i) {
+    float n_dot_t = normal.x[i] * tangent.x[i] + normal.y[i] * tangent.y[i] + normal.z[i] * tangent.z[i];
+    tangent.x[i] -= normal.x[i] * n_dot_t;
+    tangent.y[i] -= normal.y[i] * n_dot_t;
+    tangent.z[i] -= normal.z[i] * n_dot_t;
+    // missing or normal-parallel tangent, pick any perpendicular direction
+    if (tangent.x[i] * tangent.x[i] + tangent.y[i] * tangent.y[i] + tangent.z[i] * tangent.z[i] < 1e-6f) {
+      glm::fvec3 n{normal.x[i], normal.y[i], normal.z[i]};
+      glm::fvec3 t = glm::cross(n, std::abs(n.x) < 0.9f ? glm::fvec3{1.0f, 0.0f, 0.0f} : glm::fvec3{0.0f, 1.0f, 0.0f});
+      tangent.x[i] = t.x;
+      tangent.y[i] = t.y;
+      tangent.z[i] = t.z;
+    }
+  }
+  tangent.normalize(begin, end);
+  for (std::size_t i = begin; i < end; ++i) {
+    // cross(normal, tangent)
+    float cross_x = normal.y[i] * tangent.z[i] - normal.z[i] * tangent.y[i];
+    float cross_y = normal.z[i] * tangent.x[i] - normal.x[i] * tangent.z[i];
+    float cross_z = normal.x[i] * tangent.y[i] - normal.y[i] * tangent.x[i];
+    float handedness = cross_x * bitangent.x[i] + cross_y * bitangent.y[i] + cross_z * bitangent.z[i] < 0.0f ? -1.0f : 1.0f;
+    bitangent.x[i] = cross_x * handedness;
+    bitangent.y[i] = cross_y * handedness;
+    bitangent.z[i] = cross_z * handedness;
+  }
+}
+
+// writes interleaved sphere vertices in the attribute order of model::VERTEX_ATTRIBS
+class sphere_writer {
+ public:
+  sphere_writer(model::attrib_flag_t attribs, GLfloat* vertex_data, GLuint* indices)
+   :m_attribs{attribs}
+   ,m_vertex_ptr{vertex_data}
+   ,m_index_ptr{indices}
+   ,m_vertex_num{0}
+  {}
+
+  // append vertex on unit sphere, u is wrapped to lie within half a turn of u_ref
+  void vertex(glm::fvec3 const& direction, float u_ref) {
+    glm::fvec3 normal = glm::normalize(direction);
+    glm::fvec2 uv = spherical_uv(normal);
+    // prevent interpolation across the texture seam
+    if (std::abs(normal.x) < 1e-6f && std::abs(normal.z) < 1e-6f) {
+      uv.x = u_ref;
+    }
+    else if (uv.x - u_ref > 0.5f) {
+      uv.x -= 1.0f;
+    }
+    else if (uv.x - u_ref < -0.5f) {
+      uv.x += 1.0f;
+    }
+    vertex(normal, uv);
+  }
+
+  // append vertex on unit sphere with explicit texture coordinates
+  void vertex(glm::fvec3 const& normal, glm::fvec2 const& uv) {
+    // tangent points along increasing u, degenerates at the poles
+    glm::fvec3 tangent{normal.z, 0.0f, -normal.x};
+    float length = glm::length(tangent);
+    tangent = length > 1e-6f ? tangent / length : glm::fvec3{1.0f, 0.0f, 0.0f};
+
+    write(normal);
+    if (m_attribs & model::NORMAL) write(normal);
+    if (m_attribs & model::TEXCOORD) write(uv);
+    if (m_attribs & model::TANGENT) write(tangent);
+    if (m_attribs & model::BITANGENT) write(glm::cross(normal, tangent));
+    ++m_vertex_num;
+  }
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model);
+  void triangle(GLuint a, GLuint b, GLuint c) {
+    *m_index_ptr++ = a;
+    *m_index_ptr++ = b;
+    *m_index_ptr++ = c;
+  }
+
+  GLuint vertex_num() const {
+    return m_vertex_num;
+  }
+
+  // equirectangular mapping matching the planet textures
+  static glm::fvec2 spherical_uv(glm::fvec3 const& normal) {
+    float u = std::atan2(normal.x, normal.z) / (2.0f * float(M_PI));
+    if (u < 0.0f) u += 1.0f;
+    float v = 0.5f + std::asin(glm::clamp(normal.y, -1.0f, 1.0f)) / float(M_PI);
+    return glm::fvec2{u, v};
+  }
+
+ private:
+  void write(glm::fvec3 const& vec) {
+    *m_vertex_ptr++ = vec.x;
+    *m_vertex_ptr++ = vec.y;
+    *m_vertex_ptr++ = vec.z;
+  }
+  void write(glm::fvec2 const& vec) {
+    *m_vertex_ptr++ = vec.x;
+    *m_vertex_ptr++ = vec.y;
+  }
+
+  model::attrib_flag_t m_attribs;
+  GLfloat* m_vertex_ptr;
+  GLuint* m_index_ptr;
+  GLuint m_vertex_num;
+};
+
+static void uv_sphere(unsigned rings, sphere_writer& writer);
+static void ico_sphere(unsigned segments, sphere_writer& writer);
+static void cube_sphere(unsigned segments, sphere_writer& writer);
+
+// number of rings or edge segments actually used for the requested tessellation
+static unsigned sphere_segments(sphere_type type, unsigned subdivisions) {
+  return std::max(subdivisions, type == UV_SPHERE ? 2u : 1u);
+}
 
 model obj(std::string const& name, model::attrib_flag_t import_attribs){
+  PROFILE_ZONE("model_loader::obj");
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> materials;
 
@@ -34,14 +261,31 @@ model obj(std::string const& name, model::attrib_flag_t import_attribs){
 
   unsigned vertex_offset = 0;
 
-  for (auto& shape : shapes) {
-    tinyobj::mesh_t& curr_mesh = shape.mesh;
+  // generated attributes are cached next to the model file
+  std::string const cache_path{name + ".frames"};
+  std::uint32_t const checksum = frames_checksum(shapes, attributes);
+  std::vector<shape_frames> frames{};
+  bool cached = read_frames(cache_path, checksum, frames) && frames.size() == shapes.size();
+  if (!cached) {
+    frames.assign(shapes.size(), shape_frames{});
+  }
+  bool generated = false;
+
+  for (std::size_t s = 0; s < shapes.size(); ++s) {
+    tinyobj::mesh_t& curr_mesh = shapes[s].mesh;
     // prevent MSVC warning due to Win BOOL implementation
     bool has_normals = (import_attribs & model::NORMAL) != 0;
-    if(has_normals) {
-      // generate normals if necessary
-      if (curr_mesh.normals.empty()) {
+    bool has_tangents = (import_attribs & model::TANGENT) != 0;
+    bool has_bitangents = (import_attribs & model::BITANGENT) != 0;
+    // generate normals if necessary, tangent frames are built from them
+    if((has_normals || has_tangents || has_bitangents) && curr_mesh.normals.empty()) {
+      if (frames[s].normals.empty()) {
         generate_normals(curr_mesh);
+        frames[s].normals = curr_mesh.normals;
+        generated = true;
+      }
+      else {
+        curr_mesh.normals = frames[s].normals;
       }
     }
 
@@ -49,26 +293,33 @@ model obj(std::string const& name, model::attrib_flag_t import_attribs){
     if(has_uvs) {
       if (curr_mesh.texcoords.empty()) {
         has_uvs = false;
-        attributes ^= model::TEXCOORD;
+        attributes &= ~model::TEXCOORD;
         std::cerr << "Shape has no texcoords" << std::endl;
       }
     }
 
-    bool has_tangents = import_attribs & model::TANGENT;
-    std::vector<glm::fvec3> tangents;
-    if (has_tangents) {
-      if (!has_uvs) {
+    if (has_tangents || has_bitangents) {
+      if (curr_mesh.texcoords.empty()) {
         has_tangents = false;
-        attributes ^= model::TANGENT;
+        has_bitangents = false;
+        attributes &= ~(model::TANGENT | model::BITANGENT);
         std::cerr << "Shape has no texcoords" << std::endl;
       }
-      else {
-        tangents = generate_tangents(curr_mesh);
+      else if (frames[s].tangents.empty()) {
+        generate_tangents(curr_mesh, frames[s].tangents, frames[s].bitangents);
+        generated = true;
       }
     }
+    std::vector<float> const& tangents = frames[s].tangents;
+    std::vector<float> const& bitangents = frames[s].bitangents;
+
+    // reserve space for all attributes of this shape
+    std::size_t shape_vertices = curr_mesh.positions.size() / 3;
+    vertex_data.reserve(vertex_data.size() + shape_vertices * (3 + (has_normals ? 3 : 0) + (has_uvs ? 2 : 0)
+                                                               + (has_tangents ? 3 : 0) + (has_bitangents ? 3 : 0)));
 
     // push back vertex attributes
-    for (unsigned i = 0; i < curr_mesh.positions.size() / 3; ++i) {
+    for (unsigned i = 0; i < shape_vertices; ++i) {
       vertex_data.push_back(curr_mesh.positions[i * 3]);
       vertex_data.push_back(curr_mesh.positions[i * 3 + 1]);
       vertex_data.push_back(curr_mesh.positions[i * 3 + 2]);
@@ -85,9 +336,15 @@ model obj(std::string const& name, model::attrib_flag_t import_attribs){
       }
 
       if (has_tangents) {
-        vertex_data.push_back(tangents[i].x);
-        vertex_data.push_back(tangents[i].y);
-        vertex_data.push_back(tangents[i].z);
+        vertex_data.push_back(tangents[i * 3]);
+        vertex_data.push_back(tangents[i * 3 + 1]);
+        vertex_data.push_back(tangents[i * 3 + 2]);
+      }
+
+      if (has_bitangents) {
+        vertex_data.push_back(bitangents[i * 3]);
+        vertex_data.push_back(bitangents[i * 3 + 1]);
+        vertex_data.push_back(bitangents[i * 3 + 2]);
       }
     }
 
@@ -99,73 +356,418 @@ model obj(std::string const& name, model::attrib_flag_t import_attribs){
     vertex_offset += unsigned(curr_mesh.positions.size() / 3);
   }
 
+  if (generated) {
+    write_frames(cache_path, checksum, frames);
+  }
+
   return model{vertex_data, attributes, triangles};
 }
 
-void generate_normals(tinyobj::mesh_t& model) {
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
+model sphere(sphere_type type, unsigned subdivisions, model::attrib_flag_t import_attribs) {
+  model::attrib_flag_t attributes{model::POSITION | import_attribs};
+  std::size_t components = 0;
+  for (auto const& attribute : model::VERTEX_ATTRIBS) {
+    if (attribute.flag & attributes) {
+      components += attribute.components;
+    }
+  }
+  // sizes are known upfront, so storage is allocated exactly once
+  std::vector<GLfloat> vertex_data(sphere_vertex_num(type, subdivisions) * components);
+  std::vector<GLuint> triangles(sphere_index_num(type, subdivisions));
+
+  sphere(type, subdivisions, attributes, vertex_data.data(), triangles.data());
+
+  return model{vertex_data, attributes, triangles};
+}
+
+void sphere(sphere_type type, unsigned subdivisions, model::attrib_flag_t import_attribs, GLfloat* vertex_data, GLuint* indices) {
+  sphere_writer writer{model::POSITION | import_attribs, vertex_data, indices};
+  unsigned segments = sphere_segments(type, subdivisions);
 
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i], model.positions[i + 1], model.positions[i + 2]};
+  if (type == UV_SPHERE) {
+    uv_sphere(segments, writer);
+  }
+  else if (type == ICO_SPHERE) {
+    ico_sphere(segments, writer);
+  }
+  else {
+    cube_sphere(segments, writer);
   }
+}
 
-  std::vector<glm::fvec3> normals(model.positions.size() / 3, glm::fvec3{0.0f});
-  for (unsigned i = 0; i < model.indices.size(); i+=3) {
-    glm::fvec3 normal = glm::cross(positions[model.indices[i+1]] - positions[model.indices[i]], positions[model.indices[i+2]] - positions[model.indices[i]]);
+std::size_t sphere_vertex_num(sphere_type type, unsigned subdivisions) {
+  std::size_t n = sphere_segments(type, subdivisions);
+  if (type == UV_SPHERE) {
+    return (n + 1) * (2 * n + 1);
+  }
+  else if (type == ICO_SPHERE) {
+    return 20 * (n + 1) * (n + 2) / 2;
+  }
+  return 6 * (n + 1) * (n + 1);
+}
 
-    normals[model.indices[i]] += normal;
-    normals[model.indices[i+1]] += normal;
-    normals[model.indices[i+2]] += normal;
+std::size_t sphere_index_num(sphere_type type, unsigned subdivisions) {
+  std::size_t n = sphere_segments(type, subdivisions);
+  if (type == UV_SPHERE) {
+    // pole rows consist of one triangle per segment
+    return 2 * n * (n - 1) * 2 * 3;
+  }
+  else if (type == ICO_SPHERE) {
+    return 20 * n * n * 3;
+  }
+  return 6 * n * n * 2 * 3;
+}
+
+static void uv_sphere(unsigned rings, sphere_writer& writer) {
+  unsigned segments = 2 * rings;
+  // rows from north to south pole, seam column is duplicated
+  for (unsigned r = 0; r <= rings; ++r) {
+    float phi = float(M_PI) * float(r) / float(rings);
+    for (unsigned s = 0; s <= segments; ++s) {
+      float theta = 2.0f * float(M_PI) * float(s) / float(segments);
+      glm::fvec3 normal{std::sin(phi) * std::sin(theta), std::cos(phi), std::sin(phi) * std::cos(theta)};
+      writer.vertex(normal, glm::fvec2{float(s) / float(segments), 1.0f - float(r) / float(rings)});
+    }
   }
 
-  model.normals.reserve(model.positions.size());
-  for (unsigned i = 0; i < normals.size(); ++i) {
-    glm::fvec3 normal = glm::normalize(normals[i]);
-    model.normals[i * 3] = normal[0];
-    model.normals[i * 3 + 1] = normal[1];
-    model.normals[i * 3 + 2] = normal[2];
+  for (unsigned r = 0; r < rings; ++r) {
+    for (unsigned s = 0; s < segments; ++s) {
+      GLuint a = r * (segments + 1) + s;
+      GLuint b = a + segments + 1;
+      // top row only has lower, bottom row only upper triangles
+      if (r != rings - 1) {
+        writer.triangle(a, b, b + 1);
+      }
+      if (r != 0) {
+        writer.triangle(a, b + 1, a + 1);
+      }
+    }
+  }
+}
+
+static void ico_sphere(unsigned segments, sphere_writer& writer) {
+  static const float X = 0.525731112119133606f;
+  static const float Z = 0.850650808352039932f;
+  static const glm::fvec3 corners[12] = {
+    {-X, 0.0f, Z}, {X, 0.0f, Z}, {-X, 0.0f, -Z}, {X, 0.0f, -Z},
+    {0.0f, Z, X}, {0.0f, Z, -X}, {0.0f, -Z, X}, {0.0f, -Z, -X},
+    {Z, X, 0.0f}, {-Z, X, 0.0f}, {Z, -X, 0.0f}, {-Z, -X, 0.0f}
+  };
+  // counter-clockwise when seen from outside
+  static const unsigned faces[20][3] = {
+    {0, 1, 4}, {0, 4, 9}, {9, 4, 5}, {4, 8, 5}, {4, 1, 8},
+    {8, 1, 10}, {8, 10, 3}, {5, 8, 3}, {5, 3, 2}, {2, 3, 7},
+    {7, 3, 10}, {7, 10, 6}, {7, 6, 11}, {11, 6, 0}, {0, 6, 1},
+    {6, 10, 1}, {9, 11, 0}, {9, 2, 11}, {9, 5, 2}, {7, 11, 2}
+  };
+
+  // faces are subdivided individually, so vertices on face edges are not shared
+  // this allows per-face texture seam handling without a vertex lookup
+  for (auto const& face : faces) {
+    glm::fvec3 const& a = corners[face[0]];
+    glm::fvec3 edge_b = corners[face[1]] - a;
+    glm::fvec3 edge_c = corners[face[2]] - a;
+    float u_ref = sphere_writer::spherical_uv(glm::normalize(a + edge_b / 3.0f + edge_c / 3.0f)).x;
+
+    GLuint base = writer.vertex_num();
+    for (unsigned i = 0; i <= segments; ++i) {
+      for (unsigned j = 0; j <= segments - i; ++j) {
+        writer.vertex(a + edge_b * (float(i) / float(segments)) + edge_c * (float(j) / float(segments)), u_ref);
+      }
+    }
+    // index of vertex in triangular grid of this face
+    auto grid = [base, segments](unsigned i, unsigned j) {
+      return GLuint(base + i * (segments + 1) - i * (i - 1) / 2 + j);
+    };
+    for (unsigned i = 0; i < segments; ++i) {
+      for (unsigned j = 0; j < segments - i; ++j) {
+        writer.triangle(grid(i, j), grid(i + 1, j), grid(i, j + 1));
+        if (j + 1 < segments - i) {
+          writer.triangle(grid(i + 1, j), grid(i + 1, j + 1), grid(i, j + 1));
+        }
+      }
+    }
   }
 }
 
-std::vector<glm::fvec3> generate_tangents(tinyobj::mesh_t const& model) {
-  // containers for vertex attributes
-  std::vector<glm::fvec3> positions(model.positions.size() / 3);
-  std::vector<glm::fvec3> normals(model.positions.size() / 3);
-  std::vector<glm::fvec2> texcoords(model.positions.size() / 3);
-  std::vector<glm::fvec3> tangents(model.positions.size() / 3, glm::fvec3{0.0f});
+static void cube_sphere(unsigned segments, sphere_writer& writer) {
+  // face normal, right and up axis with right x up = normal
+  static const glm::fvec3 faces[6][3] = {
+    {{ 1.0f, 0.0f, 0.0f}, { 0.0f, 0.0f, -1.0f}, {0.0f, 1.0f,  0.0f}},
+    {{-1.0f, 0.0f, 0.0f}, { 0.0f, 0.0f,  1.0f}, {0.0f, 1.0f,  0.0f}},
+    {{ 0.0f, 1.0f, 0.0f}, { 1.0f, 0.0f,  0.0f}, {0.0f, 0.0f, -1.0f}},
+    {{0.0f, -1.0f, 0.0f}, { 1.0f, 0.0f,  0.0f}, {0.0f, 0.0f,  1.0f}},
+    {{ 0.0f, 0.0f, 1.0f}, { 1.0f, 0.0f,  0.0f}, {0.0f, 1.0f,  0.0f}},
+    {{0.0f, 0.0f, -1.0f}, {-1.0f, 0.0f,  0.0f}, {0.0f, 1.0f,  0.0f}}
+  };
+  // rotate cube by 45 degrees around y so the texture seam runs along cube edges
+  // only the pole faces still span the seam
+  auto rotate = [](glm::fvec3 const& p) {
+    float const c = float(M_SQRT1_2);
+    return glm::fvec3{c * (p.x + p.z), p.y, c * (p.z - p.x)};
+  };
+
+  for (auto const& face : faces) {
+    float u_ref = sphere_writer::spherical_uv(rotate(face[0])).x;
+
+    GLuint base = writer.vertex_num();
+    for (unsigned j = 0; j <= segments; ++j) {
+      for (unsigned i = 0; i <= segments; ++i) {
+        glm::fvec3 point = face[0] + face[1] * (2.0f * float(i) / float(segments) - 1.0f)
+                                   + face[2] * (2.0f * float(j) / float(segments) - 1.0f);
+        writer.vertex(rotate(point), u_ref);
+      }
+    }
+    for (unsigned j = 0; j < segments; ++j) {
+      for (unsigned i = 0; i < segments; ++i) {
+        GLuint a = base + j * (segments + 1) + i;
+        GLuint d = a + segments + 1;
+        writer.triangle(a, a + 1, d + 1);
+        writer.triangle(a, d + 1, d);
+      }
+    }
+  }
+}
 
-  // get vertex positions and texture coordinates from mesh_t
-  for (unsigned i = 0; i < model.positions.size(); i+=3) {
-    positions[i / 3] = glm::fvec3{model.positions[i],
-                                 model.positions[i + 1],
-                                 model.positions[i + 2]};
-    normals[i / 3] = glm::fvec3{model.normals[i],
-                                 model.normals[i + 1],
-                                 model.normals[i + 2]};
+// compute bounding sphere and normal cone for the triangles of a cluster
+static void meshlet_bounds(model const& model, meshlet& cluster) {
+  std::size_t stride = std::size_t(model.vertex_bytes) / sizeof(GLfloat);
+  auto position = [&model, stride](GLuint index) {
+    GLfloat const* ptr = &model.data[index * stride];
+    return glm::fvec3{ptr[0], ptr[1], ptr[2]};
+  };
+
+  glm::fvec3 min{std::numeric_limits<float>::max()};
+  glm::fvec3 max{-std::numeric_limits<float>::max()};
+  std::vector<glm::fvec3> normals{};
+  normals.reserve(cluster.index_count / 3);
+  glm::fvec3 normal_sum{0.0f};
+
+  for (GLuint i = cluster.first_index; i < cluster.first_index + cluster.index_count; i += 3) {
+    glm::fvec3 a = position(model.indices[i]);
+    glm::fvec3 b = position(model.indices[i + 1]);
+    glm::fvec3 c = position(model.indices[i + 2]);
+    min = glm::min(min, glm::min(a, glm::min(b, c)));
+    max = glm::max(max, glm::max(a, glm::max(b, c)));
+
+    glm::fvec3 normal = glm::cross(b - a, c - a);
+    float area = glm::length(normal);
+    // degenerate triangles do not restrict the cone
+    if (area > 0.0f) {
+      normals.push_back(normal / area);
+      normal_sum += normals.back();
+    }
   }
-  for (unsigned i = 0; i < model.texcoords.size(); i+=2) {
-    texcoords[i / 2] = glm::fvec2{model.texcoords[i], model.texcoords[i + 1]};
+
+  cluster.center = (min + max) * 0.5f;
+  cluster.radius = 0.0f;
+  for (GLuint i = cluster.first_index; i < cluster.first_index + cluster.index_count; ++i) {
+    cluster.radius = std::max(cluster.radius, glm::length(position(model.indices[i]) - cluster.center));
   }
 
-  // calculate tangent for triangles
-  for (unsigned i = 0; i < model.indices.size() / 3; i++) {
-    // indices of vertices of this triangle
-    // unsigned indices[3] = {model.indices[i * 3],
-    //                        model.indices[i * 3 + 1],
-    //                        model.indices[i * 3 + 2]};
-    // access an attribute of xth vert with vector access "attribute[indices[x]]"
-    
-    // calculate tangent for the triangle and add it to the accumulation tangents of the adjacent vertices
-    // see generate_normals() for similar workflow 
+  // cone around average normal, opening angle given by the most deviating normal
+  float sum_length = glm::length(normal_sum);
+  cluster.cone_axis = sum_length > 0.0f ? normal_sum / sum_length : glm::fvec3{0.0f, 0.0f, 1.0f};
+  float min_dot = sum_length > 0.0f ? 1.0f : -1.0f;
+  for (auto const& normal : normals) {
+    min_dot = std::min(min_dot, glm::dot(normal, cluster.cone_axis));
   }
-  // normalize and orthogonalize accumulated vertex tangents
-  for (unsigned i = 0; i < tangents.size(); ++i) {
-    // implement orthogonalization and normalization here
+  // wide cones never cull, so disable them
+  cluster.cone_cutoff = min_dot <= 0.1f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+}
+
+void generate_meshlets(model& model, unsigned max_vertices, unsigned max_triangles) {
+  model.meshlets.clear();
+  // cluster that last referenced a vertex, to count unique vertices per cluster
+  std::vector<std::size_t> vertex_cluster(model.vertex_num, std::numeric_limits<std::size_t>::max());
+
+  meshlet cluster{};
+  // greedily append triangles in file order, which is usually spatially coherent
+  for (GLuint i = 0; i + 2 < model.indices.size(); i += 3) {
+    unsigned new_vertices = 0;
+    for (GLuint j = i; j < i + 3; ++j) {
+      if (vertex_cluster[model.indices[j]] != model.meshlets.size()) ++new_vertices;
+    }
+    // close cluster if limits would be exceeded
+    if (cluster.vertex_count + new_vertices > max_vertices || cluster.index_count / 3 + 1 > max_triangles) {
+      meshlet_bounds(model, cluster);
+      model.meshlets.push_back(cluster);
+      cluster = meshlet{};
+      cluster.first_index = i;
+      new_vertices = 3;
+    }
+    for (GLuint j = i; j < i + 3; ++j) {
+      vertex_cluster[model.indices[j]] = model.meshlets.size();
+    }
+    cluster.vertex_count += new_vertices;
+    cluster.index_count += 3;
   }
 
-  throw std::logic_error("Tangent creation not implemented yet");
+  if (cluster.index_count > 0) {
+    meshlet_bounds(model, cluster);
+    model.meshlets.push_back(cluster);
+  }
+}
 
-  return tangents;
+void generate_normals(tinyobj::mesh_t& model) {
+  std::size_t const vertex_num = model.positions.size() / 3;
+  std::size_t const triangle_num = model.indices.size() / 3;
+  std::size_t const ranges = utils::range_num(triangle_num);
+
+  // every range scatters into its own accumulator, so no synchronisation is needed
+  std::vector<vec3_array> accumulators(ranges, vec3_array{vertex_num});
+  utils::parallel_for(triangle_num, ranges, [&model, &accumulators](std::size_t begin, std::size_t end, std::size_t range) {
+    vec3_array& normals = accumulators[range];
+    for (std::size_t t = begin; t < end; ++t) {
+      unsigned const* indices = &model.indices[t * 3];
+      glm::fvec3 p0 = position(model, indices[0]);
+      // area weighted face normal
+      glm::fvec3 normal = glm::cross(position(model, indices[1]) - p0, position(model, indices[2]) - p0);
+      for (unsigned k = 0; k < 3; ++k) {
+        normals.add(indices[k], normal);
+      }
+    }
+  });
+
+  model.normals.resize(vertex_num * 3);
+  utils::parallel_for(vertex_num, utils::range_num(vertex_num), [&model, &accumulators](std::size_t begin, std::size_t end, std::size_t) {
+    vec3_array& normals = accumulators.front();
+    for (std::size_t r = 1; r < accumulators.size(); ++r) {
+      normals.add(accumulators[r], begin, end);
+    }
+    normals.normalize(begin, end);
+    normals.store(model.normals, begin, end);
+  });
+}
+
+void generate_tangents(tinyobj::mesh_t const& model, std::vector<float>& tangents, std::vector<float>& bitangents) {
+  std::size_t const vertex_num = model.positions.size() / 3;
+  std::size_t const triangle_num = model.indices.size() / 3;
+  std::size_t const ranges = utils::range_num(triangle_num);
+
+  std::vector<vec3_array> tangent_sums(ranges, vec3_array{vertex_num});
+  std::vector<vec3_array> bitangent_sums(ranges, vec3_array{vertex_num});
+  utils::parallel_for(triangle_num, ranges, [&](std::size_t begin, std::size_t end, std::size_t range) {
+    for (std::size_t t = begin; t < end; ++t) {
+      unsigned const* indices = &model.indices[t * 3];
+      glm::fvec3 p[3] = {position(model, indices[0]), position(model, indices[1]), position(model, indices[2])};
+      glm::fvec2 uv[3] = {texcoord(model, indices[0]), texcoord(model, indices[1]), texcoord(model, indices[2])};
+
+      glm::fvec3 edge_1 = p[1] - p[0];
+      glm::fvec3 edge_2 = p[2] - p[0];
+      glm::fvec2 delta_1 = uv[1] - uv[0];
+      glm::fvec2 delta_2 = uv[2] - uv[0];
+      float determinant = delta_1.x * delta_2.y - delta_2.x * delta_1.y;
+      // skip triangles with degenerate texture mapping
+      if (std::abs(determinant) < 1e-12f) {
+        continue;
+      }
+      // like MikkTSpace, face directions are normalized and weighted by the corner angle
+      glm::fvec3 tangent = (edge_1 * delta_2.y - edge_2 * delta_1.y) / determinant;
+      glm::fvec3 bitangent = (edge_2 * delta_1.x - edge_1 * delta_2.x) / determinant;
+      float tangent_length = glm::length(tangent);
+      float bitangent_length = glm::length(bitangent);
+      if (tangent_length <= 0.0f || bitangent_length <= 0.0f) {
+        continue;
+      }
+      tangent /= tangent_length;
+      bitangent /= bitangent_length;
+
+      for (unsigned k = 0; k < 3; ++k) {
+        glm::fvec3 to_next = p[(k + 1) % 3] - p[k];
+        glm::fvec3 to_prev = p[(k + 2) % 3] - p[k];
+        float lengths = glm::length(to_next) * glm::length(to_prev);
+        float angle = lengths > 0.0f ? std::acos(glm::clamp(glm::dot(to_next, to_prev) / lengths, -1.0f, 1.0f)) : 0.0f;
+        tangent_sums[range].add(indices[k], tangent * angle);
+        bitangent_sums[range].add(indices[k], bitangent * angle);
+      }
+    }
+  });
+
+  vec3_array const normals{model.normals};
+  tangents.resize(vertex_num * 3);
+  bitangents.resize(vertex_num * 3);
+  utils::parallel_for(vertex_num, utils::range_num(vertex_num), [&](std::size_t begin, std::size_t end, std::size_t) {
+    vec3_array& tangent = tangent_sums.front();
+    vec3_array& bitangent = bitangent_sums.front();
+    for (std::size_t r = 1; r < tangent_sums.size(); ++r) {
+      tangent.add(tangent_sums[r], begin, end);
+      bitangent.add(bitangent_sums[r], begin, end);
+    }
+    orthogonalize(normals, tangent, bitangent, begin, end);
+    tangent.store(tangents, begin, end);
+    bitangent.store(bitangents, begin, end);
+  });
+}
+
+///////////////////////////// frame cache ///////////////////////////////////
+static const std::uint32_t FRAMES_MAGIC = 0x314d5246; // "FRM1"
+
+// FNV-1a over raw bytes
+static void hash_bytes(std::uint32_t& hash, void const* data, std::size_t bytes) {
+  auto ptr = static_cast<unsigned char const*>(data);
+  for (std::size_t i = 0; i < bytes; ++i) {
+    hash = (hash ^ ptr[i]) * 16777619u;
+  }
+}
+
+static std::uint32_t frames_checksum(std::vector<tinyobj::shape_t> const& shapes, model::attrib_flag_t attributes) {
+  std::uint32_t hash = 2166136261u;
+  hash_bytes(hash, &attributes, sizeof(attributes));
+  for (auto const& shape : shapes) {
+    hash_bytes(hash, shape.mesh.positions.data(), shape.mesh.positions.size() * sizeof(float));
+    hash_bytes(hash, shape.mesh.normals.data(), shape.mesh.normals.size() * sizeof(float));
+    hash_bytes(hash, shape.mesh.texcoords.data(), shape.mesh.texcoords.size() * sizeof(float));
+    hash_bytes(hash, shape.mesh.indices.data(), shape.mesh.indices.size() * sizeof(unsigned));
+  }
+  return hash;
+}
+
+static bool read_floats(std::ifstream& file, std::vector<float>& values) {
+  std::uint32_t size = 0;
+  file.read(reinterpret_cast<char*>(&size), sizeof(size));
+  values.resize(size);
+  file.read(reinterpret_cast<char*>(values.data()), std::streamsize(size * sizeof(float)));
+  return bool(file);
+}
+
+static void write_floats(std::ofstream& file, std::vector<float> const& values) {
+  std::uint32_t size = std::uint32_t(values.size());
+  file.write(reinterpret_cast<char const*>(&size), sizeof(size));
+  file.write(reinterpret_cast<char const*>(values.data()), std::streamsize(size * sizeof(float)));
+}
+
+static bool read_frames(std::string const& path, std::uint32_t checksum, std::vector<shape_frames>& frames) {
+  std::ifstream file{path, std::ios::binary};
+  std::uint32_t header[3] = {0, 0, 0};
+  file.read(reinterpret_cast<char*>(header), sizeof(header));
+  if (!file || header[0] != FRAMES_MAGIC || header[1] != checksum) {
+    return false;
+  }
+
+  frames.resize(header[2]);
+  for (auto& frame : frames) {
+    if (!read_floats(file, frame.normals) || !read_floats(file, frame.tangents) || !read_floats(file, frame.bitangents)) {
+      frames.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+static void write_frames(std::string const& path, std::uint32_t checksum, std::vector<shape_frames> const& frames) {
+  std::ofstream file{path, std::ios::binary};
+  // cache is optional, e.g. if resource directory is read-only
+  if (!file) {
+    return;
+  }
+  std::uint32_t header[3] = {FRAMES_MAGIC, checksum, std::uint32_t(frames.size())};
+  file.write(reinterpret_cast<char const*>(header), sizeof(header));
+  for (auto const& frame : frames) {
+    write_floats(file, frame.normals);
+    write_floats(file, frame.tangents);
+    write_floats(file, frame.bitangents);
+  }
 }
 
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <ostream>
 #include <glm/glm.hpp>
 
+#include "cpu_profiler.hpp"
 #include "utils.hpp"
 #include "shader_loader.hpp"
 #include "model_loader.hpp"
@@ -168,6 +169,7 @@ std::ostream& operator<<(std::ostream &os, const Node &node) {
 /// \param m_shaders
 /// \param m_view_transform
 void Node::renderNode(std::map<std::string, shader_program> const& m_shaders, glm::mat4 const& m_view_transform) {
+    PROFILE_ZONE("Node::renderNode");
     //get value to compute speed of revolution around the sun
     float revolution_value = std::find_if(PLANET_REVOLUTION.begin(), PLANET_REVOLUTION.end(),
                                           [&] (std::pair<std::string, float> const& pair) {return name_ == pair.first; })->second;
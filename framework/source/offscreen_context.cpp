@@ -0,0 +1,159 @@
+#include "offscreen_context.hpp"
+
+#include <glbinding/gl/gl.h>
+// load glbinding extensions
+#include <glbinding/Binding.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <cstring>
+#include <iostream>
+
+#ifdef OFFSCREEN_EGL
+// keep X11 macros like None and Status out of the gl code
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLSurface surface = EGL_NO_SURFACE;
+static EGLContext context = EGL_NO_CONTEXT;
+
+static EGLDisplay open_display();
+static bool has_egl_extension(EGLDisplay egl_display, char const* name);
+#endif
+
+namespace offscreen_context {
+
+bool initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigned ver_minor, bool compatibility) {
+#ifdef OFFSCREEN_EGL
+  display = open_display();
+  EGLint egl_major = 0;
+  EGLint egl_minor = 0;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &egl_major, &egl_minor)) {
+    std::cerr << "No EGL display available" << std::endl;
+    return false;
+  }
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    std::cerr << "EGL display does not support OpenGL" << std::endl;
+    terminate();
+    return false;
+  }
+
+  EGLint const config_attributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8,
+    EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8,
+    EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24,
+    EGL_NONE
+  };
+  EGLConfig config = nullptr;
+  EGLint configs = 0;
+  if (!eglChooseConfig(display, config_attributes, &config, 1, &configs) || configs == 0) {
+    std::cerr << "No EGL config with pbuffer support" << std::endl;
+    terminate();
+    return false;
+  }
+
+  EGLint const surface_attributes[] = {
+    EGL_WIDTH, EGLint(resolution.x),
+    EGL_HEIGHT, EGLint(resolution.y),
+    EGL_NONE
+  };
+  surface = eglCreatePbufferSurface(display, config, surface_attributes);
+
+  // same profile as requested from glfw, core for 3.2 and later unless compatibility is requested
+  EGLint const context_attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION_KHR, EGLint(ver_major),
+    EGL_CONTEXT_MINOR_VERSION_KHR, EGLint(ver_minor),
+    EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+    compatibility ? EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR : EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+    EGL_NONE
+  };
+  context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+  if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+    std::cerr << "Creating an offscreen OpenGL " << ver_major << "." << ver_minor
+              << (compatibility ? " compatibility" : "") << " context failed, EGL error 0x"
+              << std::hex << eglGetError() << std::dec << std::endl;
+    terminate();
+    return false;
+  }
+  // no vsync, frames are paced by swap_buffers
+  eglSwapInterval(display, 0);
+  // initialize glindings in this context
+  glbinding::Binding::initialize(reinterpret_cast<glbinding::ContextHandle>(context), true, true);
+
+  std::cout << "Created offscreen OpenGL context with version " << glGetString(GL_VERSION)
+            << " on " << glGetString(GL_RENDERER) << std::endl;
+  return true;
+#else
+  (void)resolution; (void)ver_major; (void)ver_minor; (void)compatibility;
+  std::cerr << "Offscreen contexts require EGL, which was not found at configure time" << std::endl;
+  return false;
+#endif
+}
+
+void swap_buffers() {
+#ifdef OFFSCREEN_EGL
+  // pbuffers are not presented, finishing stands in for a swap waiting on the gpu
+  eglSwapBuffers(display, surface);
+  glFinish();
+#endif
+}
+
+void terminate() {
+#ifdef OFFSCREEN_EGL
+  if (display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (context != EGL_NO_CONTEXT) {
+    eglDestroyContext(display, context);
+  }
+  if (surface != EGL_NO_SURFACE) {
+    eglDestroySurface(display, surface);
+  }
+  eglTerminate(display);
+  display = EGL_NO_DISPLAY;
+  surface = EGL_NO_SURFACE;
+  context = EGL_NO_CONTEXT;
+#endif
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+#ifdef OFFSCREEN_EGL
+// the surfaceless platform needs neither display server nor gpu device
+static EGLDisplay open_display() {
+  auto const get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+    eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display != nullptr && has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+    EGLDisplay surfaceless = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (surfaceless != EGL_NO_DISPLAY) {
+      return surfaceless;
+    }
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+// client extensions are queried without display
+static bool has_egl_extension(EGLDisplay egl_display, char const* name) {
+  char const* extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+  if (extensions == nullptr) {
+    return false;
+  }
+  std::size_t const length = std::strlen(name);
+  for (char const* found = std::strstr(extensions, name); found != nullptr; found = std::strstr(found + length, name)) {
+    // whole names only, not prefixes of longer ones
+    if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
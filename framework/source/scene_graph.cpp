@@ -1,3 +1,4 @@
+#include <functional>
 #include <string>
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp>
@@ -8,6 +9,7 @@
 #include "scene_constants.hpp"
 #include "point_light_node.hpp"
 #include "texture_loader.hpp"
+#include "utils.hpp"
 
 
 /// get name of the scene
@@ -50,19 +52,34 @@ std::ostream &operator<<(std::ostream &os, const SceneGraph &graph) {
 SceneGraph::~SceneGraph() = default;
 
 texture_object setupTexture(const std::string &textureFileName) {
-    pixel_data pixelData = texture_loader::file(textureFileName);
+    return setupTexture(texture_loader::file(textureFileName));
+}
+
+texture_object setupTexture(pixel_data const& pixelData) {
+    // build the mip chain on the cpu, deterministic unlike glGenerateMipmap
+    return setupTexture(texture_loader::mipmapped(texture_loader::generate_mipmaps(pixelData)));
+}
 
+texture_object setupTexture(texture_loader::mip_chain const& mipChain) {
     texture_object textureObject{};
     glGenTextures(1, &textureObject.handle);
     glBindTexture(GL_TEXTURE_2D, textureObject.handle);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, (int)pixelData.width, (int)pixelData.height,
-                 0, GL_RGB, GL_UNSIGNED_BYTE, pixelData.ptr());
+    // rows of small levels are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (std::size_t level = 0; level < mipChain.levels.size(); ++level) {
+        texture_loader::mip_level const& mip = mipChain.levels[level];
+        if (mipChain.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (int)level, mipChain.internal_format, (int)mip.width, (int)mip.height,
+                                   0, (int)mip.size, mip.data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, (int)level, mipChain.internal_format, (int)mip.width, (int)mip.height,
+                         0, mipChain.channels, mipChain.channel_type, mip.data);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    utils::set_mipmap_sampler(GL_TEXTURE_2D, mipChain.levels.size());
 
     glBindTexture(GL_TEXTURE_2D, 0);
     return textureObject;
@@ -74,9 +91,16 @@ texture_object setupSkybox(std::string const& variant) {
     glGenTextures(1, &skyboxTexture.handle);
     glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture.handle);
 
+    // Decode all faces in parallel
+    std::vector<std::string> faceFiles{};
+    for (unsigned int i = 0; i < 6; ++i) {
+        faceFiles.push_back(variant + SKYBOX_FACES.at(i));
+    }
+    texture_loader::file_batch faces{faceFiles};
+
     // Cycles through all the textures and attaches them to the skybox object
     for (unsigned int i = 0; i < 6; ++i) {
-        pixel_data pixelData = texture_loader::file(variant + SKYBOX_FACES.at(i));
+        pixel_data pixelData = faces.get(i);
 
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (unsigned int)i, 0, GL_RGB,
                      (int)pixelData.width, (int)pixelData.height,
@@ -92,14 +116,25 @@ texture_object setupSkybox(std::string const& variant) {
     return skyboxTexture;
 }
 
+/// delete a texture created by setupTexture or setupSkybox
+/// \param texture reset to an empty object
+void freeTexture(texture_object& texture) {
+    glDeleteTextures(1, &texture.handle);
+    texture = texture_object{};
+}
+
 /// setup the scene graph of the solar system
 /// \param planet_model
+/// \param textureStreamer loads the textures in the background, they fill in over the first frames
+/// \param virtualTexturing samples high resolution maps where available
 /// \return scene graph
-SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_objects, std::string const& resource_path) {
+SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_objects, std::string const& resource_path,
+                            TextureStreamer& textureStreamer, VirtualTexturing& virtualTexturing) {
     //initialize empty scene graph
     SceneGraph sceneGraph{};
     std::string texturePath = resource_path + "textures/";
 
+
     //initialize root
     std::shared_ptr<Node> root = std::make_shared<Node>(Node{nullptr, "root"});
     //set root of scene graph
@@ -114,7 +149,7 @@ SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_obj
     //initialize geometry node for sun
     auto sun_geometry_node = std::make_shared<GeometryNode>(sun_light_node,"Planet-Sun-Geometry",
                                                             model_objects.at("planet-object"), SUN_COLOR);
-    sun_geometry_node->setTexture(setupTexture(texturePath + "2k_sun.jpg"));
+    sun_geometry_node->setTexture(textureStreamer.request(texturePath + "2k_sun.jpg"));
     //add geometry node as child to sun node
     sun_light_node->addChild(sun_geometry_node);
     //add sun node as child to root
@@ -140,7 +175,21 @@ SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_obj
         auto geometry_node = std::make_shared<GeometryNode>(planet_node, "Planet-" + PLANET_NAMES[i] + "-Geometry",
                                                             model_objects.at("planet-object"), PLANET_COLOR[i]);
 
-        geometry_node->setTexture(setupTexture(texturePath + PLANET_TEXTURE[i]));
+        // high resolution maps are optional, they are too large to ship
+        auto virtualTexture = PLANET_VIRTUAL_TEXTURE.find(PLANET_NAMES[i]);
+        utils::file_stamp stamp{};
+        if (virtualTexture != PLANET_VIRTUAL_TEXTURE.end()
+         && utils::stamp_file(texturePath + virtualTexture->second, stamp)) {
+            try {
+                geometry_node->setVirtualTexture(virtualTexturing.add(texturePath + virtualTexture->second));
+            }
+            catch (std::exception const& error) {
+                std::cerr << error.what() << std::endl;
+            }
+        }
+        if (geometry_node->getVirtualTexture().id == 0) {
+            geometry_node->setTexture(textureStreamer.request(texturePath + PLANET_TEXTURE[i]));
+        }
         
         //add geometry node as a child to planet node
         planet_node->addChild(geometry_node);
@@ -163,7 +212,7 @@ SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_obj
     std::shared_ptr<Node> moon_node = std::make_shared<Node>(earth_node,"Planet-Moon-Holder");
     //initialize moon geometry node
     std::shared_ptr<GeometryNode> moon_geometry = std::make_shared<GeometryNode>(moon_node, "Planet-Moon-Geometry", model_objects.at("planet-object"));
-    moon_geometry->setTexture(setupTexture(texturePath + MOON_TEXTURE));
+    moon_geometry->setTexture(textureStreamer.request(texturePath + MOON_TEXTURE));
 
     //moon_node->translate(glm::vec3{0.0f,0.0f,-2.0f});
     //add geometry node as child to moon node
@@ -195,7 +244,27 @@ SceneGraph setupSolarSystem(std::map<std::string, model_object> const& model_obj
     enterprise_node->translate(glm::vec3{0.0f, 0.0f, -2.0f});
     enterprise_geometry->rotate(glm::radians(-90.0f));
     enterprise_geometry->scale(0.6f);
-    enterprise_geometry->setTexture(setupTexture(texturePath + "ent_color.png"));
+    enterprise_geometry->setTexture(textureStreamer.request(texturePath + "ent_color.png"));
 
     return sceneGraph;
 }
+
+/// release the streamed textures of a scene graph created by setupSolarSystem
+/// \param sceneGraph
+/// \param textureStreamer the streamer the textures were requested from
+void freeSolarSystem(SceneGraph& sceneGraph, TextureStreamer& textureStreamer) {
+    std::function<void(std::shared_ptr<Node> const&)> free_textures = [&](std::shared_ptr<Node> const& node) {
+        auto geometry = std::dynamic_pointer_cast<GeometryNode>(node);
+        if (geometry && geometry->getTexture().residency) {
+            texture_object texture = geometry->getTexture();
+            textureStreamer.free(texture);
+            geometry->setTexture(texture);
+        }
+        for (auto const& child : node->getChildren()) {
+            free_textures(child);
+        }
+    };
+    if (sceneGraph.getRoot()) {
+        free_textures(sceneGraph.getRoot());
+    }
+}
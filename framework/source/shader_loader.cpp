@@ -1,5 +1,6 @@
 #include "shader_loader.hpp"
 
+#include "cpu_profiler.hpp"
 #include "utils.hpp"
 
 
@@ -9,43 +10,68 @@
 // use gl definitions from glbinding 
 using namespace gl;
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <vector>
 #include <string.h>
 
+// "GLPB", followed by the binary format and size
+static const std::uint32_t BINARY_MAGIC = 0x42504c47;
+
+struct binary_header {
+  std::uint32_t magic;
+  std::uint32_t format;
+  std::uint64_t size;
+};
+// larger sizes come from damaged files, driver binaries are a few hundred KB
+static const std::uint64_t BINARY_MAX_SIZE = 64 << 20;
+
 
 static std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
 }
 
-namespace shader_loader {
+static void expand(std::string const& file_path, unsigned source_number, std::set<std::string> const*& defines,
+                   std::vector<std::string>& included, std::string& output);
+static GLuint compile(std::string const& file_path, GLenum shader_type, std::set<std::string> const& defines);
+static bool check_compilation(GLuint shader, std::string const& file_path, GLenum shader_type);
 
-GLuint shader(std::string const& file_path, GLenum shader_type) {
-  GLuint shader = 0;
-  shader = glCreateShader(shader_type);
+namespace shader_loader {
 
-  std::string shader_source{utils::read_file(file_path)};
-  // glshadersource expects array of c-strings
-  const char* shader_chars = shader_source.c_str();
-  glShaderSource(shader, 1, &shader_chars, 0);
+std::string preprocess(std::string const& file_path, std::set<std::string> const& defines,
+                       std::vector<std::string>& files) {
+  PROFILE_ZONE("shader_loader::preprocess");
+  std::vector<std::string> included{utils::canonical_path(file_path)};
+  std::string source{};
+  std::set<std::string> const* pending_defines = &defines;
+  expand(file_path, 0, pending_defines, included, source);
+  // without #version the defines go first
+  if (pending_defines != nullptr && !defines.empty()) {
+    std::string header{};
+    for (auto const& define : defines) {
+      header += "#define " + define + "\n";
+    }
+    source = header + "#line 1 0\n" + source;
+  }
+  files.insert(files.end(), included.begin(), included.end());
+  return source;
+}
 
-  glCompileShader(shader);
+std::string permutation_key(std::set<std::string> const& defines) {
+  std::string key{};
+  for (auto const& define : defines) {
+    key += (key.empty() ? "" : ";") + define;
+  }
+  return key;
+}
 
-  // check if compilation was successfull
-  GLint success = 0;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-  if(success == 0) {
-    // get log length
-    GLint log_size = 0;
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
-    // get log
-    std::vector<GLchar> log_buffer(log_size);
-    glGetShaderInfoLog(shader, log_size, &log_size, log_buffer.data());
-    // output errors
-    std::cerr << "OpenGl error: Compilation of " << glbinding::Meta::getString(shader_type).c_str() << " " << file_name(file_path) << ":\n";
-    std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
+GLuint shader(std::string const& file_path, GLenum shader_type, std::set<std::string> const& defines) {
+  GLuint shader = compile(file_path, shader_type, defines);
+  if (!check_compilation(shader, file_path, shader_type)) {
     // free broken shader
     glDeleteShader(shader);
 
@@ -55,56 +81,271 @@ GLuint shader(std::string const& file_path, GLenum shader_type) {
   return shader;
 }
 
-unsigned program(std::map<GLenum, std::string> const& stages) {
+unsigned program(std::map<GLenum, std::string> const& stages, std::set<std::string> const& defines,
+                 bool retrievable) {
+  unsigned program = begin_program(stages, defines, retrievable);
+  end_program(program, stages);
+  return program;
+}
+
+bool parallel_compile_supported() {
+  static bool const supported = [] {
+    if (utils::has_extension("GL_ARB_parallel_shader_compile")) {
+      // let the driver choose the number of threads
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+      return true;
+    }
+    // the khr version compiles in parallel by default
+    return utils::has_extension("GL_KHR_parallel_shader_compile");
+  }();
+  return supported;
+}
+
+unsigned begin_program(std::map<GLenum, std::string> const& stages, std::set<std::string> const& defines,
+                       bool retrievable) {
+  PROFILE_ZONE("shader_loader::begin_program");
+  parallel_compile_supported();
   unsigned program = glCreateProgram();
+  if (retrievable) {
+    // must be set before linking
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+  }
 
-  std::vector<GLuint> shaders{};
   // load and compile vert and frag shader
   for (auto const& stage : stages) {
-    GLuint shader_handle = shader(stage.second, stage.first);
-    shaders.push_back(shader_handle);
+    GLuint shader_handle = 0;
+    try {
+      shader_handle = compile(stage.second, stage.first, defines);
+    }
+    catch (std::exception&) {
+      // shaders attached so far are flagged for deletion
+      glDeleteProgram(program);
+      throw;
+    }
     // attach the shader to program
     glAttachShader(program, shader_handle);
+    // freed once it is detached in end_program
+    glDeleteShader(shader_handle);
   }
 
-  // link shaders
+  // link shaders, querying any status waits for the driver
   glLinkProgram(program);
 
+  return program;
+}
+
+bool program_completed(unsigned program) {
+  if (!parallel_compile_supported()) {
+    return true;
+  }
+  GLint completed = 0;
+  glGetProgramiv(program, GL_COMPLETION_STATUS_ARB, &completed);
+  return completed != 0;
+}
+
+void end_program(unsigned program, std::map<GLenum, std::string> const& stages) {
+  PROFILE_ZONE("shader_loader::end_program");
+  GLint num_shaders = 0;
+  glGetProgramiv(program, GL_ATTACHED_SHADERS, &num_shaders);
+  std::vector<GLuint> shaders(std::size_t(num_shaders), 0);
+  glGetAttachedShaders(program, num_shaders, &num_shaders, shaders.data());
+
+  // check if compilation was successfull
+  bool compiled = true;
+  for (auto shader_handle : shaders) {
+    GLint shader_type = 0;
+    glGetShaderiv(shader_handle, GL_SHADER_TYPE, &shader_type);
+    auto const stage = stages.find(GLenum(shader_type));
+    std::string const file_path{stage != stages.end() ? stage->second : std::string{}};
+    compiled = check_compilation(shader_handle, file_path, GLenum(shader_type)) && compiled;
+  }
+
   // check if linking was successfull
   GLint success = 0;
   glGetProgramiv(program, GL_LINK_STATUS, &success);
-  if(success == 0) {
-    // get log length
-    GLint log_size = 0;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
-    // get log
-    std::vector<GLchar> log_buffer(log_size);
-    glGetProgramInfoLog(program, log_size, &log_size, log_buffer.data());
-    
-    // output errors
+  if(!compiled || success == 0) {
     std::string names{};
     for(auto const& stage : stages) {
       names += file_name(stage.second) + " & ";
     }
     names.resize(names.size() - 3);
-        // output errors
-    std::cerr << "OpenGl error: Linking of " << names << ":\n";
-    std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
 
-    // free broken program
+    // the link log only repeats compilation errors
+    if (compiled) {
+      // get log length
+      GLint log_size = 0;
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_size);
+      // get log
+      std::vector<GLchar> log_buffer(log_size);
+      glGetProgramInfoLog(program, log_size, &log_size, log_buffer.data());
+      // output errors
+      std::cerr << "OpenGl error: Linking of " << names << ":\n";
+      std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
+    }
+
+    // free broken program and its shaders
     glDeleteProgram(program);
 
-    throw std::logic_error("OpenGL error: linking of " + names);
+    throw std::logic_error("OpenGL error: " + std::string{compiled ? "linking" : "compilation"} + " of " + names);
   }
 
   for (auto shader_handle : shaders) {
-    // detach shader
+    // detach and thereby free shader
     glDetachShader(program, shader_handle);
-    // and free it
-    glDeleteShader(shader_handle);
+  }
+}
+
+bool binary_supported() {
+  static bool const supported = [] {
+    if (!utils::has_version(4, 1) && !utils::has_extension("GL_ARB_get_program_binary")) {
+      return false;
+    }
+    // drivers may expose the functions without any format
+    GLint num_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    return num_formats > 0;
+  }();
+  return supported;
+}
+
+unsigned load_binary(std::string const& file_path) {
+  std::ifstream file{file_path, std::ios::binary};
+  binary_header header{};
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != BINARY_MAGIC) {
+    return 0;
+  }
+  // truncated or damaged files are a cache miss, the size must match the rest of the file
+  std::streamoff const offset = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff const remaining = file.tellg() - offset;
+  if (header.size == 0 || header.size > BINARY_MAX_SIZE || remaining < 0 || std::uint64_t(remaining) != header.size) {
+    return 0;
+  }
+  file.seekg(offset);
+  std::vector<char> binary(std::size_t(header.size));
+  if (!file.read(binary.data(), std::streamsize(binary.size()))) {
+    return 0;
   }
 
+  unsigned program = glCreateProgram();
+  glProgramBinary(program, GLenum(header.format), binary.data(), GLsizei(binary.size()));
+  // rejected after driver updates, even if renderer and version are unchanged
+  GLint success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (success == 0) {
+    glDeleteProgram(program);
+    return 0;
+  }
   return program;
 }
 
+void save_binary(unsigned program, std::string const& file_path) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(std::size_t(length), 0);
+  GLenum format = GL_NONE;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  // written under a temporary name, concurrent instances never read partial binaries
+  std::string const temporary_path{file_path + ".tmp"};
+  {
+    std::ofstream file{temporary_path, std::ios::binary};
+    binary_header header{BINARY_MAGIC, std::uint32_t(format), std::uint64_t(length)};
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file) {
+      std::remove(temporary_path.c_str());
+      return;
+    }
+  }
+  std::remove(file_path.c_str());
+  std::rename(temporary_path.c_str(), file_path.c_str());
+}
+
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// append the file to the output with its includes resolved, defines are reset once inserted
+static void expand(std::string const& file_path, unsigned source_number, std::set<std::string> const*& defines,
+                   std::vector<std::string>& included, std::string& output) {
+  std::istringstream lines{utils::read_file(file_path)};
+  std::string const directory{file_path.substr(0, file_path.find_last_of("/\\") + 1)};
+  // restores the numbering of this file after inserted lines
+  auto const line_directive = [source_number](unsigned line_number) {
+    return "#line " + std::to_string(line_number) + " " + std::to_string(source_number) + "\n";
+  };
+
+  std::string line{};
+  for (unsigned line_number = 1; std::getline(lines, line); ++line_number) {
+    std::size_t const start = line.find_first_not_of(" \t");
+    std::string const directive{start != std::string::npos ? line.substr(start) : std::string{}};
+
+    if (defines != nullptr && directive.compare(0, 8, "#version") == 0) {
+      output += line + "\n";
+      for (auto const& define : *defines) {
+        output += "#define " + define + "\n";
+      }
+      output += line_directive(line_number + 1);
+      defines = nullptr;
+    }
+    else if (directive.compare(0, 8, "#include") == 0) {
+      std::size_t const open = directive.find_first_of("\"<", 8);
+      std::size_t const close = open != std::string::npos ? directive.find_first_of("\">", open + 1) : open;
+      if (close == std::string::npos) {
+        std::cerr << "Shader error: " << file_name(file_path) << "(" << line_number << "): malformed #include" << std::endl;
+        throw std::invalid_argument(file_path);
+      }
+      std::string const include_path{directory + directive.substr(open + 1, close - open - 1)};
+      std::string const canonical{utils::canonical_path(include_path)};
+      // included once, which also ends include cycles
+      if (std::find(included.begin(), included.end(), canonical) == included.end()) {
+        included.push_back(canonical);
+        unsigned const include_number = unsigned(included.size() - 1);
+        output += "#line 1 " + std::to_string(include_number) + "\n";
+        expand(include_path, include_number, defines, included, output);
+        output += line_directive(line_number + 1);
+      }
+      else {
+        output += "\n";
+      }
+    }
+    else {
+      output += line + "\n";
+    }
+  }
+}
+
+// start compiling, throws if the source cannot be read
+static GLuint compile(std::string const& file_path, GLenum shader_type, std::set<std::string> const& defines) {
+  std::vector<std::string> files{};
+  std::string shader_source{shader_loader::preprocess(file_path, defines, files)};
+
+  GLuint shader = glCreateShader(shader_type);
+  // glshadersource expects array of c-strings
+  const char* shader_chars = shader_source.c_str();
+  glShaderSource(shader, 1, &shader_chars, 0);
+
+  glCompileShader(shader);
+  return shader;
+}
+
+// output the log if compilation failed
+static bool check_compilation(GLuint shader, std::string const& file_path, GLenum shader_type) {
+  GLint success = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+  if(success == 0) {
+    // get log length
+    GLint log_size = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_size);
+    // get log
+    std::vector<GLchar> log_buffer(log_size);
+    glGetShaderInfoLog(shader, log_size, &log_size, log_buffer.data());
+    // output errors
+    std::cerr << "OpenGl error: Compilation of " << glbinding::Meta::getString(shader_type).c_str() << " " << file_name(file_path) << ":\n";
+    std::cerr << std::string{log_buffer.begin(), log_buffer.end()};
+  }
+  return success != 0;
 }
@@ -1,5 +1,9 @@
 #include "texture_loader.hpp"
 
+#include "block_compression.hpp"
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
 // request supported types
 #define STBI_ONLY_JPEG
 #define STBI_ONLY_PNG
@@ -11,14 +15,42 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
  
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint> 
 #include <cstring> 
+#include <fstream>
+#include <mutex>
 #include <stdexcept> 
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXTURE_LOADER_SSE
+#endif
+
+
+// rgba image with linear float channels, input and output of the mip filters
+struct linear_image {
+  std::size_t width;
+  std::size_t height;
+  std::vector<float> texels;
+};
+
+static linear_image to_linear(pixel_data const& image, std::size_t num_components, bool srgb);
+static pixel_data to_pixels(linear_image const& image, pixel_data const& format, std::size_t num_components, bool srgb);
+static linear_image downsample_box(linear_image const& source);
+static linear_image downsample_kaiser(linear_image const& source);
+
+static bool read_cache(std::string const& path, utils::file_stamp const& stamp, texture_loader::mip_chain& chain);
+static void write_cache(std::string const& path, utils::file_stamp const& stamp, texture_loader::mip_chain const& chain);
+
 namespace texture_loader {
 pixel_data file(std::string const& file_name) {
-  // match to opengl representation
-  stbi_set_flip_vertically_on_load(true);
+  PROFILE_ZONE("texture_loader::file");
+  // match to opengl representation, the flag is global so set it only once
+  static std::once_flag flip_flag;
+  std::call_once(flip_flag, [] { stbi_set_flip_vertically_on_load(true); });
 
   uint8_t* data_ptr;
   int width = 0;
@@ -30,7 +62,8 @@ pixel_data file(std::string const& file_name) {
   //data_ptr = stbi_load(file_name.c_str(), &width, &height, &format, 0);
 
   if(!data_ptr) {
-    throw std::logic_error(std::string{"stb_image: "} + stbi_failure_reason());
+    // reason is global in stb_image, name the file since batches decode concurrently
+    throw std::logic_error(std::string{"stb_image: "} + stbi_failure_reason() + " in " + file_name);
   }
 
   // determine format of image data, internal format should be sized
@@ -64,4 +97,352 @@ pixel_data file(std::string const& file_name) {
   return pixel_data{texture_data, pixel_format, GL_UNSIGNED_BYTE, std::size_t(width), std::size_t(height)};
 }
 
-}
\ No newline at end of file
+file_batch::file_batch(std::vector<std::string> const& file_names, unsigned num_threads)
+ :batch<pixel_data>{file_names, file, num_threads}
+{}
+
+std::vector<pixel_data> files(std::vector<std::string> const& file_names) {
+  file_batch batch{file_names};
+  std::vector<pixel_data> images{};
+  images.reserve(batch.size());
+  for (std::size_t i = 0; i < batch.size(); ++i) {
+    images.push_back(batch.get(i));
+  }
+  return images;
+}
+
+std::vector<pixel_data> generate_mipmaps(pixel_data const& image, mip_filter filter, bool srgb) {
+  std::size_t num_components = image.pixels.size() / (image.width * image.height);
+  std::vector<pixel_data> levels{image};
+
+  // filter in linear space, each level is built from the unquantized previous one
+  linear_image current = to_linear(image, num_components, srgb);
+  while (current.width > 1 || current.height > 1) {
+    current = filter == KAISER_FILTER ? downsample_kaiser(current) : downsample_box(current);
+    levels.push_back(to_pixels(current, image, num_components, srgb));
+  }
+  return levels;
+}
+
+mip_chain mipmapped(std::vector<pixel_data> levels) {
+  auto images = std::make_shared<std::vector<pixel_data>>(std::move(levels));
+  mip_chain chain{};
+  // stored as rgba8 like drivers do for rgb anyway
+  chain.internal_format = GL_RGBA8;
+  chain.channels = images->front().channels;
+  chain.channel_type = images->front().channel_type;
+  for (auto const& image : *images) {
+    chain.levels.push_back(mip_level{image.width, image.height, image.pixels.size(), image.ptr()});
+  }
+  chain.storage = images;
+  return chain;
+}
+
+bool compression_supported() {
+  // BC1 is not core, but exposed by practically all desktop drivers
+  return utils::has_extension("GL_EXT_texture_compression_s3tc");
+}
+
+mip_chain mipmapped_file(std::string const& file_name, bool compress) {
+  PROFILE_ZONE("texture_loader::mipmapped_file");
+  std::string const cache_path{file_name + ".bc1"};
+  utils::file_stamp stamp{0, 0};
+  mip_chain chain{};
+  if (compress && utils::stamp_file(file_name, stamp) && read_cache(cache_path, stamp, chain)) {
+    return chain;
+  }
+
+  auto images = std::make_shared<std::vector<pixel_data>>(generate_mipmaps(file(file_name)));
+  if (!compress) {
+    return mipmapped(std::move(*images));
+  }
+
+  std::vector<std::size_t> offsets{};
+  std::size_t total_size = 0;
+  for (auto const& image : *images) {
+    offsets.push_back(total_size);
+    total_size += block_compression::bc1_size(image.width, image.height);
+  }
+  auto blocks = std::make_shared<std::vector<std::uint8_t>>(total_size);
+  for (std::size_t i = 0; i < images->size(); ++i) {
+    pixel_data const& image = (*images)[i];
+    block_compression::encode_bc1(image, blocks->data() + offsets[i]);
+    chain.levels.push_back(mip_level{image.width, image.height,
+                                     block_compression::bc1_size(image.width, image.height), blocks->data() + offsets[i]});
+  }
+  chain.internal_format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  chain.compressed = true;
+  chain.storage = blocks;
+
+  write_cache(cache_path, stamp, chain);
+  return chain;
+}
+
+}
+
+///////////////////////////// mip filters ///////////////////////////////////
+// color channels of an image, the last channel of rg and rgba images is alpha and stays linear
+static std::size_t color_components(std::size_t num_components) {
+  return num_components == 2 || num_components == 4 ? num_components - 1 : num_components;
+}
+
+static float srgb_to_linear(float value) {
+  return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float value) {
+  return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static const std::size_t SRGB_TABLE_SIZE = 4096;
+
+static linear_image to_linear(pixel_data const& image, std::size_t num_components, bool srgb) {
+  static std::array<float, 256> const decode_table = [] {
+    std::array<float, 256> table{};
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = srgb_to_linear(float(i) / 255.0f);
+    }
+    return table;
+  }();
+  std::size_t const colors = srgb ? color_components(num_components) : 0;
+
+  linear_image result{image.width, image.height, std::vector<float>(image.width * image.height * 4, 1.0f)};
+  utils::parallel_for(image.height, utils::range_num(image.width * image.height),
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin * image.width; i < end * image.width; ++i) {
+      for (std::size_t c = 0; c < num_components; ++c) {
+        std::uint8_t value = image.pixels[i * num_components + c];
+        result.texels[i * 4 + c] = c < colors ? decode_table[value] : float(value) / 255.0f;
+      }
+    }
+  });
+  return result;
+}
+
+static pixel_data to_pixels(linear_image const& image, pixel_data const& format, std::size_t num_components, bool srgb) {
+  // table indexed by quantized linear value, finer than 8 bit to keep dark tones
+  static std::array<std::uint8_t, SRGB_TABLE_SIZE> const encode_table = [] {
+    std::array<std::uint8_t, SRGB_TABLE_SIZE> table{};
+    for (std::size_t i = 0; i < table.size(); ++i) {
+      table[i] = std::uint8_t(linear_to_srgb(float(i) / float(SRGB_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+    }
+    return table;
+  }();
+  std::size_t const colors = srgb ? color_components(num_components) : 0;
+
+  std::vector<std::uint8_t> pixels(image.width * image.height * num_components);
+  utils::parallel_for(image.height, utils::range_num(image.width * image.height),
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t i = begin * image.width; i < end * image.width; ++i) {
+      for (std::size_t c = 0; c < num_components; ++c) {
+        // kaiser lobes can overshoot
+        float value = std::min(std::max(image.texels[i * 4 + c], 0.0f), 1.0f);
+        pixels[i * num_components + c] = c < colors ? encode_table[std::size_t(value * float(SRGB_TABLE_SIZE - 1) + 0.5f)]
+                                                    : std::uint8_t(value * 255.0f + 0.5f);
+      }
+    }
+  });
+  return pixel_data{pixels, format.channels, format.channel_type, image.width, image.height};
+}
+
+// weighted sum of texels, four channels at once
+struct texel_sum {
+#ifdef TEXTURE_LOADER_SSE
+  texel_sum() :sum{_mm_setzero_ps()} {}
+  void add(float const* texel, float weight) {
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(weight)));
+  }
+  void store(float* texel) const {
+    _mm_storeu_ps(texel, sum);
+  }
+  __m128 sum;
+#else
+  texel_sum() :sum{0.0f, 0.0f, 0.0f, 0.0f} {}
+  void add(float const* texel, float weight) {
+    for (std::size_t c = 0; c < 4; ++c) {
+      sum[c] += texel[c] * weight;
+    }
+  }
+  void store(float* texel) const {
+    std::copy(sum, sum + 4, texel);
+  }
+  float sum[4];
+#endif
+};
+
+// 2x2 average, the last row or column of odd sized levels is clamped
+static linear_image downsample_box(linear_image const& source) {
+  linear_image result{std::max<std::size_t>(source.width / 2, 1), std::max<std::size_t>(source.height / 2, 1), {}};
+  result.texels.resize(result.width * result.height * 4);
+
+  utils::parallel_for(result.height, utils::range_num(result.width * result.height),
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t y = begin; y < end; ++y) {
+      float const* row0 = &source.texels[std::min(2 * y, source.height - 1) * source.width * 4];
+      float const* row1 = &source.texels[std::min(2 * y + 1, source.height - 1) * source.width * 4];
+      for (std::size_t x = 0; x < result.width; ++x) {
+        std::size_t x0 = std::min(2 * x, source.width - 1) * 4;
+        std::size_t x1 = std::min(2 * x + 1, source.width - 1) * 4;
+        texel_sum sum{};
+        sum.add(row0 + x0, 0.25f);
+        sum.add(row0 + x1, 0.25f);
+        sum.add(row1 + x0, 0.25f);
+        sum.add(row1 + x1, 0.25f);
+        sum.store(&result.texels[(y * result.width + x) * 4]);
+      }
+    }
+  });
+  return result;
+}
+
+// kaiser windowed sinc over 6 texels per axis, sharper than the box filter
+static const int KAISER_TAPS = 6;
+
+static std::array<float, KAISER_TAPS> const& kaiser_weights() {
+  static std::array<float, KAISER_TAPS> const weights = [] {
+    // zeroth order modified bessel function of the first kind
+    auto bessel_i0 = [](float x) {
+      float sum = 1.0f;
+      float term = 1.0f;
+      for (int k = 1; k < 16; ++k) {
+        term *= (x / (2.0f * float(k))) * (x / (2.0f * float(k)));
+        sum += term;
+      }
+      return sum;
+    };
+    float const alpha = 4.0f;
+    float const radius = float(KAISER_TAPS) / 2.0f;
+    std::array<float, KAISER_TAPS> result{};
+    float total = 0.0f;
+    for (int i = 0; i < KAISER_TAPS; ++i) {
+      // distance of the tap to the center between the two source texels, in source texels
+      float distance = float(i - KAISER_TAPS / 2) + 0.5f;
+      // cutoff at half the source frequency
+      float phase = float(M_PI) * distance / 2.0f;
+      float sinc = std::sin(phase) / phase;
+      float window = bessel_i0(alpha * std::sqrt(1.0f - (distance / radius) * (distance / radius))) / bessel_i0(alpha);
+      result[i] = sinc * window;
+      total += result[i];
+    }
+    for (auto& weight : result) {
+      weight /= total;
+    }
+    return result;
+  }();
+  return weights;
+}
+
+static std::size_t clamp_tap(std::size_t center, int tap, std::size_t size) {
+  long position = long(center) + tap;
+  return std::size_t(std::min(std::max(position, 0l), long(size) - 1));
+}
+
+// separable, horizontal pass into a temporary followed by the vertical pass
+static linear_image downsample_kaiser(linear_image const& source) {
+  auto const& weights = kaiser_weights();
+  linear_image horizontal{std::max<std::size_t>(source.width / 2, 1), source.height, {}};
+  horizontal.texels.resize(horizontal.width * horizontal.height * 4);
+  linear_image result{horizontal.width, std::max<std::size_t>(source.height / 2, 1), {}};
+  result.texels.resize(result.width * result.height * 4);
+
+  utils::parallel_for(horizontal.height, utils::range_num(horizontal.width * horizontal.height),
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t y = begin; y < end; ++y) {
+      float const* row = &source.texels[y * source.width * 4];
+      for (std::size_t x = 0; x < horizontal.width; ++x) {
+        texel_sum sum{};
+        for (int i = 0; i < KAISER_TAPS; ++i) {
+          std::size_t column = clamp_tap(2 * x, i - KAISER_TAPS / 2 + 1, source.width);
+          sum.add(row + column * 4, weights[i]);
+        }
+        sum.store(&horizontal.texels[(y * horizontal.width + x) * 4]);
+      }
+    }
+  });
+
+  utils::parallel_for(result.height, utils::range_num(result.width * result.height),
+                      [&](std::size_t begin, std::size_t end, std::size_t) {
+    for (std::size_t y = begin; y < end; ++y) {
+      for (std::size_t x = 0; x < result.width; ++x) {
+        texel_sum sum{};
+        for (int i = 0; i < KAISER_TAPS; ++i) {
+          std::size_t row = clamp_tap(2 * y, i - KAISER_TAPS / 2 + 1, horizontal.height);
+          sum.add(&horizontal.texels[(row * horizontal.width + x) * 4], weights[i]);
+        }
+        sum.store(&result.texels[(y * result.width + x) * 4]);
+      }
+    }
+  });
+  return result;
+}
+
+///////////////////////////// compressed texture cache ////////////////////////
+// version 2: srgb-correct mip filtering
+static const std::uint32_t CACHE_MAGIC = 0x32435854; // "TXC2"
+
+// fixed-size header, followed by one entry per level and the level data
+struct cache_header {
+  std::uint32_t magic;
+  std::uint32_t internal_format;
+  std::uint32_t num_levels;
+  std::uint32_t reserved;
+  std::uint64_t source_size;
+  std::uint64_t source_modified;
+};
+
+struct cache_level {
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+static bool read_cache(std::string const& path, utils::file_stamp const& stamp, texture_loader::mip_chain& chain) {
+  std::size_t size = 0;
+  std::shared_ptr<void const> data = utils::map_file(path, size);
+  if (!data || size < sizeof(cache_header)) {
+    return false;
+  }
+  auto bytes = static_cast<std::uint8_t const*>(data.get());
+  cache_header header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (header.magic != CACHE_MAGIC || header.source_size != stamp.size || header.source_modified != stamp.modified
+   || sizeof(cache_header) + header.num_levels * sizeof(cache_level) > size) {
+    return false;
+  }
+
+  chain.levels.clear();
+  for (std::uint32_t i = 0; i < header.num_levels; ++i) {
+    cache_level level;
+    std::memcpy(&level, bytes + sizeof(cache_header) + i * sizeof(cache_level), sizeof(level));
+    if (level.offset + level.size > size) {
+      return false;
+    }
+    chain.levels.push_back(texture_loader::mip_level{level.width, level.height, std::size_t(level.size), bytes + level.offset});
+  }
+  chain.internal_format = GLenum(header.internal_format);
+  chain.compressed = true;
+  chain.storage = data;
+  return true;
+}
+
+static void write_cache(std::string const& path, utils::file_stamp const& stamp, texture_loader::mip_chain const& chain) {
+  std::ofstream file{path, std::ios::binary};
+  // cache is optional, e.g. if resource directory is read-only
+  if (!file) {
+    return;
+  }
+  cache_header header{CACHE_MAGIC, std::uint32_t(chain.internal_format), std::uint32_t(chain.levels.size()), 0,
+                      stamp.size, stamp.modified};
+  file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+
+  std::uint64_t offset = sizeof(cache_header) + chain.levels.size() * sizeof(cache_level);
+  for (auto const& level : chain.levels) {
+    cache_level entry{std::uint32_t(level.width), std::uint32_t(level.height), offset, level.size};
+    file.write(reinterpret_cast<char const*>(&entry), sizeof(entry));
+    offset += level.size;
+  }
+  for (auto const& level : chain.levels) {
+    file.write(static_cast<char const*>(level.data), std::streamsize(level.size));
+  }
+}
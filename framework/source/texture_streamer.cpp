@@ -0,0 +1,597 @@
+#include "texture_streamer.hpp"
+
+#include "cpu_profiler.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+// offsets in the staging ring, keeps copies and transfers aligned
+static const std::size_t STAGING_ALIGNMENT = 256;
+// levels up to this size are loaded up front, 64x32 rgba is 8 KB
+static const std::size_t MIP_TAIL_SIZE = 64;
+
+static std::size_t level_bytes(texture_loader::mip_chain const& chain, std::size_t level);
+
+TextureStreamer::TextureStreamer(std::size_t staging_bytes, std::size_t frame_budget, unsigned num_threads):
+    pixel_BO_{0},
+    staging_{nullptr},
+    client_staging_{},
+    persistent_{utils::has_version(4, 4) || utils::has_extension("GL_ARB_buffer_storage")},
+    compress_{texture_loader::compression_supported()},
+    capacity_{staging_bytes},
+    frame_budget_{frame_budget},
+    memory_budget_{256 << 20},
+    mutex_{},
+    jobs_available_{},
+    staging_available_{},
+    jobs_{},
+    staged_{},
+    ranges_{},
+    textures_{},
+    paths_{},
+    head_{0},
+    pending_{0},
+    next_id_{1},
+    stop_{false},
+    uploads_{},
+    fences_{},
+    frame_{0},
+    resident_bytes_{0},
+    queued_bytes_{0},
+    workers_{}
+{
+    glGenBuffers(1, &pixel_BO_);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_BO_);
+    if (persistent_) {
+        // workers write directly into gpu visible memory
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(capacity_), nullptr,
+                        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+        staging_ = static_cast<std::uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(capacity_),
+                                                               GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT));
+    }
+    else {
+        // workers write into client memory, copied into the buffer before each transfer
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(capacity_), nullptr, GL_STREAM_DRAW);
+        client_staging_.resize(capacity_);
+        staging_ = client_staging_.data();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&TextureStreamer::work, this);
+    }
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+    jobs_available_.notify_all();
+    staging_available_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+
+    for (auto const& fence : fences_) {
+        glDeleteSync(fence.sync);
+    }
+    if (persistent_) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_BO_);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &pixel_BO_);
+    for (auto const& entry : textures_) {
+        glDeleteTextures(1, &entry.first);
+    }
+}
+
+texture_object TextureStreamer::request(std::string const& file_name) {
+    std::string const path{utils::canonical_path(file_name)};
+    texture_object texture{};
+    texture.target = GL_TEXTURE_2D;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto shared = paths_.find(path);
+        if (shared != paths_.end()) {
+            streamed_texture& existing = textures_.at(shared->second);
+            ++existing.references;
+            texture.handle = shared->second;
+            texture.residency = existing.residency;
+            return texture;
+        }
+    }
+
+    glGenTextures(1, &texture.handle);
+    texture.residency = std::make_shared<texture_residency>();
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        std::uint64_t const id = next_id_++;
+        textures_[texture.handle] = streamed_texture{texture.residency, {}, false, 0, 0, 0, 1, path, id};
+        paths_[path] = texture.handle;
+        jobs_.push_back(load_job{texture.handle, id, file_name, -1});
+        ++pending_;
+    }
+    jobs_available_.notify_one();
+    return texture;
+}
+
+void TextureStreamer::free(texture_object& texture) {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto found = textures_.find(texture.handle);
+        if (found == textures_.end()) {
+            return;
+        }
+        if (--found->second.references > 0) {
+            texture = texture_object{};
+            return;
+        }
+        std::uint64_t const id = found->second.id;
+        paths_.erase(found->second.path);
+        resident_bytes_ -= found->second.residency->bytes;
+        queued_bytes_ -= found->second.queued_bytes;
+        textures_.erase(found);
+
+        // loads in progress are discarded by the worker, staged levels are dropped in update
+        // both are matched by id, glGenTextures may hand out the name again right away
+        for (auto job = jobs_.begin(); job != jobs_.end();) {
+            if (job->id == id) {
+                job = jobs_.erase(job);
+                --pending_;
+            }
+            else {
+                ++job;
+            }
+        }
+    }
+    glDeleteTextures(1, &texture.handle);
+    texture = texture_object{};
+}
+
+void TextureStreamer::update() {
+    PROFILE_ZONE("texture streamer update");
+    ++frame_;
+
+    // ranges of transfers the gpu has finished can be reused
+    while (!fences_.empty()) {
+        GLenum status = glClientWaitSync(fences_.front().sync, GL_NONE_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(fences_.front().sync);
+        for (std::size_t offset : fences_.front().offsets) {
+            release(offset);
+        }
+        fences_.pop_front();
+    }
+
+    refine();
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        uploads_.insert(uploads_.end(), staged_.begin(), staged_.end());
+        staged_.clear();
+    }
+    if (uploads_.empty()) {
+        return;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_BO_);
+    // levels are padded to rgba, so rows are always 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    std::size_t budget = frame_budget_;
+    std::vector<std::size_t> finished{};
+    while (!uploads_.empty() && budget > 0) {
+        staged_level& level = uploads_.front();
+        bool freed = false;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            freed = lookup(level.texture, level.id) == nullptr;
+            if (freed) {
+                --pending_;
+            }
+        }
+        if (freed) {
+            finished.push_back(level.offset);
+            uploads_.pop_front();
+            continue;
+        }
+
+        budget -= std::min(budget, transfer(level, budget));
+        if (level.uploaded_rows < level.height) {
+            // continue the level next frame
+            break;
+        }
+
+        finished.push_back(level.offset);
+        makeResident(level);
+        uploads_.pop_front();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!finished.empty()) {
+        fences_.push_back(frame_fence{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, GL_UNUSED_BIT), finished});
+    }
+}
+
+std::size_t TextureStreamer::getPending() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pending_;
+}
+
+std::size_t TextureStreamer::getMemoryBudget() const {
+    return memory_budget_;
+}
+
+void TextureStreamer::setMemoryBudget(std::size_t memory_budget) {
+    memory_budget_ = memory_budget;
+}
+
+std::size_t TextureStreamer::getResidentBytes() const {
+    return resident_bytes_;
+}
+
+std::size_t TextureStreamer::getFrameBudget() const {
+    return frame_budget_;
+}
+
+void TextureStreamer::setFrameBudget(std::size_t frame_budget) {
+    frame_budget_ = frame_budget;
+}
+
+void TextureStreamer::work() {
+    cpu_profiler::set_thread_name("texture streamer");
+    // one worker per core, mip chains are filtered on the worker alone
+    utils::set_worker_thread(true);
+    while (true) {
+        load_job job{};
+        {
+            std::unique_lock<std::mutex> lock{mutex_};
+            jobs_available_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (stop_) {
+                return;
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+
+        try {
+            PROFILE_ZONE("load texture");
+            if (job.level < 0) {
+                // compressed chains come from the mapped cache, so most loads decode nothing
+                texture_loader::mip_chain chain = texture_loader::mipmapped_file(job.file_name, compress_);
+                std::size_t tail = chain.levels.size() - 1;
+                while (tail > 0 && std::max(chain.levels[tail - 1].width, chain.levels[tail - 1].height) <= MIP_TAIL_SIZE) {
+                    --tail;
+                }
+                bool freed = false;
+                {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    streamed_texture* texture = lookup(job.texture, job.id);
+                    freed = texture == nullptr;
+                    if (!freed) {
+                        texture->chain = chain;
+                        texture->loaded = true;
+                        texture->staged_level = GLint(tail);
+                        texture->tail_level = GLint(tail);
+                    }
+                }
+                if (!freed) {
+                    stage(job.texture, job.id, chain, tail, chain.levels.size());
+                }
+            }
+            else {
+                texture_loader::mip_chain chain{};
+                bool freed = false;
+                {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    streamed_texture* texture = lookup(job.texture, job.id);
+                    freed = texture == nullptr;
+                    if (!freed) {
+                        chain = texture->chain;
+                    }
+                }
+                if (!freed) {
+                    stage(job.texture, job.id, chain, std::size_t(job.level), std::size_t(job.level) + 1);
+                }
+            }
+        }
+        catch (std::exception const& error) {
+            std::cerr << "TextureStreamer: " << error.what() << std::endl;
+        }
+
+        // staged levels are pending on their own, also if staging failed part way
+        std::lock_guard<std::mutex> lock{mutex_};
+        --pending_;
+    }
+}
+
+TextureStreamer::streamed_texture* TextureStreamer::lookup(GLuint texture, std::uint64_t id) {
+    auto found = textures_.find(texture);
+    return found != textures_.end() && found->second.id == id ? &found->second : nullptr;
+}
+
+void TextureStreamer::stage(GLuint texture, std::uint64_t id, texture_loader::mip_chain const& chain,
+                            std::size_t first, std::size_t last) {
+    std::size_t num_components = 0;
+    if (!chain.compressed) {
+        num_components = chain.channels == GL_RGBA ? 4 : chain.channels == GL_RGB ? 3 : chain.channels == GL_RG ? 2 : 1;
+    }
+
+    // coarse levels first, each one makes the next finer level resident
+    for (std::size_t i = last; i-- > first;) {
+        texture_loader::mip_level const& source = chain.levels[i];
+        std::size_t size = level_bytes(chain, i);
+        if (size > capacity_) {
+            throw std::runtime_error("level does not fit into the staging ring");
+        }
+
+        std::size_t offset = 0;
+        if (!reserve(size, offset)) {
+            return;
+        }
+        std::uint8_t* target = staging_ + offset;
+        if (chain.compressed) {
+            std::memcpy(target, source.data, size);
+        }
+        else {
+            // pad to rgba, the fast path of most drivers
+            auto texels = static_cast<std::uint8_t const*>(source.data);
+            for (std::size_t t = 0; t < source.width * source.height; ++t) {
+                for (std::size_t c = 0; c < 4; ++c) {
+                    target[t * 4 + c] = c < num_components ? texels[t * num_components + c] : std::uint8_t(255);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        ++pending_;
+        staged_.push_back(staged_level{texture, id, GLint(i), chain.levels.size(), chain.levels.front().width,
+                                       source.width, source.height,
+                                       chain.compressed ? chain.internal_format : GL_RGBA8, chain.compressed,
+                                       offset, size, 0});
+    }
+}
+
+bool TextureStreamer::reserve(std::size_t bytes, std::size_t& offset) {
+    std::unique_lock<std::mutex> lock{mutex_};
+    staging_available_.wait(lock, [&] { return stop_ || tryReserve(bytes, offset); });
+    return !stop_;
+}
+
+void TextureStreamer::release(std::size_t offset) {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for (auto& range : ranges_) {
+            if (range.offset == offset && !range.released) {
+                range.released = true;
+                break;
+            }
+        }
+        // ring space is only reusable in order of reservation
+        while (!ranges_.empty() && ranges_.front().released) {
+            ranges_.pop_front();
+        }
+    }
+    staging_available_.notify_all();
+}
+
+bool TextureStreamer::tryReserve(std::size_t bytes, std::size_t& offset) {
+    bytes = (bytes + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+    if (ranges_.empty()) {
+        head_ = 0;
+    }
+    // free space never closes the gap completely, so head == tail means empty
+    std::size_t tail = ranges_.empty() ? 0 : ranges_.front().offset;
+    if (ranges_.empty() || head_ > tail) {
+        if (capacity_ - head_ >= bytes) {
+            offset = head_;
+        }
+        else if (tail > bytes || ranges_.empty()) {
+            // skip the end of the ring
+            if (!ranges_.empty()) {
+                ranges_.push_back(staging_range{head_, capacity_ - head_, true});
+            }
+            offset = 0;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (tail - head_ > bytes) {
+        offset = head_;
+    }
+    else {
+        return false;
+    }
+    if (offset + bytes > capacity_) {
+        return false;
+    }
+
+    ranges_.push_back(staging_range{offset, bytes, false});
+    head_ = offset + bytes;
+    return true;
+}
+
+void TextureStreamer::refine() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::vector<std::pair<GLuint, streamed_texture*>> candidates{};
+    for (auto& entry : textures_) {
+        streamed_texture& texture = entry.second;
+        texture_residency& residency = *texture.residency;
+        if (residency.used) {
+            residency.last_use_frame = frame_;
+            residency.used = false;
+        }
+        // one level at a time, the previous one has to be resident
+        if (texture.loaded && residency.num_levels > 0 && residency.base_level == texture.staged_level
+         && residency.requested_level < residency.base_level) {
+            candidates.emplace_back(entry.first, &texture);
+        }
+    }
+
+    // most recently used textures first, they may demote less recently used ones
+    std::sort(candidates.begin(), candidates.end(), [](std::pair<GLuint, streamed_texture*> const& a,
+                                                       std::pair<GLuint, streamed_texture*> const& b) {
+        return a.second->residency->last_use_frame > b.second->residency->last_use_frame;
+    });
+    for (auto const& candidate : candidates) {
+        streamed_texture* texture = candidate.second;
+        GLint level = texture->residency->base_level - 1;
+        std::size_t bytes = level_bytes(texture->chain, std::size_t(level));
+        while (resident_bytes_ + queued_bytes_ + bytes > memory_budget_
+            && demote(texture->residency->last_use_frame)) {
+        }
+        if (resident_bytes_ + queued_bytes_ + bytes > memory_budget_) {
+            continue;
+        }
+
+        texture->staged_level = level;
+        texture->queued_bytes = bytes;
+        queued_bytes_ += bytes;
+        jobs_.push_back(load_job{candidate.first, texture->id, {}, level});
+        ++pending_;
+        jobs_available_.notify_one();
+    }
+
+    // the budget was lowered, nothing used this frame is spared
+    while (resident_bytes_ + queued_bytes_ > memory_budget_ && demote(frame_ + 1)) {
+    }
+}
+
+bool TextureStreamer::demote(std::uint64_t before_frame) {
+    GLuint handle = 0;
+    streamed_texture* victim = nullptr;
+    for (auto& entry : textures_) {
+        streamed_texture& texture = entry.second;
+        texture_residency const& residency = *texture.residency;
+        // levels in flight would become resident behind the demotion
+        bool demotable = texture.loaded && residency.num_levels > 0 && texture.staged_level == residency.base_level
+                      && residency.base_level < texture.tail_level && residency.last_use_frame < before_frame;
+        if (demotable && (!victim || residency.last_use_frame < victim->residency->last_use_frame)) {
+            handle = entry.first;
+            victim = &texture;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    texture_residency& residency = *victim->residency;
+    GLint level = residency.base_level;
+    residency.base_level = level + 1;
+    victim->staged_level = residency.base_level;
+    std::size_t bytes = level_bytes(victim->chain, std::size_t(level));
+    residency.bytes -= bytes;
+    resident_bytes_ -= bytes;
+
+    // clamp sampling before the level disappears, an empty image releases its memory
+    glBindTexture(GL_TEXTURE_2D, handle);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, residency.base_level);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+std::size_t TextureStreamer::transfer(staged_level& level, std::size_t budget) {
+    // compressed levels are transferred in rows of 4x4 blocks
+    std::size_t const rows_per_unit = level.compressed ? 4 : 1;
+    std::size_t const unit_bytes = level.compressed ? std::max<std::size_t>((level.width + 3) / 4, 1) * 8 : level.width * 4;
+    std::size_t const units_left = (level.height - level.uploaded_rows + rows_per_unit - 1) / rows_per_unit;
+    // at least one unit, otherwise large levels would never make progress
+    std::size_t const units = std::min(units_left, std::max<std::size_t>(budget / unit_bytes, 1));
+    std::size_t const rows = std::min(units * rows_per_unit, level.height - level.uploaded_rows);
+    std::size_t const bytes = units * unit_bytes;
+    std::size_t const offset = level.offset + level.uploaded_rows / rows_per_unit * unit_bytes;
+
+    if (!persistent_) {
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, GLintptr(offset), GLsizeiptr(bytes), staging_ + offset);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, level.texture);
+    if (level.uploaded_rows == 0) {
+        std::shared_ptr<texture_residency> residency{};
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            streamed_texture& texture = textures_.at(level.texture);
+            residency = texture.residency;
+            // the level is no longer queued but resident
+            queued_bytes_ -= texture.queued_bytes;
+            texture.queued_bytes = 0;
+        }
+        residency->bytes += level.size;
+        resident_bytes_ += level.size;
+        if (residency->num_levels == 0) {
+            // nothing is resident until the first level completes
+            utils::set_mipmap_sampler(GL_TEXTURE_2D, level.num_levels);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, GLint(level.num_levels));
+            residency->width = GLint(level.base_width);
+            residency->num_levels = GLint(level.num_levels);
+            residency->base_level = residency->num_levels;
+        }
+
+        // define the level, only levels which are needed take memory
+        // without the unpack buffer, null data would be read from it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (level.compressed) {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level.level, level.internal_format, GLsizei(level.width),
+                                   GLsizei(level.height), 0, GLsizei(level.size), nullptr);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, level.level, GL_RGBA8, GLsizei(level.width), GLsizei(level.height), 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_BO_);
+    }
+
+    GLvoid const* pixels = reinterpret_cast<GLvoid const*>(offset);
+    if (level.compressed) {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level.level, 0, GLint(level.uploaded_rows), GLsizei(level.width),
+                                  GLsizei(rows), level.internal_format, GLsizei(bytes), pixels);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, level.level, 0, GLint(level.uploaded_rows), GLsizei(level.width),
+                        GLsizei(rows), GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    level.uploaded_rows += rows;
+    return bytes;
+}
+
+void TextureStreamer::makeResident(staged_level const& level) {
+    std::shared_ptr<texture_residency> residency{};
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        residency = textures_.at(level.texture).residency;
+        --pending_;
+    }
+    if (level.level < residency->base_level) {
+        residency->base_level = level.level;
+        glBindTexture(GL_TEXTURE_2D, level.texture);
+        // the base level alone clamps sampling, the lod range is relative to it
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level.level);
+    }
+}
+
+///////////////////////////// local helper functions //////////////////////////
+// bytes of a level on the gpu, uncompressed levels are padded to rgba
+static std::size_t level_bytes(texture_loader::mip_chain const& chain, std::size_t level) {
+    texture_loader::mip_level const& mip = chain.levels[level];
+    return chain.compressed ? mip.size : mip.width * mip.height * 4;
+}
@@ -4,16 +4,31 @@
 #include "structs.hpp"
 
 #include <glbinding/gl/functions.h>
+// query context version
+#include <glbinding/ContextInfo.h>
+#include <glbinding/Version.h>
 // use gl definitions from glbinding 
 using namespace gl;
 
 #include <glm/gtc/type_precision.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace utils {
 
 texture_object create_texture_object(pixel_data const& tex) {
@@ -24,6 +39,27 @@ texture_object create_texture_object(pixel_data const& tex) {
   return t_obj;
 }
 
+// upper limit of anisotropic filtering, planets are seen mostly head-on
+static const float MAX_ANISOTROPY = 8.0f;
+
+void set_mipmap_sampler(GLenum target, std::size_t num_levels) {
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, GLint(num_levels) - 1);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  static float const max_anisotropy = [] {
+    float anisotropy = 1.0f;
+    if (has_extension("GL_EXT_texture_filter_anisotropic")) {
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+    }
+    return std::min(anisotropy, MAX_ANISOTROPY);
+  }();
+  if (max_anisotropy > 1.0f) {
+    glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, max_anisotropy);
+  }
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
 void print_bound_textures() {
   GLint id1, id2, id3, active_unit, texture_units = 0;
   glGetIntegerv(GL_ACTIVE_TEXTURE, &active_unit);
@@ -92,6 +128,22 @@ GLint get_bound_VAO() {
   return array;
 }
 
+bool has_version(unsigned major, unsigned minor) {
+  return glbinding::ContextInfo::version() >= glbinding::Version(static_cast<unsigned char>(major), static_cast<unsigned char>(minor));
+}
+
+bool has_extension(std::string const& name) {
+  GLint num_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+  for (GLint i = 0; i < num_extensions; ++i) {
+    char const* extension = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+    if (extension && name == extension) {
+      return true;
+    }
+  }
+  return false;
+}
+
 std::string file_name(std::string const& file_path) {
   return file_path.substr(file_path.find_last_of("/\\") + 1);
 }
@@ -117,6 +169,76 @@ std::string read_file(std::string const& name) {
   }
 }
 
+bool stamp_file(std::string const& name, file_stamp& stamp) {
+  struct stat status;
+  if (stat(name.c_str(), &status) != 0) {
+    return false;
+  }
+  stamp = file_stamp{std::uint64_t(status.st_size), std::uint64_t(status.st_mtime)};
+  return true;
+}
+
+std::shared_ptr<void const> map_file(std::string const& name, std::size_t& size) {
+#ifdef _WIN32
+  std::ifstream file{name, std::ios::binary | std::ios::ate};
+  if (!file) {
+    return nullptr;
+  }
+  size = std::size_t(file.tellg());
+  auto data = std::make_shared<std::vector<char>>(size);
+  file.seekg(0);
+  file.read(data->data(), std::streamsize(size));
+  return file ? std::shared_ptr<void const>{data, data->data()} : nullptr;
+#else
+  int descriptor = open(name.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    return nullptr;
+  }
+  struct stat status;
+  void* data = MAP_FAILED;
+  if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+    size = std::size_t(status.st_size);
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  }
+  // mapping stays valid after closing
+  close(descriptor);
+  if (data == MAP_FAILED) {
+    return nullptr;
+  }
+  std::size_t mapped_size = size;
+  return std::shared_ptr<void const>{data, [mapped_size](void const* ptr) { munmap(const_cast<void*>(ptr), mapped_size); }};
+#endif
+}
+
+std::string canonical_path(std::string const& name) {
+#ifdef _WIN32
+  char path[_MAX_PATH];
+  return _fullpath(path, name.c_str(), _MAX_PATH) ? std::string{path} : name;
+#else
+  char path[PATH_MAX];
+  return realpath(name.c_str(), path) ? std::string{path} : name;
+#endif
+}
+
+std::uint64_t hash_bytes(void const* data, std::size_t bytes, std::uint64_t hash) {
+  auto ptr = static_cast<std::uint8_t const*>(data);
+  for (std::size_t i = 0; i < bytes; ++i) {
+    hash = (hash ^ ptr[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string escape_json(std::string const& text) {
+  std::string result{};
+  for (char const character : text) {
+    if (character == '"' || character == '\\') {
+      result += '\\';
+    }
+    result += character;
+  }
+  return result;
+}
+
 std::string read_resource_path(int argc, char* argv[]) {
   std::string resource_path{};
   //first argument is resource path
@@ -146,4 +268,23 @@ glm::fmat4 calculate_projection_matrix(float aspect) {
   return glm::perspective(fov_y, aspect, 0.1f, 100.0f);
 }
 
+std::size_t range_num(std::size_t count, std::size_t min_range_size) {
+  if (is_worker_thread()) {
+    return 1;
+  }
+  std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+  return std::max(std::min(count / min_range_size, threads), std::size_t{1});
+}
+
+// set per thread, so pools need no registry
+static thread_local bool worker_thread = false;
+
+void set_worker_thread(bool worker) {
+  worker_thread = worker;
+}
+
+bool is_worker_thread() {
+  return worker_thread;
+}
+
 }
@@ -0,0 +1,588 @@
+#include "virtual_texturing.hpp"
+
+#include "cpu_profiler.hpp"
+#include "texture_loader.hpp"
+#include "utils.hpp"
+
+#include <glbinding/gl/gl.h>
+// use gl definitions from glbinding
+using namespace gl;
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+const std::size_t VirtualTexturing::TILE_SIZE;
+const std::size_t VirtualTexturing::TILE_BORDER;
+
+// "VTX1", raw rgba8 tiles with border
+static const std::uint32_t TILE_FILE_MAGIC = 0x31585456;
+// ids are stored in 4 bits of the feedback
+static const std::size_t MAX_TEXTURES = 15;
+// loads in flight and uploads per frame, bounds the cost of sudden camera cuts
+static const std::size_t MAX_REQUESTS = 32;
+static const std::size_t MAX_UPLOADS = 8;
+
+// fixed-size header, followed by one entry per level and the tiles of all levels
+struct tile_file_header {
+  std::uint32_t magic;
+  std::uint32_t width;
+  std::uint32_t height;
+  std::uint32_t tile_size;
+  std::uint32_t border;
+  std::uint32_t num_levels;
+  std::uint64_t source_size;
+  std::uint64_t source_modified;
+};
+
+struct tile_file_level {
+  std::uint32_t tiles_x;
+  std::uint32_t tiles_y;
+  std::uint64_t offset;
+};
+
+static std::uint64_t tile_key(std::size_t id, std::size_t level, std::size_t x, std::size_t y);
+static void split_key(std::uint64_t key, std::size_t& id, std::size_t& level, std::size_t& x, std::size_t& y);
+static std::vector<std::uint8_t> downsample(std::vector<std::uint8_t> const& texels, std::size_t width, std::size_t height,
+                                            std::size_t num_components);
+
+VirtualTexturing::VirtualTexturing(std::size_t cache_tiles, unsigned feedback_scale):
+    cache_tiles_{cache_tiles},
+    feedback_scale_{feedback_scale},
+    tile_cache_{0},
+    slots_{},
+    resident_{},
+    requested_{},
+    frame_{0},
+    feedback_FBO_{0},
+    feedback_color_{0},
+    feedback_depth_{0},
+    feedback_BOs_{0, 0},
+    width_{0},
+    height_{0},
+    feedback_width_{0},
+    feedback_height_{0},
+    feedback_frames_{0},
+    mutex_{},
+    jobs_available_{},
+    stores_{},
+    jobs_{},
+    loaded_{},
+    stop_{false},
+    worker_{}
+{
+    std::size_t const padded = TILE_SIZE + 2 * TILE_BORDER;
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    // slot coordinates are stored in 8 bit page table channels
+    cache_tiles_ = std::min(std::min(cache_tiles_, std::size_t(max_size) / padded), std::size_t(256));
+    slots_.resize(cache_tiles_ * cache_tiles_, cache_slot{0, 0, false, false});
+
+    glGenTextures(1, &tile_cache_);
+    glBindTexture(GL_TEXTURE_2D, tile_cache_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(cache_tiles_ * padded), GLsizei(cache_tiles_ * padded), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &feedback_FBO_);
+    glGenTextures(1, &feedback_color_);
+    glGenRenderbuffers(1, &feedback_depth_);
+    glGenBuffers(2, feedback_BOs_);
+
+    worker_ = std::thread{&VirtualTexturing::work, this};
+}
+
+VirtualTexturing::~VirtualTexturing() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+    jobs_available_.notify_all();
+    worker_.join();
+
+    for (auto const& store : stores_) {
+        glDeleteTextures(1, &store.texture.page_table);
+    }
+    glDeleteTextures(1, &tile_cache_);
+    glDeleteFramebuffers(1, &feedback_FBO_);
+    glDeleteTextures(1, &feedback_color_);
+    glDeleteRenderbuffers(1, &feedback_depth_);
+    glDeleteBuffers(2, feedback_BOs_);
+}
+
+void VirtualTexturing::buildTileFile(std::string const& image_file, std::string const& tile_file) {
+    utils::file_stamp stamp{0, 0};
+    if (!utils::stamp_file(image_file, stamp)) {
+        throw std::runtime_error("VirtualTexturing: image '" + image_file + "' not found");
+    }
+    pixel_data image = texture_loader::file(image_file);
+    auto is_power_of_two = [](std::size_t value) { return value > 0 && (value & (value - 1)) == 0; };
+    if (!is_power_of_two(image.width) || !is_power_of_two(image.height)
+     || image.width < TILE_SIZE || image.height < TILE_SIZE) {
+        throw std::runtime_error("VirtualTexturing: size of '" + image_file + "' is no power of two multiple of the tile size");
+    }
+    std::size_t const num_components = image.channels == GL_RGBA ? 4 : image.channels == GL_RGB ? 3 :
+                                       image.channels == GL_RG ? 2 : 1;
+
+    // levels keep the components of the image, tiles are padded to rgba while they are written
+    std::vector<std::uint8_t> texels{std::move(image.pixels)};
+    std::size_t const width = image.width;
+    std::size_t const height = image.height;
+    image = pixel_data{};
+
+    // levels down to the one fitting into a single tile
+    std::size_t num_levels = 1;
+    while (std::max(width >> (num_levels - 1), height >> (num_levels - 1)) > TILE_SIZE) {
+        ++num_levels;
+    }
+    std::size_t const padded = TILE_SIZE + 2 * TILE_BORDER;
+    std::size_t const tile_bytes = padded * padded * 4;
+    std::vector<tile_file_level> levels{};
+    std::uint64_t offset = sizeof(tile_file_header) + num_levels * sizeof(tile_file_level);
+    for (std::size_t level = 0; level < num_levels; ++level) {
+        std::size_t tiles_x = std::max<std::size_t>((width >> level) / TILE_SIZE, 1);
+        std::size_t tiles_y = std::max<std::size_t>((height >> level) / TILE_SIZE, 1);
+        levels.push_back(tile_file_level{std::uint32_t(tiles_x), std::uint32_t(tiles_y), offset});
+        offset += tiles_x * tiles_y * tile_bytes;
+    }
+
+    // written under a temporary name, an interrupted build leaves no broken tile file
+    std::string const temporary_file{tile_file + ".tmp"};
+    {
+        std::ofstream file{temporary_file, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("VirtualTexturing: cannot write '" + tile_file + "'");
+        }
+        tile_file_header header{TILE_FILE_MAGIC, std::uint32_t(width), std::uint32_t(height), std::uint32_t(TILE_SIZE),
+                                std::uint32_t(TILE_BORDER), std::uint32_t(num_levels), stamp.size, stamp.modified};
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(levels.data()), std::streamsize(levels.size() * sizeof(tile_file_level)));
+
+        std::vector<std::uint8_t> tile(tile_bytes);
+        for (std::size_t level = 0; level < num_levels; ++level) {
+            std::size_t level_width = std::max<std::size_t>(width >> level, 1);
+            std::size_t level_height = std::max<std::size_t>(height >> level, 1);
+            for (std::size_t tile_y = 0; tile_y < levels[level].tiles_y; ++tile_y) {
+                for (std::size_t tile_x = 0; tile_x < levels[level].tiles_x; ++tile_x) {
+                    for (std::size_t y = 0; y < padded; ++y) {
+                        // planet maps wrap around horizontally and are clamped at the poles
+                        long source_y = long(tile_y * TILE_SIZE + y) - long(TILE_BORDER);
+                        source_y = std::min(std::max(source_y, 0l), long(level_height) - 1);
+                        for (std::size_t x = 0; x < padded; ++x) {
+                            long source_x = long(tile_x * TILE_SIZE + x) - long(TILE_BORDER);
+                            source_x = (source_x + long(level_width)) % long(level_width);
+                            std::uint8_t const* texel =
+                                &texels[(std::size_t(source_y) * level_width + std::size_t(source_x)) * num_components];
+                            for (std::size_t c = 0; c < 4; ++c) {
+                                tile[(y * padded + x) * 4 + c] = c < num_components ? texel[c] : std::uint8_t(255);
+                            }
+                        }
+                    }
+                    file.write(reinterpret_cast<char const*>(tile.data()), std::streamsize(tile.size()));
+                }
+            }
+            if (level + 1 < num_levels) {
+                texels = downsample(texels, level_width, level_height, num_components);
+            }
+        }
+        if (!file) {
+            throw std::runtime_error("VirtualTexturing: cannot write '" + tile_file + "'");
+        }
+    }
+    std::remove(tile_file.c_str());
+    if (std::rename(temporary_file.c_str(), tile_file.c_str()) != 0) {
+        throw std::runtime_error("VirtualTexturing: cannot write '" + tile_file + "'");
+    }
+}
+
+virtual_texture_object VirtualTexturing::add(std::string const& image_file) {
+    if (stores_.size() >= MAX_TEXTURES) {
+        throw std::logic_error("VirtualTexturing: at most 15 virtual textures are supported");
+    }
+    std::string const tile_file{image_file + ".vt"};
+
+    // tile files remember the image they were built from
+    auto open = [&](tile_file_header& header, std::size_t& size) {
+        utils::file_stamp stamp{0, 0};
+        std::shared_ptr<void const> data = utils::map_file(tile_file, size);
+        if (!data || size < sizeof(tile_file_header) || !utils::stamp_file(image_file, stamp)) {
+            return std::shared_ptr<void const>{};
+        }
+        std::memcpy(&header, data.get(), sizeof(header));
+        if (header.magic != TILE_FILE_MAGIC || header.tile_size != TILE_SIZE || header.border != TILE_BORDER
+         || header.source_size != stamp.size || header.source_modified != stamp.modified
+         || sizeof(tile_file_header) + header.num_levels * sizeof(tile_file_level) > size) {
+            return std::shared_ptr<void const>{};
+        }
+        return data;
+    };
+    tile_file_header header{};
+    std::size_t size = 0;
+    std::shared_ptr<void const> data = open(header, size);
+    if (!data) {
+        // tiling decodes the whole image, which takes too long and too much memory at startup
+        throw std::runtime_error("VirtualTexturing: '" + tile_file + "' is missing or outdated, build it with vt_tiler");
+    }
+
+    tile_store store{data, virtual_texture_object{}, {}, {}, {}, {}, true};
+    std::size_t const tile_bytes = (TILE_SIZE + 2 * TILE_BORDER) * (TILE_SIZE + 2 * TILE_BORDER) * 4;
+    for (std::uint32_t level = 0; level < header.num_levels; ++level) {
+        tile_file_level entry;
+        std::memcpy(&entry, static_cast<std::uint8_t const*>(data.get()) + sizeof(header) + level * sizeof(entry),
+                    sizeof(entry));
+        if (entry.offset + std::uint64_t(entry.tiles_x) * entry.tiles_y * tile_bytes > size) {
+            throw std::runtime_error("VirtualTexturing: '" + tile_file + "' is truncated");
+        }
+        store.tiles_x.push_back(entry.tiles_x);
+        store.tiles_y.push_back(entry.tiles_y);
+        store.offsets.push_back(std::size_t(entry.offset));
+        store.page_entries.emplace_back(std::size_t(entry.tiles_x) * entry.tiles_y * 4, std::uint8_t(0));
+    }
+
+    virtual_texture_object& texture = store.texture;
+    texture.id = GLuint(stores_.size() + 1);
+    texture.tile_cache = tile_cache_;
+    texture.width = GLint(header.width);
+    texture.height = GLint(header.height);
+    texture.tile_size = GLint(TILE_SIZE);
+    texture.num_levels = GLint(header.num_levels);
+    texture.cache_tiles = GLint(cache_tiles_);
+    texture.border = GLint(TILE_BORDER);
+
+    // one texel per tile, levels match the texture levels
+    glGenTextures(1, &texture.page_table);
+    glBindTexture(GL_TEXTURE_2D, texture.page_table);
+    for (std::size_t level = 0; level < store.tiles_x.size(); ++level) {
+        glTexImage2D(GL_TEXTURE_2D, GLint(level), GL_RGBA8, GLsizei(store.tiles_x[level]), GLsizei(store.tiles_y[level]),
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.num_levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stores_.push_back(store);
+    }
+
+    // the coarsest tiles are the fallback of every lookup
+    std::size_t const top = store.tiles_x.size() - 1;
+    for (std::size_t y = 0; y < store.tiles_y[top]; ++y) {
+        for (std::size_t x = 0; x < store.tiles_x[top]; ++x) {
+            if (!upload(load(tile_key(texture.id, top, x, y)), true)) {
+                throw std::runtime_error("VirtualTexturing: tile cache is too small");
+            }
+        }
+    }
+    updatePageTable(stores_.back());
+    return texture;
+}
+
+bool VirtualTexturing::empty() const {
+    return stores_.empty();
+}
+
+void VirtualTexturing::resize(unsigned width, unsigned height) {
+    width_ = width;
+    height_ = height;
+    feedback_width_ = std::max(width / feedback_scale_, 1u);
+    feedback_height_ = std::max(height / feedback_scale_, 1u);
+    // read backs in flight refer to the old size
+    feedback_frames_ = 0;
+
+    glBindTexture(GL_TEXTURE_2D, feedback_color_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GLsizei(feedback_width_), GLsizei(feedback_height_), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedback_depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, GLsizei(feedback_width_), GLsizei(feedback_height_));
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, feedback_FBO_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedback_color_, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedback_depth_);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "VirtualTexturing: feedback framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (GLuint buffer : feedback_BOs_) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(feedback_width_ * feedback_height_ * 4), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void VirtualTexturing::beginFeedback() {
+    glBindFramebuffer(GL_FRAMEBUFFER, feedback_FBO_);
+    glViewport(0, 0, GLsizei(feedback_width_), GLsizei(feedback_height_));
+    // zero alpha marks texels without request
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexturing::endFeedback() {
+    // copies into the buffer without waiting, it is mapped one frame later
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_BOs_[feedback_frames_ % 2]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, GLsizei(feedback_width_), GLsizei(feedback_height_), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    ++feedback_frames_;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, GLsizei(width_), GLsizei(height_));
+}
+
+float VirtualTexturing::getFeedbackBias() const {
+    return std::log2(float(feedback_scale_));
+}
+
+void VirtualTexturing::update() {
+    PROFILE_ZONE("virtual texturing update");
+    ++frame_;
+    for (auto& slot : slots_) {
+        slot.used = false;
+    }
+
+    // feedback of the previous frame, the one copied last frame may still be in flight
+    if (feedback_frames_ >= 2) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_BOs_[feedback_frames_ % 2]);
+        std::size_t const size = feedback_width_ * feedback_height_ * 4;
+        auto texels = static_cast<std::uint8_t const*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(size),
+                                                                        GL_MAP_READ_BIT));
+        if (texels) {
+            std::vector<std::uint64_t> keys{};
+            for (std::size_t i = 0; i < size; i += 4) {
+                // ids in the upper bits of alpha, 0 for geometry without virtual texture
+                std::size_t id = texels[i + 3] >> 4;
+                if (id == 0 || id > stores_.size()) {
+                    continue;
+                }
+                std::size_t level = texels[i + 3] & 15u;
+                std::size_t x = texels[i] | std::size_t(texels[i + 2] & 15u) << 8;
+                std::size_t y = texels[i + 1] | std::size_t(texels[i + 2] >> 4) << 8;
+                tile_store const& store = stores_[id - 1];
+                if (level < store.tiles_x.size() && x < store.tiles_x[level] && y < store.tiles_y[level]) {
+                    keys.push_back(tile_key(id, level, x, y));
+                }
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            for (std::uint64_t key : keys) {
+                touch(key);
+            }
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    std::deque<loaded_tile> loaded{};
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        std::size_t count = std::min(loaded_.size(), MAX_UPLOADS);
+        loaded.insert(loaded.end(), std::make_move_iterator(loaded_.begin()),
+                      std::make_move_iterator(loaded_.begin() + long(count)));
+        loaded_.erase(loaded_.begin(), loaded_.begin() + long(count));
+    }
+    for (auto const& tile : loaded) {
+        requested_.erase(tile.key);
+        upload(tile, false);
+    }
+
+    for (auto& store : stores_) {
+        if (store.dirty) {
+            updatePageTable(store);
+        }
+    }
+}
+
+std::size_t VirtualTexturing::getResidentTiles() const {
+    return resident_.size();
+}
+
+void VirtualTexturing::work() {
+    cpu_profiler::set_thread_name("virtual texturing");
+    while (true) {
+        std::uint64_t key = 0;
+        {
+            std::unique_lock<std::mutex> lock{mutex_};
+            jobs_available_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (stop_) {
+                return;
+            }
+            key = jobs_.front();
+            jobs_.pop_front();
+        }
+
+        // page faults of the mapped file happen here instead of on the gl thread
+        loaded_tile tile = load(key);
+        std::lock_guard<std::mutex> lock{mutex_};
+        loaded_.push_back(std::move(tile));
+    }
+}
+
+VirtualTexturing::loaded_tile VirtualTexturing::load(std::uint64_t key) {
+    std::size_t id, level, x, y;
+    PROFILE_ZONE("load tile");
+    split_key(key, id, level, x, y);
+    std::size_t const tile_bytes = (TILE_SIZE + 2 * TILE_BORDER) * (TILE_SIZE + 2 * TILE_BORDER) * 4;
+
+    std::shared_ptr<void const> data{};
+    std::size_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        tile_store const& store = stores_[id - 1];
+        data = store.data;
+        offset = store.offsets[level] + (y * store.tiles_x[level] + x) * tile_bytes;
+    }
+    loaded_tile tile{key, std::vector<std::uint8_t>(tile_bytes)};
+    std::memcpy(tile.texels.data(), static_cast<std::uint8_t const*>(data.get()) + offset, tile_bytes);
+    return tile;
+}
+
+void VirtualTexturing::touch(std::uint64_t key) {
+    std::size_t id, level, x, y;
+    split_key(key, id, level, x, y);
+    std::size_t const num_levels = stores_[id - 1].tiles_x.size();
+    // ancestors are needed as fallback until the tile arrives, coarse ones are requested first
+    std::vector<std::uint64_t> missing{};
+    for (; level < num_levels; ++level, x /= 2, y /= 2) {
+        std::uint64_t ancestor = tile_key(id, level, x, y);
+        auto resident = resident_.find(ancestor);
+        if (resident != resident_.end()) {
+            slots_[resident->second].last_use_frame = frame_;
+            slots_[resident->second].used = true;
+        }
+        else if (requested_.find(ancestor) == requested_.end()) {
+            missing.push_back(ancestor);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (auto ancestor = missing.rbegin(); ancestor != missing.rend() && requested_.size() < MAX_REQUESTS; ++ancestor) {
+        requested_.insert(*ancestor);
+        jobs_.push_back(*ancestor);
+        jobs_available_.notify_one();
+    }
+}
+
+bool VirtualTexturing::upload(loaded_tile const& tile, bool locked) {
+    // free slot or the least recently used one not needed this frame
+    std::size_t slot = slots_.size();
+    for (std::size_t i = 0; i < slots_.size(); ++i) {
+        cache_slot const& candidate = slots_[i];
+        if (candidate.key == 0) {
+            slot = i;
+            break;
+        }
+        if (!candidate.locked && !candidate.used
+         && (slot == slots_.size() || candidate.last_use_frame < slots_[slot].last_use_frame)) {
+            slot = i;
+        }
+    }
+    if (slot == slots_.size()) {
+        return false;
+    }
+
+    std::size_t id, level, x, y;
+    if (slots_[slot].key != 0) {
+        split_key(slots_[slot].key, id, level, x, y);
+        resident_.erase(slots_[slot].key);
+        stores_[id - 1].dirty = true;
+    }
+    split_key(tile.key, id, level, x, y);
+    slots_[slot] = cache_slot{tile.key, frame_, true, locked};
+    resident_[tile.key] = slot;
+    stores_[id - 1].dirty = true;
+
+    std::size_t const padded = TILE_SIZE + 2 * TILE_BORDER;
+    glBindTexture(GL_TEXTURE_2D, tile_cache_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, GLint(slot % cache_tiles_ * padded), GLint(slot / cache_tiles_ * padded),
+                    GLsizei(padded), GLsizei(padded), GL_RGBA, GL_UNSIGNED_BYTE, tile.texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void VirtualTexturing::updatePageTable(tile_store& store) {
+    std::size_t const num_levels = store.tiles_x.size();
+    glBindTexture(GL_TEXTURE_2D, store.texture.page_table);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // coarse to fine, tiles without resident data inherit the entry of their parent
+    for (std::size_t level = num_levels; level-- > 0;) {
+        std::vector<std::uint8_t>& entries = store.page_entries[level];
+        for (std::size_t y = 0; y < store.tiles_y[level]; ++y) {
+            for (std::size_t x = 0; x < store.tiles_x[level]; ++x) {
+                std::uint8_t* entry = &entries[(y * store.tiles_x[level] + x) * 4];
+                auto resident = resident_.find(tile_key(store.texture.id, level, x, y));
+                if (resident != resident_.end()) {
+                    entry[0] = std::uint8_t(resident->second % cache_tiles_);
+                    entry[1] = std::uint8_t(resident->second / cache_tiles_);
+                    entry[2] = std::uint8_t(level);
+                    entry[3] = 255;
+                }
+                else if (level + 1 < num_levels) {
+                    std::size_t parent_x = std::min(x / 2, store.tiles_x[level + 1] - 1);
+                    std::size_t parent_y = std::min(y / 2, store.tiles_y[level + 1] - 1);
+                    std::memcpy(entry, &store.page_entries[level + 1][(parent_y * store.tiles_x[level + 1] + parent_x) * 4], 4);
+                }
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, GLint(level), 0, 0, GLsizei(store.tiles_x[level]), GLsizei(store.tiles_y[level]),
+                        GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    store.dirty = false;
+}
+
+///////////////////////////// local helper functions //////////////////////////
+static std::uint64_t tile_key(std::size_t id, std::size_t level, std::size_t x, std::size_t y) {
+    return std::uint64_t(id) << 48 | std::uint64_t(level) << 40 | std::uint64_t(y) << 20 | std::uint64_t(x);
+}
+
+static void split_key(std::uint64_t key, std::size_t& id, std::size_t& level, std::size_t& x, std::size_t& y) {
+    id = std::size_t(key >> 48);
+    level = std::size_t(key >> 40) & 0xffu;
+    y = std::size_t(key >> 20) & 0xfffffu;
+    x = std::size_t(key) & 0xfffffu;
+}
+
+// 2x2 box filter, colours are averaged as squares which approximates linear space
+static std::vector<std::uint8_t> downsample(std::vector<std::uint8_t> const& texels, std::size_t width, std::size_t height,
+                                            std::size_t num_components) {
+    std::size_t const target_width = std::max<std::size_t>(width / 2, 1);
+    std::size_t const target_height = std::max<std::size_t>(height / 2, 1);
+    std::vector<std::uint8_t> result(target_width * target_height * num_components);
+    for (std::size_t y = 0; y < target_height; ++y) {
+        for (std::size_t x = 0; x < target_width; ++x) {
+            std::size_t const xs[2] = {2 * x, std::min(2 * x + 1, width - 1)};
+            std::size_t const ys[2] = {2 * y, std::min(2 * y + 1, height - 1)};
+            for (std::size_t c = 0; c < num_components; ++c) {
+                float sum = 0.0f;
+                for (std::size_t source_y : ys) {
+                    for (std::size_t source_x : xs) {
+                        float value = float(texels[(source_y * width + source_x) * num_components + c]);
+                        sum += c < 3 ? value * value : value;
+                    }
+                }
+                float average = c < 3 ? std::sqrt(sum / 4.0f) : sum / 4.0f;
+                result[(y * target_width + x) * num_components + c] = std::uint8_t(std::min(average + 0.5f, 255.0f));
+            }
+        }
+    }
+    return result;
+}
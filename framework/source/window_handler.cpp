@@ -14,11 +14,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "application.hpp"
+#include "frame_statistics.hpp"
+#include "gl_call_statistics.hpp"
 
 #include "utils.hpp"
 #include "shader_loader.hpp"
 
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <iostream>
 
@@ -26,9 +29,34 @@
 // use gl definitions from glbinding 
 using namespace gl;
 
+// frame time spent in an error mode
+struct error_mode_time {
+  double seconds;
+  unsigned long frames;
+};
+
+static const char* ERROR_MODE_NAMES[] = {"off", "debug", "sampled", "per_call"};
+static window_handler::error_mode current_error_mode = window_handler::error_mode::off;
+static unsigned error_interval = 60;
+static unsigned long error_frame = 0;
+static double last_frame_time = 0.0;
+static error_mode_time error_mode_times[4] = {};
+// both share the after callback of glbinding
+static bool per_call_errors = false;
+static bool call_statistics = false;
+
 // helper functions
 static void glsl_error(int error, const char* description);
 static void watch_gl_errors(bool activate = true);
+static void install_gl_callbacks();
+#ifdef GL_ERROR_CALLBACKS
+static void check_call_error(glbinding::FunctionCall const& call);
+static bool is_unchecked(glbinding::AbstractFunction const* function);
+#endif
+static window_handler::error_mode initial_error_mode();
+static void apply_error_mode(window_handler::error_mode mode);
+static bool debug_output_supported();
+static void print_error_mode_time(window_handler::error_mode mode);
 static void APIENTRY openglCallbackFunction(
   GLenum source,
   GLenum type,
@@ -66,8 +94,9 @@ GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigne
   // set OGL version explicitly 
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, ver_major);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ver_minor);
-  // enable deug support
-  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+  // debug contexts can be slower, only request one if errors are reported by the driver
+  window_handler::error_mode const mode = initial_error_mode();
+  glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, mode == error_mode::debug || mode == error_mode::per_call);
 
   //MacOS requires forward compat core profile
   #ifdef __APPLE__
@@ -102,16 +131,17 @@ GLFWwindow* initialize(glm::uvec2 const& resolution, unsigned ver_major, unsigne
   else {
     std::cout << " compat" << std::endl;
   }
-  // activate error checking after each gl function call
-  watch_gl_errors();
-
-  // Enable the debug callback
-  glEnable(GL_DEBUG_OUTPUT);
-  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-  glDebugMessageCallback(openglCallbackFunction, nullptr);
-  glDebugMessageControl(
-    GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, true
-  );
+  // Register the debug callback, enabled depending on the error mode
+  if (debug_output_supported()) {
+    glDebugMessageCallback(openglCallbackFunction, nullptr);
+    glDebugMessageControl(
+      GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, true
+    );
+  }
+  set_error_mode(mode);
+  if (gl_call_statistics::requested()) {
+    set_call_statistics(true);
+  }
 
   return window;
 }
@@ -140,24 +170,91 @@ void set_callback_object(GLFWwindow* window, Application* app) {
 
 
 // calculate fps and show in m_window title
-void show_fps(GLFWwindow* window) {
-    // variables for fps computation
-  static double m_last_second_time;
-  static unsigned m_frames_per_second;
+void show_fps(GLFWwindow* window, FrameStatistics const& statistics) {
+  std::string title{"OpenGL Framework - "};
+  title += std::to_string(statistics.getFramesPerSecond()) + " fps, p99 ";
+  // one decimal is enough for the title
+  double const p99_ms = statistics.getSummary(FrameStatistics::PRESENT).p99_ms;
+  title += std::to_string(unsigned(p99_ms)) + "." + std::to_string(unsigned(p99_ms * 10.0) % 10) + " ms";
+  if (call_statistics) {
+    title += ", " + std::to_string(gl_call_statistics::get_last_frame().calls) + " gl calls";
+  }
+
+  glfwSetWindowTitle(window, title.c_str());
+}
+
+void set_error_mode(error_mode mode) {
+#ifndef GL_ERROR_CALLBACKS
+  if (mode == error_mode::per_call) {
+    std::cerr << "Per-call gl error checking is compiled out, using debug output" << std::endl;
+    mode = error_mode::debug;
+  }
+#endif
+  if (error_mode_times[int(current_error_mode)].frames > 0) {
+    print_error_mode_time(current_error_mode);
+  }
+  apply_error_mode(mode);
+  current_error_mode = mode;
+  std::cout << "GL error mode " << ERROR_MODE_NAMES[int(mode)] << std::endl;
+}
+
+error_mode get_error_mode() {
+  return current_error_mode;
+}
+
+void set_call_statistics(bool enable) {
+#ifdef GL_ERROR_CALLBACKS
+  gl_call_statistics::track(enable);
+  call_statistics = enable;
+  install_gl_callbacks();
+  std::cout << "GL call statistics " << (enable ? "on" : "off") << std::endl;
+#else
+  if (enable) {
+    std::cerr << "GL call statistics are compiled out, enable GL_ERROR_CALLBACKS" << std::endl;
+  }
+#endif
+}
+
+bool get_call_statistics() {
+  return call_statistics;
+}
+
+void set_error_interval(unsigned frames) {
+  error_interval = frames > 0 ? frames : 1;
+}
 
-  ++m_frames_per_second;
-  double current_time = glfwGetTime();
-  if (current_time - m_last_second_time >= 1.0) {
-    std::string title{"OpenGL Framework - "};
-    title += std::to_string(m_frames_per_second) + " fps";
+void check_errors() {
+  double const current_time = glfwGetTime();
+  // the first frame of a mode includes switching to it
+  if (last_frame_time > 0.0) {
+    error_mode_time& time = error_mode_times[int(current_error_mode)];
+    time.seconds += current_time - last_frame_time;
+    ++time.frames;
+  }
+  last_frame_time = current_time;
 
-    glfwSetWindowTitle(window, title.c_str());
-    m_frames_per_second = 0;
-    m_last_second_time = current_time;
+  ++error_frame;
+  if (current_error_mode != error_mode::sampled || error_frame % error_interval != 0) {
+    return;
+  }
+  // errors are kept until read, bounded as a lost context reports one forever
+  for (unsigned i = 0; i < 8; ++i) {
+    GLenum error = glGetError();
+    if (error == GL_NO_ERROR) {
+      break;
+    }
+    std::cerr << "OpenGL Error: " << glbinding::Meta::getString(error) << " in frames " << error_frame - error_interval + 1
+              << " to " << error_frame << ", use per-call checking to find the call" << std::endl;
   }
 }
 
 void close_and_quit(GLFWwindow* window, int status) {
+  // cost of the error modes used
+  for (unsigned i = 0; i < 4; ++i) {
+    if (error_mode_times[i].frames > 0) {
+      print_error_mode_time(error_mode(i));
+    }
+  }
   // free glfw resources
   glfwDestroyWindow(window);
   glfwTerminate();
@@ -194,37 +291,123 @@ static void APIENTRY openglCallbackFunction(
 }
 
 static void watch_gl_errors(bool activate) {
-  if(activate) {
-    // add callback after each function call
-    glbinding::setCallbackMaskExcept(glbinding::CallbackMask::After | glbinding::CallbackMask::ParametersAndReturnValue, {"glGetError", "glBegin", "glVertex3f", "glColor3f"});
-    glbinding::setAfterCallback(
-      [](glbinding::FunctionCall const& call) {
-        GLenum error = glGetError();
-        if (error != GL_NO_ERROR) {
-          // print name
-          std::cerr <<  "OpenGL Error: " << call.function->name() << "(";
-          // parameters
-          for (unsigned i = 0; i < call.parameters.size(); ++i)
-          {
-            std::cerr << call.parameters[i]->asString();
-            if (i < call.parameters.size() - 1)
-              std::cerr << ", ";
-          }
-          std::cerr << ")";
-          // return value
-          if(call.returnValue) {
-            std::cerr << " -> " << call.returnValue->asString();
-          }
-          // error
-          std::cerr  << " - " << glbinding::Meta::getString(error) << std::endl;
-          // throw exception to allow for backtrace
-          throw std::runtime_error("OpenGl error: " + std::string(call.function->name()));
-          exit(EXIT_FAILURE);
-        }
+  per_call_errors = activate;
+  install_gl_callbacks();
+}
+
+// one after callback serves per-call error checks and call statistics
+static void install_gl_callbacks() {
+#ifdef GL_ERROR_CALLBACKS
+  if (!per_call_errors && !call_statistics) {
+    glbinding::setCallbackMask(glbinding::CallbackMask::None);
+    return;
+  }
+  // errors are printed with parameters, statistics read them through typed callbacks
+  glbinding::CallbackMask const mask = per_call_errors
+    ? glbinding::CallbackMask::After | glbinding::CallbackMask::ParametersAndReturnValue
+    : glbinding::CallbackMask::After;
+  for (auto function : glbinding::Binding::functions()) {
+    // glGetError of the error check would call back into it
+    bool const skipped = per_call_errors
+                      && (function == &glbinding::Binding::GetError || (is_unchecked(function) && !call_statistics));
+    function->setCallbackMask(skipped ? glbinding::CallbackMask::None : mask);
+  }
+  glbinding::setAfterCallback(
+    [](glbinding::FunctionCall const& call) {
+      if (call_statistics) {
+        gl_call_statistics::count(call);
       }
-    );
+      if (per_call_errors && !is_unchecked(call.function)) {
+        check_call_error(call);
+      }
+    }
+  );
+#else
+  // without any callback glbinding calls the driver directly
+#endif
+}
+
+#ifdef GL_ERROR_CALLBACKS
+static void check_call_error(glbinding::FunctionCall const& call) {
+  GLenum error = glGetError();
+  if (error != GL_NO_ERROR) {
+    // print name
+    std::cerr <<  "OpenGL Error: " << call.function->name() << "(";
+    // parameters
+    for (unsigned i = 0; i < call.parameters.size(); ++i)
+    {
+      std::cerr << call.parameters[i]->asString();
+      if (i < call.parameters.size() - 1)
+        std::cerr << ", ";
+    }
+    std::cerr << ")";
+    // return value
+    if(call.returnValue) {
+      std::cerr << " -> " << call.returnValue->asString();
+    }
+    // error
+    std::cerr  << " - " << glbinding::Meta::getString(error) << std::endl;
+    // throw exception to allow for backtrace
+    throw std::runtime_error("OpenGl error: " + std::string(call.function->name()));
+    exit(EXIT_FAILURE);
+  }
+}
+
+// glGetError is invalid between glBegin and glEnd
+static bool is_unchecked(glbinding::AbstractFunction const* function) {
+  return function == &glbinding::Binding::Begin || function == &glbinding::Binding::Vertex3f
+      || function == &glbinding::Binding::Color3f;
+}
+#endif
+
+static window_handler::error_mode initial_error_mode() {
+  char const* name = std::getenv("GL_ERROR_MODE");
+  if (name != nullptr) {
+    for (unsigned i = 0; i < 4; ++i) {
+      if (std::strcmp(name, ERROR_MODE_NAMES[i]) == 0 || (i == 3 && std::strcmp(name, "call") == 0)) {
+        return window_handler::error_mode(i);
+      }
+    }
+    std::cerr << "Unknown GL_ERROR_MODE '" << name << "', use off, debug, sampled or call" << std::endl;
+  }
+#ifdef GL_ERROR_CALLBACKS
+  return window_handler::error_mode::per_call;
+#else
+  return window_handler::error_mode::debug;
+#endif
+}
+
+static void apply_error_mode(window_handler::error_mode mode) {
+  using window_handler::error_mode;
+  // errors of the previous mode would be attributed to the next call
+  for (unsigned i = 0; i < 8 && glGetError() != GL_NO_ERROR; ++i) {}
+
+  watch_gl_errors(mode == error_mode::per_call);
+  // the enums are invalid without debug output, which per-call checking would throw for
+  if (!debug_output_supported()) {
+    return;
+  }
+  if (mode == error_mode::debug || mode == error_mode::per_call) {
+    glEnable(GL_DEBUG_OUTPUT);
   }
   else {
-    glbinding::setCallbackMask(glbinding::CallbackMask::None);
+    glDisable(GL_DEBUG_OUTPUT);
   }
+  // synchronous output stalls the driver, but the callback runs inside the failing call
+  if (mode == error_mode::per_call) {
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+  else {
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  }
+}
+
+static bool debug_output_supported() {
+  return utils::has_version(4, 3) || utils::has_extension("GL_KHR_debug");
+}
+
+static void print_error_mode_time(window_handler::error_mode mode) {
+  error_mode_time const& time = error_mode_times[int(mode)];
+  std::cout << "GL error mode " << ERROR_MODE_NAMES[int(mode)] << ": "
+            << time.seconds * 1000.0 / double(time.frames) << " ms per frame over " << time.frames << " frames" << std::endl;
 }
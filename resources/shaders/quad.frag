@@ -1,4 +1,4 @@
-#version 460
+#version 150
 
 #define gaussian_blur mat3(1, 2, 1, 2, 4, 2, 1, 2, 1) * 0.0625
 
@@ -7,11 +7,7 @@ in vec2 pass_Coordinates;
 uniform sampler2D ColorTexture;
 uniform sampler2D DepthTexture;
 
-uniform bool Greyscale;
-uniform bool Blur;
-uniform bool Vertical;
-uniform bool Horizontal;
-uniform bool ChromaticAberration;
+// effects are selected by defining GREYSCALE, BLUR, VERTICAL, HORIZONTAL and CHROMATIC_ABERRATION
 
 out vec4 out_Color;
 
@@ -36,7 +32,7 @@ vec2 flipVertically(vec2 coordinates) {
 // consider 3x3 field around current pixel and add together to an average color at that pixel, can be done with any cube blur
 vec4 computeBlur(vec2 coordinates, mat3 kernel) {
     vec4 average_Color = vec4(0.0);
-    float direction[3] = {-1.0, 0.0, 1.0};
+    float direction[3] = float[3](-1.0, 0.0, 1.0);
     for(int x_dir = 0; x_dir < 3; ++x_dir) {
         for (int y_dir = 0; y_dir < 3; ++y_dir) {
             vec2 offset = vec2(direction[x_dir], direction[y_dir]) / resolution.xy;
@@ -64,25 +60,25 @@ vec4 computeChromaticAberration(vec2 coordinates) {
 void main() {
     vec2 coordinates = pass_Coordinates;
 
-    if (Vertical) {
-        coordinates = flipVertically(coordinates);
-    }
-    if (Horizontal) {
-        coordinates = flipHorizontally(coordinates);
-    }
-
-    if (Blur) {
-        out_Color = computeBlur(coordinates, gaussian_blur);
-    } else if (ChromaticAberration) {
-        out_Color = computeChromaticAberration(coordinates);
-    } else {
-        out_Color = texture(ColorTexture, coordinates);
-    }
-
-
-    if (Greyscale) {
-        out_Color = computeGreyscale(out_Color);
-    }
+#ifdef VERTICAL
+    coordinates = flipVertically(coordinates);
+#endif
+#ifdef HORIZONTAL
+    coordinates = flipHorizontally(coordinates);
+#endif
+
+#if defined(BLUR)
+    out_Color = computeBlur(coordinates, gaussian_blur);
+#elif defined(CHROMATIC_ABERRATION)
+    out_Color = computeChromaticAberration(coordinates);
+#else
+    out_Color = texture(ColorTexture, coordinates);
+#endif
+
+
+#ifdef GREYSCALE
+    out_Color = computeGreyscale(out_Color);
+#endif
 
 
 
@@ -5,9 +5,9 @@ uniform vec3  AmbientColor;    //color of the ambient light
 uniform vec3  LightColor;      // color of the point light
 uniform float LightIntensity;  // intensity of the point light
 uniform vec3  LightPosition;   // position of the point light
-uniform bool  Cel;             // bool for activating cel shading
 //uniform bool  NormalMap;       // bool for activating normal map
 uniform sampler2D TextureSampler;
+uniform bool      Feedback;        // output the virtual tile needed by each fragment instead of its colour
 
 const float Shininess = 10.0;  // specular exponent to determine shininess
 vec3 TextureColor;
@@ -50,7 +50,14 @@ vec3 perturbNormal( vec3 vertex_pos, vec3 surf_norm, vec2 uv) {
   return normalize( tsn * mapN );
 }*/
 
+#include "virtual_texture.glsl"
+
 void main() {
+  if (Feedback) {
+    out_Color = VirtualTexture != 0 ? virtualFeedback(clamp(pass_Coordinates, 0.0, 0.99999)) : vec4(0.0);
+    return;
+  }
+
   vec3 Normal = normalize(pass_Normal);
 
   /*if (NormalMap){
@@ -69,12 +76,16 @@ void main() {
   float SpecularAngle = max(dot(ReflectionDirection, ViewDirection), 0.0);  // angle of specular reflection
   float SpecularCoefficient = pow(SpecularAngle, Shininess);                // specular coefficient to determine strength and angle
 
-  if (Cel) {                                                                // if cel shading is active, coefficients are capped to get rid of smooth fall-off
-    SpecularCoefficient = round(SpecularCoefficient);
-    DiffuseFactor = ceil(2 * DiffuseFactor) / 2;
-  }
+#ifdef CEL                                                                  // cel shading caps coefficients to get rid of smooth fall-off
+  SpecularCoefficient = round(SpecularCoefficient);
+  DiffuseFactor = ceil(2 * DiffuseFactor) / 2;
+#endif
 
-  TextureColor = texture(TextureSampler, pass_Coordinates).xyz;
+  if (VirtualTexture != 0) {
+    TextureColor = virtualColor(clamp(pass_Coordinates, 0.0, 0.99999));
+  } else {
+    TextureColor = texture(TextureSampler, pass_Coordinates).xyz;
+  }
   // caluclation of three different light components
   vec3 Ambient = AmbientColor * TextureColor * 0.3;
   vec3 Diffuse = LightIntensity * LightColor * TextureColor * DiffuseFactor / Distance;
@@ -0,0 +1,33 @@
+#version 150
+#extension GL_ARB_explicit_attrib_location : require
+// cube of submission_bench, the model matrix source depends on the strategy
+layout(location = 0) in vec3 in_Position;
+layout(location = 1) in vec3 in_Color;
+
+#if defined(INSTANCED)
+// advanced per instance, also by the base instance of indirect draws
+layout(location = 2) in mat4 in_ModelMatrix;
+#elif defined(UNIFORM_BLOCK)
+// bound range of all matrices, indexed per draw
+layout(std140) uniform ModelBlock {
+  mat4 ModelMatrices[MODELS_PER_BLOCK];
+};
+uniform int ModelIndex;
+#else
+uniform mat4 ModelMatrix;
+#endif
+uniform mat4 ViewProjectionMatrix;
+
+out vec3 pass_Color;
+
+void main() {
+#if defined(INSTANCED)
+  mat4 model_matrix = in_ModelMatrix;
+#elif defined(UNIFORM_BLOCK)
+  mat4 model_matrix = ModelMatrices[ModelIndex];
+#else
+  mat4 model_matrix = ModelMatrix;
+#endif
+  gl_Position = ViewProjectionMatrix * model_matrix * vec4(in_Position, 1.0);
+  pass_Color = in_Color;
+}
@@ -0,0 +1,35 @@
+// software virtual texture lookup, included after #version
+
+uniform float     FeedbackBias;    // log2 of the feedback downscale, derivatives are that much larger
+uniform int       VirtualTexture;  // id of the virtual texture, 0 samples TextureSampler
+uniform sampler2D PageTable;       // cache tile and level of the finest resident tile per virtual tile
+uniform sampler2D TileCache;       // resident tiles with border
+uniform ivec4     VirtualLayout;   // width, height, tile size and number of levels of the virtual texture
+uniform ivec2     CacheLayout;     // tiles per side and border of the tile cache
+
+// level of the virtual texture from the screen space footprint, like hardware mip selection
+int virtualLevel(vec2 uv, float bias) {
+  vec2 texels = uv * vec2(VirtualLayout.xy);
+  float footprint = max(dot(dFdx(texels), dFdx(texels)), dot(dFdy(texels), dFdy(texels)));
+  return int(clamp(0.5 * log2(footprint) - bias, 0.0, float(VirtualLayout.w - 1)));
+}
+
+// tile and level packed into 8 bit channels, id and level share alpha
+vec4 virtualFeedback(vec2 uv) {
+  int level = virtualLevel(uv, FeedbackBias);
+  vec2 tiles = vec2(max(VirtualLayout.xy >> level, ivec2(1))) / float(VirtualLayout.z);
+  ivec2 tile = min(ivec2(uv * tiles), max(ivec2(tiles) - 1, ivec2(0)));
+  return vec4(tile.x & 255, tile.y & 255, (tile.x >> 8) | ((tile.y >> 8) << 4), level | (VirtualTexture << 4)) / 255.0;
+}
+
+vec3 virtualColor(vec2 uv) {
+  int level = virtualLevel(uv, 0.0);
+  // entry of the finest resident tile covering this one
+  vec4 entry = texelFetch(PageTable, ivec2(uv * vec2(textureSize(PageTable, level))), level) * 255.0;
+  int resident = int(entry.b + 0.5);
+  vec2 tiles = vec2(max(VirtualLayout.xy >> resident, ivec2(1))) / float(VirtualLayout.z);
+  vec2 position = fract(uv * tiles) * float(VirtualLayout.z);
+  float padded = float(VirtualLayout.z + 2 * CacheLayout.y);
+  vec2 cache = (floor(entry.rg + 0.5) * padded + float(CacheLayout.y) + position) / (padded * float(CacheLayout.x));
+  return textureLod(TileCache, cache, 0.0).rgb;
+}